@@ -16,7 +16,10 @@
 
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/data_base.hpp>
+#include <bitcoin/database/decoded_transaction.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/histogram.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/settings.hpp>
 #include <bitcoin/database/store.hpp>
 #include <bitcoin/database/unspent_outputs.hpp>
@@ -37,6 +40,7 @@
 #include <bitcoin/database/memory/memory.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
 #include <bitcoin/database/primitives/hash_table_header.hpp>
+#include <bitcoin/database/primitives/record_chunk_multimap.hpp>
 #include <bitcoin/database/primitives/record_hash_table.hpp>
 #include <bitcoin/database/primitives/record_list.hpp>
 #include <bitcoin/database/primitives/record_manager.hpp>
@@ -45,6 +49,7 @@
 #include <bitcoin/database/primitives/record_multimap_iterator.hpp>
 #include <bitcoin/database/primitives/slab_hash_table.hpp>
 #include <bitcoin/database/primitives/slab_manager.hpp>
+#include <bitcoin/database/primitives/slab_open_hash_table.hpp>
 #include <bitcoin/database/result/block_result.hpp>
 #include <bitcoin/database/result/transaction_result.hpp>
 
@@ -22,6 +22,7 @@
 #include <atomic>
 #include <cstddef>
 #include <memory>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
@@ -31,7 +32,10 @@
 #include <bitcoin/database/databases/transaction_unconfirmed_database.hpp>
 #include <bitcoin/database/databases/history_database.hpp>
 #include <bitcoin/database/databases/stealth_database.hpp>
+#include <bitcoin/database/decoded_transaction.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/histogram.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/settings.hpp>
 #include <bitcoin/database/store.hpp>
 
@@ -111,14 +115,25 @@ public:
     // ------------------------------------------------------------------------
 
     /// Invoke pop_all and then push_all under a common lock.
+    /// The outgoing list may be null if the popped blocks are not required.
     void reorganize(const config::checkpoint& fork_point,
         block_const_ptr_list_const_ptr incoming_blocks,
         block_const_ptr_list_ptr outgoing_blocks, dispatcher& dispatch,
         result_handler handler);
 
+    // Metrics.
+    // ------------------------------------------------------------------------
+
+    /// The latencies of writes, flushes, file growth and transaction reads.
+    latency::list latencies() const;
+
+    /// Clear the latencies.
+    void reset_latencies();
+
 protected:
     void start();
     void synchronize();
+    void synchronize(file_offset transactions_end);
     bool flush() const override;
 
     // Sets error if first_height is not the current top + 1 or not linked.
@@ -128,6 +143,7 @@ protected:
     // Pop the set of blocks above the given hash.
     // Sets error if the database is corrupt or the hash doesn't exist.
     // Any blocks returned were successfully popped prior to any failure.
+    // Popped blocks are not deserialized if out_blocks is null.
     void pop_above(block_const_ptr_list_ptr out_blocks,
         const hash_digest& fork_hash, dispatcher& dispatch,
         result_handler handler);
@@ -144,47 +160,83 @@ private:
     typedef chain::input::list inputs;
     typedef chain::output::list outputs;
 
+    // Completion times of the stages of an asynchronous block push.
+    struct push_phases
+    {
+        asio::time_point stored;
+        asio::time_point completing;
+        asio::time_point spent;
+        asio::time_point indexed;
+
+        // The end of the transactions when the block's store joined.
+        file_offset transactions_end;
+    };
+
+    typedef std::shared_ptr<push_phases> push_phases_ptr;
+
+    // The previous outputs of a block, partitioned for concurrent spending.
+    typedef std::shared_ptr<std::vector<chain::output_point::list>>
+        spends_ptr;
+
     // Synchronous writers.
     // ------------------------------------------------------------------------
 
+    bool top_checkpoint(config::checkpoint& out_top) const;
+
     bool push_transactions(const chain::block& block, size_t height,
         size_t bucket=0, size_t buckets=1);
+    bool store_transactions(const chain::block& block, size_t height,
+        size_t bucket, size_t buckets);
+    bool index_transactions(const chain::block& block, size_t height,
+        size_t bucket, size_t buckets);
     bool push_heights(const chain::block& block, size_t height);
-    void push_inputs(const hash_digest& tx_hash, size_t height,
+    bool push_spends(const chain::block& block, size_t height);
+    bool push_spends(const chain::output_point::list& previous_outputs,
+        size_t height);
+    spends_ptr partition_spends(const chain::block& block, size_t buckets);
+    void push_inputs(const decoded_transaction& decoded, size_t height,
         const inputs& inputs);
-    void push_outputs(const hash_digest& tx_hash, size_t height,
-        const outputs& outputs);
-    void push_stealth(const hash_digest& tx_hash, size_t height,
+    void push_outputs(const decoded_transaction& decoded, size_t height,
         const outputs& outputs);
+    void push_stealth(const decoded_transaction& decoded, size_t height);
+
+    bool pop(chain::block* out_block);
+    bool pop_spends(const chain::output_point::list& previous_outputs);
+    bool pop_inputs(const decoded_transaction& decoded,
+        const chain::output_point::list& previous_outputs);
+    bool pop_outputs(const decoded_transaction& decoded, size_t height);
 
-    // chain::block pop();      //OLD before merge
-    bool pop(chain::block& out_block);
-    // void pop_inputs(const inputs& inputs, size_t height);      //OLD before merge
-    bool pop_inputs(const inputs& inputs, size_t height);
-    // // void pop_outputs(const outputs& outputs, size_t height);
-    // void pop_outputs(hash_digest const& tx_hash, outputs const& outputs, size_t height);      //OLD before merge
-    bool pop_outputs(const outputs& outputs, size_t height);
     code verify_insert(const chain::block& block, size_t height);
     code verify_push(const chain::block& block, size_t height);
+    code verify_push(const chain::block& block, const chain::block& parent);
     code verify_push(const chain::transaction& tx);
 
     // Asynchronous writers.
     // ------------------------------------------------------------------------
 
     void push_next(const code& ec, block_const_ptr_list_const_ptr blocks,
-        size_t index, size_t height, dispatcher& dispatch,
-        result_handler handler);
-    void do_push(block_const_ptr block, size_t height, dispatcher& dispatch,
+        size_t index, size_t height, push_phases_ptr phases,
+        dispatcher& dispatch, result_handler handler);
+    void store_block(block_const_ptr_list_const_ptr blocks, size_t index,
+        size_t height, push_phases_ptr phases, dispatcher& dispatch,
         result_handler handler);
-    void do_push_transactions(block_const_ptr block, size_t height,
+    void do_store_transactions(block_const_ptr block, size_t height,
         size_t bucket, size_t buckets, result_handler handler);
-    void handle_push_transactions(const code& ec, block_const_ptr block,
-        size_t height, result_handler handler);
+    void complete_block(block_const_ptr block, size_t height,
+        push_phases_ptr phases, dispatcher& dispatch, result_handler handler);
+    void do_index_transactions(block_const_ptr block, size_t height,
+        size_t bucket, size_t buckets, result_handler handler);
+    void do_push_spends(spends_ptr spends, size_t bucket, size_t height,
+        result_handler handler);
+    void handle_complete_block(const code& ec, block_const_ptr block,
+        size_t height, push_phases_ptr phases, result_handler handler);
 
     void handle_pop(const code& ec,
         block_const_ptr_list_const_ptr incoming_blocks,
-        size_t first_height, dispatcher& dispatch, result_handler handler);
-    void handle_push(const code& ec, result_handler handler) const;
+        size_t first_height, const asio::time_point& start,
+        dispatcher& dispatch, result_handler handler);
+    void handle_push(const code& ec, const asio::time_point& start,
+        result_handler handler) const;
 
     std::atomic<bool> closed_;
     const settings& settings_;
@@ -194,6 +246,18 @@ private:
 
     // Used to prevent concurrent file remapping.
     std::shared_ptr<shared_mutex> remap_mutex_;
+
+    // Optional journal of writes, flushed in place of the files.
+    std::shared_ptr<journal> journal_;
+
+    // Latencies of the writers, these are thread safe and as statistics are
+    // mutable.
+    mutable histogram push_latency_;
+    mutable histogram push_transactions_latency_;
+    mutable histogram push_heights_latency_;
+    mutable histogram pop_latency_;
+    mutable histogram reorganize_latency_;
+    mutable histogram flush_latency_;
 };
 
 } // namespace database
@@ -24,6 +24,7 @@
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
 #include <bitcoin/database/primitives/record_manager.hpp>
 #include <bitcoin/database/primitives/slab_hash_table.hpp>
@@ -45,7 +46,9 @@ public:
 
     /// Construct the database.
     block_database(const path& map_filename, const path& index_filename,
-        size_t buckets, size_t expansion, mutex_ptr mutex=nullptr);
+        size_t buckets, size_t expansion, mutex_ptr mutex=nullptr,
+        const mapping_policy& lookup_mapping=mapping_policy(),
+        const mapping_policy& index_mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~block_database();
@@ -85,6 +88,9 @@ public:
     /// Flush the memory maps to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory maps.
+    void attach(journal& journal);
+
     /// The index of the highest existing block, independent of gaps.
     bool top(size_t& out_height) const;
 
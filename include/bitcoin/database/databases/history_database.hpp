@@ -19,12 +19,14 @@
 #ifndef LIBBITCOIN_DATABASE_HISTORY_DATABASE_HPP
 #define LIBBITCOIN_DATABASE_HISTORY_DATABASE_HPP
 
+#include <cstddef>
 #include <memory>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
-#include <bitcoin/database/primitives/record_multimap.hpp>
+#include <bitcoin/database/primitives/record_chunk_multimap.hpp>
 
 namespace libbitcoin {
 namespace database {
@@ -38,21 +40,59 @@ struct BCD_API history_statinfo
     /// Total number of unique addresses in the database.
     const size_t addrs;
 
-    /// Total number of rows across all addresses.
-    const size_t rows;
+    /// Total number of row chunks across all addresses.
+    const size_t chunks;
+};
+
+/// The aggregate of the history of an address, maintained as rows are added
+/// and deleted. Spent value is not included, as spends carry no value.
+struct BCD_API history_summary
+{
+    /// The total value of the outputs to the address.
+    uint64_t received;
+
+    /// The number of rows (outputs and spends) of the address.
+    size_t rows;
+
+    /// The height of the newest row of the address.
+    size_t height;
+};
+
+/// The position of a paginated history read, resumed by the next page.
+/// A default cursor starts at the newest row of the key.
+struct BCD_API history_cursor
+{
+    history_cursor();
+
+    /// True if no rows remain in the bounds of the read.
+    bool exhausted() const;
+
+    /// The chunk is looked up from the key once the read has started, and
+    /// ordered is set if the rows of the key were added in height order.
+    /// The position is the number of rows of the chunk not yet read.
+    bool started;
+    bool ordered;
+    array_index chunk;
+    size_t position;
 };
 
 /// This is a multimap where the key is the Bitcoin address hash,
 /// which returns several rows giving the history for that address.
+/// The rows of an address are stored in chunks of chunk_rows rows.
 class BCD_API history_database
 {
 public:
     typedef boost::filesystem::path path;
     typedef std::shared_ptr<shared_mutex> mutex_ptr;
 
+    /// The number of rows of a chunk.
+    static const size_t chunk_rows;
+
     /// Construct the database.
     history_database(const path& lookup_filename, const path& rows_filename,
-        size_t buckets, size_t expansion, mutex_ptr mutex=nullptr);
+        size_t buckets, size_t expansion, mutex_ptr mutex=nullptr,
+        const mapping_policy& lookup_mapping=mapping_policy(),
+        const mapping_policy& rows_mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~history_database();
@@ -81,18 +121,32 @@ public:
     chain::history_compact::list get(const short_hash& key, size_t limit,
         size_t from_height) const;
 
+    /// Get the summary of the key in constant time, zeros if not found.
+    history_summary summary(const short_hash& key) const;
+
+    /// Get a page of at most limit rows (zero is unlimited), newest first,
+    /// resuming at the cursor. Rows above to_height are skipped and the read
+    /// ends at the first row below from_height, unless rows of the key were
+    /// added out of height order (by insert), in which case rows below it are
+    /// skipped. The cursor is advanced to the row following the page.
+    chain::history_compact::list get(const short_hash& key, size_t limit,
+        size_t from_height, size_t to_height, history_cursor& cursor) const;
+
     /// Commit latest inserts.
     void synchronize();
 
     /// Flush the memory maps to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory maps.
+    void attach(journal& journal);
+
     /// Return statistical info about the database.
     history_statinfo statinfo() const;
 
 private:
     typedef record_hash_table<short_hash> record_map;
-    typedef record_multimap<short_hash> record_multiple_map;
+    typedef record_chunk_multimap<short_hash> record_chunk_map;
 
     // The starting size of the hash table, used by create.
     const size_t initial_map_file_size_;
@@ -103,11 +157,10 @@ private:
     record_manager lookup_manager_;
     record_map lookup_map_;
 
-    /// List of history rows.
+    /// Chunks of history rows.
     memory_map rows_file_;
     record_manager rows_manager_;
-    record_list rows_list_;
-    record_multiple_map rows_multimap_;
+    record_chunk_map rows_multimap_;
 };
 
 } // namespace database
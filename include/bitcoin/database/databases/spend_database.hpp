@@ -24,6 +24,7 @@
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/primitives/record_hash_table.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
 
@@ -49,8 +50,10 @@ public:
     typedef std::shared_ptr<shared_mutex> mutex_ptr;
 
     /// Construct the database.
+    /// The table is resized above max_load keys per hundred buckets.
     spend_database(const path& filename, size_t buckets, size_t expansion,
-        mutex_ptr mutex=nullptr);
+        mutex_ptr mutex=nullptr, size_t max_load=0,
+        const mapping_policy& mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~spend_database();
@@ -80,6 +83,9 @@ public:
     /// Flush the memory map to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory map.
+    void attach(journal& journal);
+
     /// Return statistical info about the database.
     spend_statinfo statinfo() const;
 
@@ -19,17 +19,35 @@
 #ifndef LIBBITCOIN_DATABASE_STEALTH_DATABASE_HPP
 #define LIBBITCOIN_DATABASE_STEALTH_DATABASE_HPP
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <boost/filesystem.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
+#include <bitcoin/database/primitives/record_hash_table.hpp>
+#include <bitcoin/database/primitives/record_list.hpp>
 #include <bitcoin/database/primitives/record_manager.hpp>
 
 namespace libbitcoin {
 namespace database {
 
+/**
+ * Stealth rows are partitioned into buckets by the leading bits of their
+ * prefix. Each bucket links to its newest chunk of rows, and each chunk holds
+ * the greatest height of its rows and of the older chunks of the bucket.
+ *
+ *   [ header:buckets ]
+ *   [ chunk          ] * n
+ *
+ * A scan visits only the buckets that the filter can match, and within a
+ * bucket it stops at the first chunk whose greatest height is below the
+ * height of interest. Rows need not be added in height order, as insert
+ * fills gaps, and the rows of a popped block are removed from the chunks.
+ */
 class BCD_API stealth_database
 {
 public:
@@ -37,9 +55,16 @@ public:
     typedef boost::filesystem::path path;
     typedef std::shared_ptr<shared_mutex> mutex_ptr;
 
+    /// The number of leading prefix bits that select a bucket.
+    static const size_t bucket_bits;
+
+    /// The number of rows in a chunk of a bucket.
+    static const size_t chunk_rows;
+
     /// Construct the database.
     stealth_database(const path& rows_filename, size_t expansion,
-        mutex_ptr mutex=nullptr);
+        mutex_ptr mutex=nullptr,
+        const mapping_policy& mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~stealth_database();
@@ -53,15 +78,17 @@ public:
     /// Call to unload the memory map.
     bool close();
 
-    /// Linearly scan all entries, discarding those after from_height.
+    /// Scan the buckets matching the filter for rows at or above from_height.
+    /// Rows are returned newest first within each bucket.
     list scan(const binary& filter, size_t from_height) const;
 
     /// Add a stealth row to the database.
     void store(uint32_t prefix, uint32_t height,
         const chain::stealth_compact& row);
 
-    /////// Delete stealth row (not implemented).
-    ////bool unlink();
+    /// Delete the rows of the prefix's bucket at or above from_height.
+    /// Returns false if there are none.
+    bool unlink(uint32_t prefix, size_t from_height);
 
     /// Commit latest inserts.
     void synchronize();
@@ -69,13 +96,35 @@ public:
     /// Flush the memory map to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory map.
+    void attach(journal& journal);
+
 private:
-    void write_index();
-    array_index read_index(size_t from_height) const;
+    typedef std::array<shared_mutex, 64> stripes;
+
+    // Scan the rows of a bucket, newest first, for prefixes that match the
+    // value under the mask.
+    void scan_bucket(list& result, array_index bucket, uint32_t mask,
+        uint32_t value, uint32_t from_height) const;
+
+    // The number of rows in the chunk and its ceiling height.
+    void read_chunk(array_index chunk, size_t& count,
+        uint32_t& ceiling) const;
 
-    // Row entries containing stealth tx data.
+    // Set the number of rows in the chunk and its ceiling height.
+    void write_chunk(array_index chunk, size_t count, uint32_t ceiling);
+
+    // Row entries containing stealth tx data, in chunks of a bucket.
     memory_map rows_file_;
+    record_hash_table_header header_;
     record_manager rows_manager_;
+    record_list rows_;
+
+    // Guards the chunk counts and ceilings.
+    mutable shared_mutex mutex_;
+
+    // Serializes the writers of a bucket.
+    stripes writers_;
 };
 
 } // namespace database
@@ -21,13 +21,17 @@
 
 #include <cstddef>
 #include <memory>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/histogram.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
 #include <bitcoin/database/result/transaction_result.hpp>
 #include <bitcoin/database/primitives/slab_hash_table.hpp>
 #include <bitcoin/database/primitives/slab_manager.hpp>
+#include <bitcoin/database/primitives/slab_open_hash_table.hpp>
 #include <bitcoin/database/unspent_outputs.hpp>
 
 namespace libbitcoin {
@@ -47,9 +51,27 @@ public:
     /// Sentinel for use in tx position to indicate unconfirmed.
     static const size_t unconfirmed;
 
-    /// Construct the database.
+    /// The output of a point, other members are valid only if found.
+    struct output_result
+    {
+        bool found;
+        chain::output output;
+        size_t height;
+        bool coinbase;
+        bool confirmed;
+    };
+
+    typedef std::vector<output_result> output_results;
+
+    /// Construct the database, open addressing must match the store (a
+    /// store of the other kind of table fails open).
+    /// The chained table is resized above max_load keys per hundred buckets.
+    /// The output cache is limited to cache_budget bytes (zero is unlimited).
     transaction_database(const path& map_filename, size_t buckets,
-        size_t expansion, size_t cache_capacity, mutex_ptr mutex=nullptr);
+        size_t expansion, size_t cache_capacity, mutex_ptr mutex=nullptr,
+        bool open_addressing=false, size_t max_load=0, size_t cache_budget=0,
+        eviction_policy cache_policy=eviction_policy::fifo,
+        const mapping_policy& mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~transaction_database();
@@ -76,8 +98,22 @@ public:
         bool& out_coinbase, bool& out_is_confirmed, const chain::output_point& point,
         size_t fork_height, bool require_confirmed) const;
 
+    /// Get the outputs of a batch of points (such as the previous outputs of a
+    /// block), with memory reads overlapped across the batch. Each result
+    /// corresponds to the point at the same position.
+    void get_outputs(output_results& out_results,
+        const chain::output_point::list& points, size_t fork_height,
+        bool require_confirmed) const;
+
+    /// Reserve the table for the given number of transaction stores, which
+    /// the open addressing table requires as it does not grow. Returns false,
+    /// reserving none, if the table cannot hold them.
+    bool reserve(size_t count);
+
+    /// Return a reservation that will not be stored.
+    void release(size_t count);
 
-    /// Store a transaction in the database.
+    /// Store a transaction in the database (within a reservation).
     void store(const chain::transaction& tx, size_t height, size_t position);
 
     /// Update the spender height of the output in the tx store.
@@ -95,26 +131,60 @@ public:
     /// Commit latest inserts.
     void synchronize();
 
+    /// The end of the stored transactions, for a later synchronize.
+    file_offset end() const;
+
+    /// Commit the inserts that precede the end, excluding any stored since.
+    void synchronize(file_offset end);
+
     /// Flush the memory map to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory map.
+    void attach(journal& journal);
+
+    /// Save the output cache, consistent with the store at the top block.
+    bool save_cache(const path& file, const config::checkpoint& top) const;
+
+    /// Load an output cache saved at the same top block (file is removed).
+    bool load_cache(const path& file, const config::checkpoint& top);
+
+    /// The latencies of get, get_output and spend.
+    latency::list latencies() const;
+
+    /// Clear the latencies.
+    void reset_latencies();
+
 private:
     typedef slab_hash_table<hash_digest> slab_map;
+    typedef slab_open_hash_table<hash_digest> slab_open_map;
 
     memory_ptr find(const hash_digest& hash, size_t maximum_height,
         bool require_confirmed) const;
+    void prefetch_bucket(const hash_digest& hash) const;
+    void prefetch_row(const hash_digest& hash) const;
 
     // The starting size of the hash table, used by create.
     const size_t initial_map_file_size_;
 
-    // Hash table used for looking up txs by hash.
+    // Select the open addressing table over the chained table.
+    const bool open_addressing_;
+
+    // Hash table used for looking up txs by hash (one of the two maps).
     memory_map lookup_file_;
     slab_hash_table_header lookup_header_;
     slab_manager lookup_manager_;
     slab_map lookup_map_;
+    slab_open_map lookup_open_map_;
 
     // This is thread safe, and as a cache is mutable.
     mutable unspent_outputs cache_;
+
+    // These are thread safe, and as statistics are mutable. They sample the
+    // operations, as these are the hottest paths of validation.
+    mutable histogram get_latency_;
+    mutable histogram get_output_latency_;
+    histogram spend_latency_;
 };
 
 } // namespace database
@@ -24,10 +24,12 @@
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/journal.hpp>
 #include <bitcoin/database/memory/memory_map.hpp>
 #include <bitcoin/database/result/transaction_result.hpp>
 #include <bitcoin/database/primitives/slab_hash_table.hpp>
 #include <bitcoin/database/primitives/slab_manager.hpp>
+#include <bitcoin/database/primitives/slab_open_hash_table.hpp>
 #include <bitcoin/database/unspent_outputs.hpp>
 
 namespace libbitcoin {
@@ -47,9 +49,12 @@ public:
     /// Sentinel for use in tx position to indicate unconfirmed.
     static const size_t unconfirmed;
 
-    /// Construct the database.
+    /// Construct the database, open addressing must match the store (a
+    /// store of the other kind of table fails open).
     transaction_unconfirmed_database(const path& map_filename, size_t buckets,
-        size_t expansion, mutex_ptr mutex=nullptr);
+        size_t expansion, mutex_ptr mutex=nullptr,
+        bool open_addressing=false,
+        const mapping_policy& mapping=mapping_policy());
 
     /// Close the database (all threads must first be stopped).
     ~transaction_unconfirmed_database();
@@ -71,9 +76,18 @@ public:
     //     bool& out_coinbase, const chain::output_point& point,
     //     size_t fork_height, bool require_confirmed) const;
 
-    /// Store a transaction in the database.
+    /// Reserve the table for the given number of transaction stores, which
+    /// the open addressing table requires as it does not grow. Returns false,
+    /// reserving none, if the table cannot hold them.
+    bool reserve(size_t count);
+
+    /// Store a transaction in the database (within a reservation).
     void store(const chain::transaction& tx);
 
+    /// Store a stored transaction in the database without deserializing it
+    /// (within a reservation).
+    void store(const transaction_result& result);
+
     // /// Update the spender height of the output in the tx store.
     // bool spend(const chain::output_point& point, size_t spender_height);
 
@@ -92,6 +106,9 @@ public:
     /// Flush the memory map to disk.
     bool flush() const;
 
+    /// Journal the writes to the memory map.
+    void attach(journal& journal);
+
     bool unlink(hash_digest const& hash);
     bool unlink_if_exists(hash_digest const& hash);
 
@@ -100,7 +117,7 @@ public:
 //    void for_each(UnaryFunction f) const;
     template <typename UnaryFunction>
     void for_each(UnaryFunction f) const {
-        lookup_map_.for_each([&f](memory_ptr slab){
+        const auto handler = [&f](memory_ptr slab){
             if (slab != nullptr) {
                 transaction_result res(slab);
                 auto tx = res.transaction();
@@ -110,22 +127,32 @@ public:
                 std::cout << "transaction_unconfirmed_database::for_each nullptr slab\n";
             }
             return true;
-        });
+        };
+
+        if (open_addressing_)
+            lookup_open_map_.for_each(handler);
+        else
+            lookup_map_.for_each(handler);
     }
 
 private:
     typedef slab_hash_table<hash_digest> slab_map;
+    typedef slab_open_hash_table<hash_digest> slab_open_map;
 
     memory_ptr find(const hash_digest& hash) const;
 
     // The starting size of the hash table, used by create.
     const size_t initial_map_file_size_;
 
-    // Hash table used for looking up txs by hash.
+    // Select the open addressing table over the chained table.
+    const bool open_addressing_;
+
+    // Hash table used for looking up txs by hash (one of the two maps).
     memory_map lookup_file_;
     slab_hash_table_header lookup_header_;
     slab_manager lookup_manager_;
     slab_map lookup_map_;
+    slab_open_map lookup_open_map_;
 };
 
 } // namespace database
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_DECODED_TRANSACTION_HPP
+#define LIBBITCOIN_DATABASE_DECODED_TRANSACTION_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/define.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+/// The payment addresses and stealth rows of a transaction, extracted once
+/// for history and stealth indexing and for their removal.
+/// This class is not thread safe.
+class BCD_API decoded_transaction
+{
+public:
+    /// An input or output index and the hash of its payment address.
+    typedef std::pair<uint32_t, short_hash> address;
+    typedef std::vector<address> addresses;
+
+    /// The prefix and row of a stealth output pair.
+    struct stealth
+    {
+        uint32_t prefix;
+        chain::stealth_compact row;
+    };
+
+    typedef std::vector<stealth> stealths;
+
+    /// Decode the addresses of the inputs (unless coinbase) and outputs.
+    explicit decoded_transaction(const chain::transaction& tx);
+    decoded_transaction(const hash_digest& hash,
+        const chain::input::list& inputs, const chain::output::list& outputs,
+        bool coinbase);
+
+    /// The transaction hash.
+    const hash_digest& hash() const;
+
+    /// Inputs with an extractable address, ordered by index.
+    const addresses& inputs() const;
+
+    /// Outputs with an extractable address, ordered by index.
+    const addresses& outputs() const;
+
+    /// Stealth rows, ordered by the index of their ephemeral key output.
+    const stealths& stealth_rows() const;
+
+private:
+    void decode_inputs(const chain::input::list& inputs);
+    void decode_outputs(const chain::output::list& outputs);
+
+    const hash_digest hash_;
+    addresses inputs_;
+    addresses outputs_;
+    stealths stealths_;
+};
+
+} // namespace database
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_HISTOGRAM_HPP
+#define LIBBITCOIN_DATABASE_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/define.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+/// This class is thread safe and lock free.
+/// A log-linear histogram of latencies in microseconds. Each power of two
+/// range is divided into linear buckets, so that a recorded value is resolved
+/// to within 1/32 (about 3%) at any magnitude. On hot paths the timers may
+/// sample one in every sample_rate operations, which limits both the clock
+/// reads and the writes to the shared counters.
+class BCD_API histogram
+  : noncopyable
+{
+public:
+    /// The number of low bits of a value resolved linearly.
+    static BC_CONSTEXPR size_t sub_bucket_bits = 5;
+
+    /// The number of linear buckets per power of two.
+    static BC_CONSTEXPR size_t sub_buckets = size_t(1) << sub_bucket_bits;
+
+    /// The total number of buckets, covering the full 64 bit range.
+    static BC_CONSTEXPR size_t buckets = (64 - sub_bucket_bits + 1) *
+        sub_buckets;
+
+    /// A copy of the histogram at a point in time.
+    struct BCD_API snapshot
+    {
+        /// The mean of the recorded values.
+        uint64_t mean() const;
+
+        /// The value at or below which the percentile (0..100) of values lie.
+        /// This is the upper bound of the bucket, limited to the maximum.
+        uint64_t percentile(double percent) const;
+
+        /// The estimated number of operations, the count of sampled values
+        /// scaled by the sample rate.
+        uint64_t operations() const;
+
+        /// The number of recorded (sampled) values.
+        uint64_t count;
+
+        /// One in every sample_rate operations is recorded.
+        uint64_t sample_rate;
+
+        uint64_t total;
+        uint64_t minimum;
+        uint64_t maximum;
+        std::vector<uint64_t> counts;
+    };
+
+    /// Records the elapsed time since construction on destruct, if the
+    /// timer is sampled.
+    class BCD_API timer
+      : noncopyable
+    {
+    public:
+        timer(histogram& histogram);
+        ~timer();
+
+    private:
+        histogram& histogram_;
+        const bool sampled_;
+        const asio::time_point start_;
+    };
+
+    /// The bucket of the value.
+    static size_t bucket(uint64_t value);
+
+    /// The largest value of the bucket.
+    static uint64_t upper(size_t bucket);
+
+    /// Timers sample one in every sample_rate (a power of two) operations.
+    histogram(size_t sample_rate=1);
+
+    /// True if a timer of the current operation should record.
+    bool sample() const;
+
+    /// Record a latency in microseconds.
+    void record(uint64_t microseconds);
+
+    /// Record the latency from start to now.
+    void record(const asio::time_point& start);
+
+    /// Copy the counts, values recorded concurrently may be partially counted.
+    snapshot capture() const;
+
+    /// Clear the counts.
+    void reset();
+
+private:
+    // Each of the powers of two from 2^sub_bucket_bits (and the values
+    // below it) is divided into sub_buckets buckets.
+    typedef std::array<std::atomic<uint64_t>, buckets> counters;
+
+    const size_t sample_mask_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> minimum_;
+    std::atomic<uint64_t> maximum_;
+    counters counts_;
+};
+
+/// A named histogram snapshot.
+struct BCD_API latency
+{
+    typedef std::vector<latency> list;
+
+    std::string name;
+    histogram::snapshot snapshot;
+};
+
+/// Write the count, mean, percentiles and maximum of the latency. The count
+/// of a sampled latency is written with its sample rate and the estimated
+/// number of operations.
+BCD_API std::ostream& operator<<(std::ostream& output,
+    const latency& latency);
+
+} // namespace database
+} // namespace libbitcoin
+
+#endif
@@ -19,8 +19,11 @@
 #ifndef LIBBITCOIN_DATABASE_HASH_TABLE_HEADER_IPP
 #define LIBBITCOIN_DATABASE_HASH_TABLE_HEADER_IPP
 
+#include <atomic>
 #include <cstring>
 #include <stdexcept>
+#include <type_traits>
+#include <boost/endian/conversion.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 
@@ -36,16 +39,49 @@ template <typename IndexType, typename ValueType>
 const ValueType hash_table_header<IndexType, ValueType>::empty =
     (ValueType)empty_fill;
 
+template <typename IndexType, typename ValueType>
+BC_CONSTEXPR uint32_t hash_table_header<IndexType, ValueType>::version;
+
+template <typename IndexType, typename ValueType>
+BC_CONSTEXPR file_offset
+    hash_table_header<IndexType, ValueType>::relocation_offset;
+
+template <typename IndexType, typename ValueType>
+BC_CONSTEXPR file_offset hash_table_header<IndexType, ValueType>::items_offset;
+
+template <typename IndexType, typename ValueType>
+BC_CONSTEXPR size_t hash_table_header<IndexType, ValueType>::relocation_size;
+
+template <typename IndexType, typename ValueType>
+hash_table_header<IndexType, ValueType>::hash_table_header(memory_map& file,
+    IndexType buckets, table_kind kind)
+  : hash_table_header(file, buckets, kind, 0)
+{
+}
+
+template <typename IndexType, typename ValueType>
+hash_table_header<IndexType, ValueType>::hash_table_header(
+    const hash_table_header& other, IndexType buckets, file_offset offset)
+  : hash_table_header(other.file_, buckets, other.kind_, offset)
+{
+}
+
 template <typename IndexType, typename ValueType>
 hash_table_header<IndexType, ValueType>::hash_table_header(memory_map& file,
-    IndexType buckets)
-  : file_(file), buckets_(buckets)
+    IndexType buckets, table_kind kind, file_offset offset)
+  : file_(file), buckets_(buckets), kind_(kind), offset_(offset)
 {
+    BITCOIN_ASSERT_MSG(offset % sizeof(ValueType) == 0,
+        "Unaligned hash table header.");
+
     BITCOIN_ASSERT_MSG(empty == (ValueType)empty_fill,
         "Unexpected value for empty sentinel.");
 
     static_assert(std::is_unsigned<ValueType>::value,
         "Hash table header requires unsigned type.");
+
+    static_assert(sizeof(std::atomic<ValueType>) == sizeof(ValueType),
+        "Hash table header requires atomic access to an unpadded value.");
 }
 
 template <typename IndexType, typename ValueType>
@@ -58,16 +94,29 @@ bool hash_table_header<IndexType, ValueType>::create()
     // Calculate the minimum file size.
     const auto minimum_file_size = item_position(buckets_);
 
+    // A header within the payload is allocated by the payload manager, so
+    // the file must not be resized (which could reduce its logical size).
+    if (offset_ != 0 && minimum_file_size > file_.size())
+        return false;
+
     // The accessor must remain in scope until the end of the block.
-    const auto memory = file_.resize(minimum_file_size);
-    const auto buckets_address = REMAP_ADDRESS(memory);
+    const auto memory = offset_ == 0 ? file_.resize(minimum_file_size) :
+        file_.access();
+    const auto buckets_address = REMAP_ADDRESS(memory) + offset_;
     auto serial = make_unsafe_serializer(buckets_address);
     serial.write_little_endian(buckets_);
+    serial.write_4_bytes_little_endian(version);
+    serial.write_4_bytes_little_endian(static_cast<uint32_t>(kind_));
+
+    // Zeroize the relocation record and any alignment padding.
+    const auto padding = buckets_address + relocation_offset;
+    memset(padding, 0, items_offset - relocation_offset);
 
     // optimized fill implementation
     // This optimization makes it possible to debug full size headers.
-    const auto start = buckets_address + sizeof(IndexType);
+    const auto start = buckets_address + items_offset;
     memset(start, empty_byte, buckets_ * sizeof(ValueType));
+    file_.dirty(offset_, items_offset + buckets_ * sizeof(ValueType));
 
     // rationalized fill implementation
     ////for (IndexType index = 0; index < buckets_; ++index)
@@ -85,15 +134,82 @@ bool hash_table_header<IndexType, ValueType>::start()
     if (minimum_file_size > file_.size())
         return false;
 
-    // The accessor must remain in scope until the end of the block.
-    const auto memory = file_.access();
-    const auto buckets_address = REMAP_ADDRESS(memory);
+    IndexType buckets;
+    uint32_t stored_version;
+    uint32_t stored_kind;
 
     // Does not require atomicity (no concurrency during start).
-    const auto buckets = from_little_endian_unsafe<IndexType>(buckets_address);
+    // The accessor is released at the end of the block, before advising.
+    {
+        const auto memory = file_.access();
+        auto deserial = make_unsafe_deserializer(REMAP_ADDRESS(memory) +
+            offset_);
+        buckets = deserial.template read_little_endian<IndexType>();
+        stored_version = deserial.read_4_bytes_little_endian();
+        stored_kind = deserial.read_4_bytes_little_endian();
+    }
+
+    // The store was written with another layout.
+    if (stored_version != version)
+        return false;
+
+    // The store was written with another kind of table.
+    if (stored_kind != static_cast<uint32_t>(kind_))
+        return false;
 
     // If buckets_ == 0 we trust what is read from the file.
-    return buckets_ == 0 || buckets == buckets_;
+    if (buckets_ != 0 && buckets != buckets_)
+        return false;
+
+    // The file's header hints apply to the leading bucket array.
+    if (offset_ == 0)
+        file_.advise_header(minimum_file_size);
+
+    return true;
+}
+
+template <typename IndexType, typename ValueType>
+bool hash_table_header<IndexType, ValueType>::relocated() const
+{
+    const auto value = read_relocation();
+    return value.offset != 0 || value.target_offset != 0;
+}
+
+template <typename IndexType, typename ValueType>
+typename hash_table_header<IndexType, ValueType>::relocation
+hash_table_header<IndexType, ValueType>::read_relocation() const
+{
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = file_.access();
+    auto deserial = make_unsafe_deserializer(REMAP_ADDRESS(memory) + offset_ +
+        relocation_offset);
+
+    relocation value;
+    value.offset = deserial.template read_little_endian<file_offset>();
+    value.buckets = deserial.template read_little_endian<IndexType>();
+    value.target_offset = deserial.template read_little_endian<file_offset>();
+    value.target_buckets = deserial.template read_little_endian<IndexType>();
+    value.migrated = deserial.template read_little_endian<IndexType>();
+    return value;
+}
+
+template <typename IndexType, typename ValueType>
+void hash_table_header<IndexType, ValueType>::write_relocation(
+    const relocation& value)
+{
+    BITCOIN_ASSERT(offset_ == 0);
+
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = file_.access();
+    auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory) +
+        relocation_offset);
+
+    serial.template write_little_endian<file_offset>(value.offset);
+    serial.template write_little_endian<IndexType>(value.buckets);
+    serial.template write_little_endian<file_offset>(value.target_offset);
+    serial.template write_little_endian<IndexType>(value.target_buckets);
+    serial.template write_little_endian<IndexType>(value.migrated);
+    file_.dirty(relocation_offset, relocation_size);
 }
 
 template <typename IndexType, typename ValueType>
@@ -106,11 +222,23 @@ ValueType hash_table_header<IndexType, ValueType>::read(IndexType index) const
     const auto memory = file_.access();
     const auto value_address = REMAP_ADDRESS(memory) + item_position(index);
 
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    shared_lock lock(mutex_);
-    return from_little_endian_unsafe<ValueType>(value_address);
-    ///////////////////////////////////////////////////////////////////////////
+    // The item is aligned, so this is a single atomic load (no lock).
+    // Acquire pairs with the release of write so that the linked row, which
+    // was populated before the bucket was written, is visible to the reader.
+    const auto value = reinterpret_cast<const std::atomic<ValueType>*>(
+        value_address)->load(std::memory_order_acquire);
+
+    return boost::endian::little_to_native(value);
+}
+
+template <typename IndexType, typename ValueType>
+void hash_table_header<IndexType, ValueType>::prefetch(IndexType index) const
+{
+    BITCOIN_ASSERT(index < buckets_);
+
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = file_.access();
+    PREFETCH(REMAP_ADDRESS(memory) + item_position(index));
 }
 
 template <typename IndexType, typename ValueType>
@@ -123,13 +251,36 @@ void hash_table_header<IndexType, ValueType>::write(IndexType index,
     // The accessor must remain in scope until the end of the block.
     const auto memory = file_.access();
     const auto value_address = REMAP_ADDRESS(memory) + item_position(index);
-    auto serial = make_unsafe_serializer(value_address);
 
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    unique_lock lock(mutex_);
-    serial.template write_little_endian<ValueType>(value);
-    ///////////////////////////////////////////////////////////////////////////
+    // The item is aligned, so this is a single atomic store (no lock).
+    // Concurrent writers of the same item must be serialized by the caller.
+    reinterpret_cast<std::atomic<ValueType>*>(value_address)->store(
+        boost::endian::native_to_little(value), std::memory_order_release);
+    file_.dirty(item_position(index), sizeof(ValueType));
+}
+
+template <typename IndexType, typename ValueType>
+bool hash_table_header<IndexType, ValueType>::compare_exchange(
+    IndexType index, ValueType expected, ValueType value)
+{
+    // This is not runtime safe but test is avoided as an optimization.
+    BITCOIN_ASSERT(index < buckets_);
+
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = file_.access();
+    const auto value_address = REMAP_ADDRESS(memory) + item_position(index);
+
+    // This allows concurrent writers of the same item without a lock.
+    auto little = boost::endian::native_to_little(expected);
+    const auto exchanged = reinterpret_cast<std::atomic<ValueType>*>(
+        value_address)->compare_exchange_strong(little,
+            boost::endian::native_to_little(value), std::memory_order_acq_rel,
+            std::memory_order_acquire);
+
+    if (exchanged)
+        file_.dirty(item_position(index), sizeof(ValueType));
+
+    return exchanged;
 }
 
 template <typename IndexType, typename ValueType>
@@ -138,11 +289,17 @@ IndexType hash_table_header<IndexType, ValueType>::size() const
     return buckets_;
 }
 
+template <typename IndexType, typename ValueType>
+file_offset hash_table_header<IndexType, ValueType>::offset() const
+{
+    return offset_;
+}
+
 template <typename IndexType, typename ValueType>
 file_offset hash_table_header<IndexType, ValueType>::item_position(
     IndexType index) const
 {
-    return sizeof(IndexType) + index * sizeof(ValueType);
+    return offset_ + items_offset + index * sizeof(ValueType);
 }
 
 } // namespace database
@@ -0,0 +1,306 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_RECORD_CHUNK_MULTIMAP_IPP
+#define LIBBITCOIN_DATABASE_RECORD_CHUNK_MULTIMAP_IPP
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/memory/memory.hpp>
+#include "../impl/remainder.ipp"
+
+namespace libbitcoin {
+namespace database {
+
+// The count precedes the rows, following the list link.
+static BC_CONSTEXPR size_t chunk_count_size = sizeof(uint32_t);
+
+template <typename KeyType>
+BC_CONSTEXPR size_t record_chunk_multimap<KeyType>::lock_stripes;
+
+template <typename KeyType>
+record_chunk_multimap<KeyType>::record_chunk_multimap(
+    record_hash_table_type& map, record_manager& chunks, size_t row_size,
+    size_t chunk_rows, size_t summary_size)
+  : map_(map), manager_(chunks), chunks_(chunks), row_size_(row_size),
+    chunk_rows_(chunk_rows), summary_size_(summary_size)
+{
+    BITCOIN_ASSERT(chunk_rows != 0 && chunk_rows <= max_uint32);
+    BITCOIN_ASSERT(chunks.record_size() ==
+        chunk_record_size(row_size, chunk_rows));
+}
+
+template <typename KeyType>
+array_index record_chunk_multimap<KeyType>::lookup(const KeyType& key) const
+{
+    const auto start_info = map_.find(key);
+
+    if (!start_info)
+        return record_list::empty;
+
+    const auto address = REMAP_ADDRESS(start_info);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return from_little_endian_unsafe<array_index>(address);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+data_chunk record_chunk_multimap<KeyType>::summary(const KeyType& key) const
+{
+    const auto start_info = map_.find(key);
+
+    if (!start_info)
+        return{};
+
+    const auto address = REMAP_ADDRESS(start_info) + sizeof(array_index);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return data_chunk(address, address + summary_size_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+array_index record_chunk_multimap<KeyType>::next(array_index chunk) const
+{
+    return chunks_.next(chunk);
+}
+
+template <typename KeyType>
+size_t record_chunk_multimap<KeyType>::count(array_index chunk) const
+{
+    const auto memory = chunks_.get(chunk);
+    const auto address = REMAP_ADDRESS(memory);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    return from_little_endian_unsafe<uint32_t>(address);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+memory_ptr record_chunk_multimap<KeyType>::get(array_index chunk,
+    size_t position) const
+{
+    BITCOIN_ASSERT(position < chunk_rows_);
+    auto memory = chunks_.get(chunk);
+    REMAP_INCREMENT(memory, chunk_count_size + position * row_size_);
+    return memory;
+}
+
+// A row is written before it is counted, so readers never observe a partial
+// row. Rows of distinct keys are written concurrently.
+template <typename KeyType>
+void record_chunk_multimap<KeyType>::add_row(const KeyType& key,
+    write_function write, update_function update)
+{
+    // Critical Section (key)
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock writer(writers_[remainder(key, lock_stripes)]);
+
+    const auto start_info = map_.find(key);
+
+    if (!start_info)
+    {
+        create_new(key, write, update);
+        return;
+    }
+
+    const auto address = REMAP_ADDRESS(start_info);
+
+    mutex_.lock_shared();
+    const auto old_begin = from_little_endian_unsafe<array_index>(address);
+    mutex_.unlock_shared();
+
+    const auto rows = count(old_begin);
+
+    if (rows < chunk_rows_)
+    {
+        const auto memory = get(old_begin, rows);
+        const auto data = REMAP_ADDRESS(memory);
+        auto serial_row = make_unsafe_serializer(data);
+        serial_row.write_delegated(write);
+        manager_.dirty(data, row_size_);
+        set_count(old_begin, rows + 1);
+    }
+    else
+    {
+        const auto new_begin = create_chunk(old_begin, write);
+
+        // The chunks and start_info remap safe pointers are in distinct files.
+        auto serial_link = make_unsafe_serializer(address);
+
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        unique_lock lock(mutex_);
+        serial_link.template write_little_endian<array_index>(new_begin);
+        map_.dirty(address, sizeof(array_index));
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    if (!update || summary_size_ == 0)
+        return;
+
+    const auto summary = address + sizeof(array_index);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    update(summary);
+    map_.dirty(summary, summary_size_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// An emptied chunk is unlinked and its record is not reused.
+template <typename KeyType>
+bool record_chunk_multimap<KeyType>::delete_last_row(const KeyType& key,
+    revert_function revert)
+{
+    // Critical Section (key)
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock writer(writers_[remainder(key, lock_stripes)]);
+
+    auto start_info = map_.find(key);
+
+    if (!start_info)
+        return false;
+
+    const auto address = REMAP_ADDRESS(start_info);
+
+    mutex_.lock_shared();
+    const auto old_begin = from_little_endian_unsafe<array_index>(address);
+    mutex_.unlock_shared();
+
+    BITCOIN_ASSERT(old_begin != record_list::empty);
+    const auto rows = count(old_begin);
+    BITCOIN_ASSERT(rows != 0);
+    auto deleted = get(old_begin, rows - 1);
+
+    if (rows > 1)
+    {
+        set_count(old_begin, rows - 1);
+        revert_summary(address, revert, deleted, get(old_begin, rows - 2));
+        return true;
+    }
+
+    const auto new_begin = chunks_.next(old_begin);
+
+    if (new_begin == record_list::empty)
+    {
+        // Free existing remap pointers to prevent deadlock in map_.unlink.
+        deleted = nullptr;
+        start_info = nullptr;
+
+        return map_.unlink(key);
+    }
+
+    const auto newest = get(new_begin, count(new_begin) - 1);
+    auto serial = make_unsafe_serializer(address);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+    serial.template write_little_endian<array_index>(new_begin);
+    map_.dirty(address, sizeof(array_index));
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    revert_summary(address, revert, deleted, newest);
+    return true;
+}
+
+template <typename KeyType>
+array_index record_chunk_multimap<KeyType>::create_chunk(array_index next,
+    write_function write)
+{
+    // The chunk is not linked until it is written, so it is not locked.
+    const auto chunk = chunks_.insert(next);
+    const auto memory = chunks_.get(chunk);
+    const auto data = REMAP_ADDRESS(memory);
+    auto serial = make_unsafe_serializer(data);
+    serial.write_4_bytes_little_endian(1);
+    serial.write_delegated(write);
+    return chunk;
+}
+
+template <typename KeyType>
+void record_chunk_multimap<KeyType>::create_new(const KeyType& key,
+    write_function write, update_function update)
+{
+    // Create a new first chunk for the key.
+    const auto first = create_chunk(record_list::empty, write);
+
+    data_chunk summary(summary_size_, 0);
+    if (update && summary_size_ != 0)
+        update(summary.data());
+
+    const auto write_start_info = [&](serializer<uint8_t*>& serial)
+    {
+        //*********************************************************************
+        serial.template write_little_endian<array_index>(first);
+        serial.write_bytes(summary);
+        //*********************************************************************
+    };
+
+    // Make the map point to the new chunk.
+    map_.store(key, write_start_info);
+}
+
+template <typename KeyType>
+void record_chunk_multimap<KeyType>::revert_summary(uint8_t* start_info,
+    revert_function revert, memory_ptr deleted, memory_ptr newest)
+{
+    if (!revert || summary_size_ == 0)
+        return;
+
+    const auto summary = start_info + sizeof(array_index);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    revert(summary, REMAP_ADDRESS(deleted), REMAP_ADDRESS(newest));
+    map_.dirty(summary, summary_size_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+void record_chunk_multimap<KeyType>::set_count(array_index chunk,
+    size_t count)
+{
+    const auto memory = chunks_.get(chunk);
+    const auto address = REMAP_ADDRESS(memory);
+    auto serial = make_unsafe_serializer(address);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    serial.write_4_bytes_little_endian(static_cast<uint32_t>(count));
+    manager_.dirty(address, chunk_count_size);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace database
+} // namespace libbitcoin
+
+#endif
@@ -19,7 +19,12 @@
 #ifndef LIBBITCOIN_DATABASE_RECORD_HASH_TABLE_IPP
 #define LIBBITCOIN_DATABASE_RECORD_HASH_TABLE_IPP
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
 #include <string>
+#include <utility>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include "../impl/record_row.ipp"
@@ -28,11 +33,57 @@
 namespace libbitcoin {
 namespace database {
 
+static_assert(record_hash_table_header::items_offset ==
+    record_hash_table_header_size(0), "Invalid record hash table header size.");
+
+template <typename KeyType>
+BC_CONSTEXPR size_t record_hash_table<KeyType>::migration_step;
+
 template <typename KeyType>
 record_hash_table<KeyType>::record_hash_table(
-    record_hash_table_header& header, record_manager& manager)
-  : header_(header), manager_(manager)
+    record_hash_table_header& header, record_manager& manager,
+    size_t max_load)
+  : header_(header),
+    manager_(manager),
+    max_load_(max_load),
+    keys_(0),
+    current_(&header),
+    target_(nullptr),
+    migrated_(0)
 {
+    for (auto& version: versions_)
+        version.store(0);
+}
+
+// Resume a resize recorded by a previous session.
+template <typename KeyType>
+bool record_hash_table<KeyType>::start()
+{
+    if (header_.relocated())
+    {
+        const auto record = header_.read_relocation();
+        const auto current = relocate(record.offset, record.buckets);
+
+        if (current == nullptr)
+            return false;
+
+        current_.store(current);
+
+        if (record.target_offset != 0)
+        {
+            const auto target = relocate(record.target_offset,
+                record.target_buckets);
+
+            if (target == nullptr || record.migrated >= record.buckets)
+                return false;
+
+            migrated_.store(record.migrated);
+            target_.store(target);
+        }
+    }
+
+    keys_.store(estimate());
+    return true;
 }
 
 // This is not limited to storing unique key values. If duplicate keyed values
@@ -48,39 +99,186 @@ void record_hash_table<KeyType>::store(const KeyType& key,
 
     // For a given key in this hash table new item creation must be atomic from
     // read of the old value to write of the new. Otherwise concurrent write of
-    // hash table conflicts will corrupt the key's record row. Unfortunmately
-    // there is no efficient way to lock a given bucket, so we lock across
-    // all buckets. But given that this protection is required for concurrent
+    // hash table conflicts will corrupt the key's record row. So we lock the
+    // stripe of the key's bucket, which also excludes migration of the
+    // bucket. But given that this protection is required for concurrent
     // write but not for read-while-write (slock) we need not lock read.
     ///////////////////////////////////////////////////////////////////////////
     // Critical Section.
-    mutex_.lock();
+    auto& mutex = lock_bucket(key);
+
+    array_index index;
+    auto& header = locate(key, index);
 
     // Link new record.next to current first record.
-    record.link(read_bucket_value(key));
+    record.link(header.read(index));
 
     // Link header to new record as the new first.
-    link(key, position);
+    header.write(index, position);
 
-    mutex_.unlock();
+    mutex.unlock();
     ///////////////////////////////////////////////////////////////////////////
+
+    ++keys_;
+    grow();
 }
 
 // This is limited to returning the first of multiple matching key values.
+// A found item is always valid, as items are never moved or freed. A miss is
+// valid only if no bucket of the key's stripe was migrated during the search.
 template <typename KeyType>
 memory_ptr record_hash_table<KeyType>::find(const KeyType& key) const
+{
+    const auto stripe_index = stripe(key);
+    const auto& version = versions_[stripe_index];
+
+    while (true)
+    {
+        const auto start = version.load(std::memory_order_acquire);
+
+        // Wait for the migration of a bucket of this stripe to complete.
+        if (start % 2 != 0)
+        {
+            mutexes_[stripe_index].lock_shared();
+            mutexes_[stripe_index].unlock_shared();
+            continue;
+        }
+
+        array_index index;
+        const auto& header = locate(key, index);
+        const auto position = find_item(header, index, key);
+
+        if (position != header.empty)
+        {
+            const record_row<KeyType> item(manager_, position);
+            return item.data();
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (version.load(std::memory_order_relaxed) == start)
+            return nullptr;
+    }
+}
+
+// This is limited to unlinking the first of multiple matching key values.
+template <typename KeyType>
+bool record_hash_table<KeyType>::unlink(const KeyType& key)
+{
+    // Unlink must not interleave with a store into the same bucket.
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section.
+    auto& mutex = lock_bucket(key);
+
+    array_index index;
+    auto& header = locate(key, index);
+    const auto result = unlink_item(header, index, key);
+
+    mutex.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    if (result)
+        --keys_;
+
+    return result;
+}
+
+template <typename KeyType>
+void record_hash_table<KeyType>::dirty(const uint8_t* address,
+    size_t size) const
+{
+    manager_.dirty(address, size);
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::migrate(size_t count)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(resize_mutex_);
+    return migrate_locked(count);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::buckets() const
+{
+    return current_.load(std::memory_order_acquire)->size();
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::keys() const
+{
+    return keys_.load();
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::load() const
+{
+    const auto buckets = this->buckets();
+    return buckets == 0 ? 0 : keys() * 100 / buckets;
+}
+
+template <typename KeyType>
+bool record_hash_table<KeyType>::resizing() const
+{
+    return target_.load(std::memory_order_acquire) != nullptr;
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::migrated() const
+{
+    return resizing() ? migrated_.load(std::memory_order_acquire) : 0;
+}
+
+// private
+// ----------------------------------------------------------------------------
+
+// The original bucket count divides that of each resized array, so the items
+// of a bucket and of the two buckets it splits into descend from the same
+// original bucket and share a stripe.
+template <typename KeyType>
+size_t record_hash_table<KeyType>::stripe(const KeyType& key) const
+{
+    return remainder(key, header_.size()) % lock_stripes;
+}
+
+// The target is loaded before the current array, because it is cleared after
+// the current array is replaced. A reader that observes a mixed state also
+// observes a stripe version change, a writer holds the stripe.
+template <typename KeyType>
+record_hash_table_header& record_hash_table<KeyType>::locate(
+    const KeyType& key, array_index& index) const
+{
+    const auto target = target_.load(std::memory_order_acquire);
+    const auto current = current_.load(std::memory_order_acquire);
+    index = remainder(key, current->size());
+
+    if (target != nullptr && index < migrated_.load(std::memory_order_acquire))
+    {
+        index = remainder(key, target->size());
+        return *target;
+    }
+
+    return *current;
+}
+
+template <typename KeyType>
+array_index record_hash_table<KeyType>::find_item(
+    const record_hash_table_header& header, array_index index,
+    const KeyType& key) const
 {
     // Find start item...
-    auto current = read_bucket_value(key);
+    auto current = header.read(index);
 
     // Iterate through list...
-    while (current != header_.empty)
+    while (current != header.empty)
     {
         const record_row<KeyType> item(manager_, current);
 
-        // Found, return data.
+        // Found.
         if (item.compare(key))
-            return item.data();
+            return current;
 
         const auto previous = current;
         current = item.next_index();
@@ -90,24 +288,28 @@ memory_ptr record_hash_table<KeyType>::find(const KeyType& key) const
         // So we must return gracefully vs. looping forever.
         // A parallel write operation cannot safely use this call.
         if (previous == current)
-            return nullptr;
+            return header.empty;
     }
 
-    return nullptr;
+    return header.empty;
 }
 
-// This is limited to unlinking the first of multiple matching key values.
 template <typename KeyType>
-bool record_hash_table<KeyType>::unlink(const KeyType& key)
+bool record_hash_table<KeyType>::unlink_item(
+    record_hash_table_header& header, array_index index, const KeyType& key)
 {
     // Find start item...
-    const auto begin = read_bucket_value(key);
+    const auto begin = header.read(index);
+
+    if (begin == header.empty)
+        return false;
+
     const record_row<KeyType> begin_item(manager_, begin);
 
     // If start item has the key then unlink from buckets.
     if (begin_item.compare(key))
     {
-        link(key, begin_item.next_index());
+        header.write(index, begin_item.next_index());
         return true;
     }
 
@@ -116,7 +318,7 @@ bool record_hash_table<KeyType>::unlink(const KeyType& key)
     auto current = begin_item.next_index();
 
     // Iterate through list...
-    while (current != header_.empty)
+    while (current != header.empty)
     {
         const record_row<KeyType> item(manager_, current);
 
@@ -141,26 +343,32 @@ bool record_hash_table<KeyType>::unlink(const KeyType& key)
 }
 
 template <typename KeyType>
-array_index record_hash_table<KeyType>::bucket_index(const KeyType& key) const
+size_t record_hash_table<KeyType>::count_items(
+    const record_hash_table_header& header, array_index index) const
 {
-    const auto bucket = remainder(key, header_.size());
-    BITCOIN_ASSERT(bucket < header_.size());
-    return bucket;
-}
+    size_t count = 0;
+    auto current = header.read(index);
 
-template <typename KeyType>
-array_index record_hash_table<KeyType>::read_bucket_value(
-    const KeyType& key) const
-{
-    auto value = header_.read(bucket_index(key));
-    static_assert(sizeof(value) == sizeof(array_index), "Invalid size");
-    return value;
+    while (current != header.empty)
+    {
+        const record_row<KeyType> item(manager_, current);
+        const auto previous = current;
+        current = item.next_index();
+        ++count;
+
+        if (previous == current)
+            break;
+    }
+
+    return count;
 }
 
 template <typename KeyType>
-void record_hash_table<KeyType>::link(const KeyType& key, array_index begin)
+shared_mutex& record_hash_table<KeyType>::lock_bucket(const KeyType& key)
 {
-    header_.write(bucket_index(key), begin);
+    auto& mutex = mutexes_[stripe(key)];
+    mutex.lock();
+    return mutex;
 }
 
 template <typename KeyType>
@@ -172,6 +380,210 @@ void record_hash_table<KeyType>::release(const ListItem& item,
     previous_item.write_next_index(item.next_index());
 }
 
+// Resize
+// ----------------------------------------------------------------------------
+
+template <typename KeyType>
+void record_hash_table<KeyType>::grow()
+{
+    if (max_load_ == 0 || (!resizing() && load() <= max_load_))
+        return;
+
+    // Only one writer migrates at a time, the others do not wait for it.
+    if (!resize_mutex_.try_lock())
+        return;
+
+    if (resizing() || (load() > max_load_ && begin_resize()))
+        migrate_locked(migration_step);
+
+    resize_mutex_.unlock();
+}
+
+// The target array is allocated as records, so the arrays replaced by
+// resizing are not reclaimed. The original header remains as the record.
+template <typename KeyType>
+bool record_hash_table<KeyType>::begin_resize()
+{
+    static BC_CONSTEXPR auto alignment = sizeof(array_index);
+    const auto buckets = current_.load(std::memory_order_acquire)->size();
+
+    // The bucket count is limited by the index type.
+    if (buckets == 0 || header_.size() == 0 ||
+        buckets > std::numeric_limits<array_index>::max() / 2)
+        return false;
+
+    // Allocate the target array as whole records, with room to align.
+    const array_index target_buckets = buckets * 2;
+    const auto size = record_hash_table_header_size(target_buckets) +
+        alignment;
+    const auto record_size = manager_.record_size();
+    const auto records = (size + record_size - 1) / record_size;
+    const auto unaligned = manager_.offset(manager_.new_records(records));
+    const auto offset = (unaligned + alignment - 1) / alignment * alignment;
+
+    header_ptr target(new record_hash_table_header(header_, target_buckets,
+        offset));
+
+    if (!target->create())
+        return false;
+
+    headers_.push_back(std::move(target));
+    migrated_.store(0, std::memory_order_release);
+    target_.store(headers_.back().get(), std::memory_order_release);
+    return true;
+}
+
+template <typename KeyType>
+size_t record_hash_table<KeyType>::migrate_locked(size_t count)
+{
+    const auto target = target_.load(std::memory_order_acquire);
+
+    if (target == nullptr)
+        return 0;
+
+    const auto current = current_.load(std::memory_order_acquire);
+    const auto buckets = current->size();
+    const auto first = migrated_.load(std::memory_order_acquire);
+    const auto last = static_cast<array_index>(
+        std::min<size_t>(buckets, first + count));
+
+    for (auto index = first; index < last; ++index)
+        split(*current, *target, index);
+
+    // Replace the current array once all of its buckets are migrated.
+    if (last == buckets)
+    {
+        current_.store(target, std::memory_order_release);
+        target_.store(nullptr, std::memory_order_release);
+    }
+
+    write_relocation();
+    return last - first;
+}
+
+// Items are relinked in their original order, so that duplicates continue to
+// resolve to the most recently stored.
+template <typename KeyType>
+void record_hash_table<KeyType>::split(
+    const record_hash_table_header& current, record_hash_table_header& target,
+    array_index index)
+{
+    typedef typename bucket_policy<KeyType>::reduction reduction;
+    const auto origin = reduction::origin(index, current.size(),
+        header_.size());
+    const auto stripe_index = origin % lock_stripes;
+    auto& version = versions_[stripe_index];
+    auto& mutex = mutexes_[stripe_index];
+    const auto empty = record_hash_table_header::empty;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section.
+    mutex.lock();
+
+    // Readers of the stripe observe the odd version and wait for completion.
+    version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // The tails of the chains of the lower and upper buckets of the split.
+    const auto lower = reduction::lower(index, current.size());
+    array_index tails[] = { empty, empty };
+    auto position = current.read(index);
+
+    while (position != empty)
+    {
+        record_row<KeyType> item(manager_, position);
+        const auto next = item.next_index();
+        const auto bucket = remainder(item.key(), target.size());
+        BITCOIN_ASSERT(bucket == lower ||
+            bucket == reduction::upper(index, current.size()));
+        auto& tail = tails[bucket == lower ? 0 : 1];
+
+        if (tail == empty)
+            target.write(bucket, position);
+        else
+            record_row<KeyType>(manager_, tail).write_next_index(position);
+
+        tail = position;
+
+        if (next == position)
+            break;
+
+        position = next;
+    }
+
+    for (const auto tail: tails)
+        if (tail != empty)
+            record_row<KeyType>(manager_, tail).write_next_index(empty);
+
+    migrated_.store(index + 1, std::memory_order_release);
+    version.fetch_add(1, std::memory_order_release);
+
+    mutex.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+void record_hash_table<KeyType>::write_relocation()
+{
+    const auto current = current_.load(std::memory_order_acquire);
+    const auto target = target_.load(std::memory_order_acquire);
+
+    record_hash_table_header::relocation record;
+    record.offset = current->offset();
+    record.buckets = current->size();
+    record.target_offset = target == nullptr ? 0 : target->offset();
+    record.target_buckets = target == nullptr ? 0 : target->size();
+    record.migrated = target == nullptr ? 0 : migrated_.load();
+    header_.write_relocation(record);
+}
+
+// A zero offset refers to the original header.
+template <typename KeyType>
+record_hash_table_header* record_hash_table<KeyType>::relocate(
+    file_offset offset, array_index buckets)
+{
+    if (offset == 0)
+        return &header_;
+
+    headers_.emplace_back(new record_hash_table_header(header_, buckets,
+        offset));
+
+    return headers_.back()->start() ? headers_.back().get() : nullptr;
+}
+
+// A migrated bucket is counted from the two target buckets it split into.
+template <typename KeyType>
+size_t record_hash_table<KeyType>::estimate() const
+{
+    typedef typename bucket_policy<KeyType>::reduction reduction;
+    const auto target = target_.load(std::memory_order_acquire);
+    const auto& current = *current_.load(std::memory_order_acquire);
+    const auto migrated = target == nullptr ? 0 :
+        migrated_.load(std::memory_order_acquire);
+    const size_t buckets = current.size();
+    const auto samples = std::min<size_t>(buckets, 1024);
+
+    if (samples == 0)
+        return 0;
+
+    size_t count = 0;
+
+    for (size_t sample = 0; sample < samples; ++sample)
+    {
+        const auto index = static_cast<array_index>(sample * buckets /
+            samples);
+
+        if (index < migrated)
+            count += count_items(*target, reduction::lower(index,
+                current.size())) + count_items(*target, reduction::upper(
+                index, current.size()));
+        else
+            count += count_items(current, index);
+    }
+
+    return count * buckets / samples;
+}
+
 } // namespace database
 } // namespace libbitcoin
 
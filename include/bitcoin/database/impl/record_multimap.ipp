@@ -91,6 +91,7 @@ void record_multimap<KeyType>::add_to_list(memory_ptr start_info,
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(mutex_);
     serial_link.template write_little_endian<array_index>(new_begin);
+    map_.dirty(address, sizeof(array_index));
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -128,6 +129,7 @@ bool record_multimap<KeyType>::delete_last_row(const KeyType& key)
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(mutex_);
     serial.template write_little_endian<array_index>(new_begin);
+    map_.dirty(address, sizeof(array_index));
     return true;
     ///////////////////////////////////////////////////////////////////////////
 }
@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <bitcoin/database/memory/memory.hpp>
+#include "../impl/remainder.ipp"
 
 namespace libbitcoin {
 namespace database {
@@ -55,6 +56,9 @@ public:
     /// Does this match?
     bool compare(const KeyType& key) const;
 
+    /// The key of this item.
+    KeyType key() const;
+
     /// The actual user data.
     memory_ptr data() const;
 
@@ -119,6 +123,7 @@ void record_row<KeyType>::link(array_index next)
     //*************************************************************************
     serial.template write_little_endian<array_index>(next);
     //*************************************************************************
+    manager_.dirty(next_data, sizeof(array_index));
 }
 
 template <typename KeyType>
@@ -129,6 +134,13 @@ bool record_row<KeyType>::compare(const KeyType& key) const
     return std::equal(key.begin(), key.end(), REMAP_ADDRESS(memory));
 }
 
+template <typename KeyType>
+KeyType record_row<KeyType>::key() const
+{
+    const auto memory = raw_data(key_start);
+    return key_from_data<KeyType>(REMAP_ADDRESS(memory));
+}
+
 template <typename KeyType>
 memory_ptr record_row<KeyType>::data() const
 {
@@ -171,6 +183,7 @@ void record_row<KeyType>::write_next_index(array_index next)
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(mutex_);
     serial.template write_little_endian<array_index>(next);
+    manager_.dirty(REMAP_ADDRESS(memory), sizeof(array_index));
     ///////////////////////////////////////////////////////////////////////////
 }
 
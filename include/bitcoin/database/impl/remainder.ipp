@@ -19,18 +19,175 @@
 #ifndef LIBBITCOIN_DATABASE_REMAINDER_IPP
 #define LIBBITCOIN_DATABASE_REMAINDER_IPP
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
+#include <tuple>
 #include <bitcoin/bitcoin.hpp>
 
 namespace libbitcoin {
 namespace database {
 
+/// Reduce a hash to [0, divisor) by division, correct for any hash.
+/// A bucket of n buckets splits into buckets index and (index + n) of 2n.
+struct modulo_reduction
+{
+    template <typename Divisor>
+    static Divisor reduce(uint64_t hash, Divisor divisor)
+    {
+        return divisor == 0 ? 0 : static_cast<Divisor>(hash % divisor);
+    }
+
+    /// The lower of the two buckets into which index splits on doubling.
+    template <typename Divisor>
+    static Divisor lower(Divisor index, Divisor)
+    {
+        return index;
+    }
+
+    /// The upper of the two buckets into which index splits on doubling.
+    template <typename Divisor>
+    static Divisor upper(Divisor index, Divisor buckets)
+    {
+        return index + buckets;
+    }
+
+    /// The bucket of the original table from which index descends.
+    template <typename Divisor>
+    static Divisor origin(Divisor index, Divisor, Divisor original)
+    {
+        return index % original;
+    }
+};
+
+/// Reduce a hash to [0, divisor) by multiply-shift (Lemire), avoiding the
+/// division. The high 32 bits of the hash must be uniform and the divisor
+/// must not exceed 32 bits. Doubling the divisor at most adds a low bit to the
+/// result, so a bucket of n buckets splits into buckets 2index and 2index+1.
+struct multiply_shift_reduction
+{
+    template <typename Divisor>
+    static Divisor reduce(uint64_t hash, Divisor divisor)
+    {
+        BITCOIN_ASSERT(static_cast<uint64_t>(divisor) <= max_uint32);
+        return static_cast<Divisor>(((hash >> 32) * divisor) >> 32);
+    }
+
+    template <typename Divisor>
+    static Divisor lower(Divisor index, Divisor)
+    {
+        return 2 * index;
+    }
+
+    template <typename Divisor>
+    static Divisor upper(Divisor index, Divisor)
+    {
+        return 2 * index + 1;
+    }
+
+    template <typename Divisor>
+    static Divisor origin(Divisor index, Divisor buckets, Divisor original)
+    {
+        return index / (buckets / original);
+    }
+};
+
+/// The bucket policy of a key type, selected at compile time. The hash is
+/// reduced to a bucket index and the fingerprint is a second hash whose high
+/// bits are independent of the bucket index (used by open addressing).
+/// Keys without uniform bits are hashed with std::hash and reduced by modulo.
+template <typename KeyType>
+struct bucket_policy
+{
+    typedef modulo_reduction reduction;
+
+    static uint64_t hash(const KeyType& key)
+    {
+        return std::hash<KeyType>()(key);
+    }
+
+    static uint64_t fingerprint(const KeyType& key)
+    {
+        return hash(key);
+    }
+};
+
+/// Digests are uniformly distributed, so their bytes are used directly.
+template <size_t Size>
+struct digest_bucket_policy
+{
+    static_assert(Size >= 2 * sizeof(uint64_t), "digest too short");
+    typedef multiply_shift_reduction reduction;
+
+    static uint64_t hash(const byte_array<Size>& key)
+    {
+        return from_little_endian_unsafe<uint64_t>(key.begin());
+    }
+
+    static uint64_t fingerprint(const byte_array<Size>& key)
+    {
+        return from_little_endian_unsafe<uint64_t>(
+            key.begin() + sizeof(uint64_t));
+    }
+};
+
+/// Transaction hashes (transaction_database).
+template <>
+struct bucket_policy<hash_digest>
+  : digest_bucket_policy<hash_size>
+{
+};
+
+/// Payment address hashes (history_database).
+template <>
+struct bucket_policy<short_hash>
+  : digest_bucket_policy<short_hash_size>
+{
+};
+
+/// Outpoints (spend_database). Outputs of a transaction share its hash, so the
+/// index is mixed into the high bits by the golden ratio multiplier.
+template <>
+struct bucket_policy<chain::point>
+{
+    typedef multiply_shift_reduction reduction;
+    static BC_CONSTEXPR uint64_t multiplier = 0x9e3779b97f4a7c15;
+
+    static uint64_t hash(const chain::point& key)
+    {
+        return bucket_policy<hash_digest>::hash(key.hash()) +
+            key.index() * multiplier;
+    }
+
+    static uint64_t fingerprint(const chain::point& key)
+    {
+        return bucket_policy<hash_digest>::fingerprint(key.hash()) ^
+            (static_cast<uint64_t>(key.index()) << 48);
+    }
+};
+
 /// Return a hash of the key reduced to the domain of the divisor.
 template <typename KeyType, typename Divisor>
 Divisor remainder(const KeyType& key, const Divisor divisor)
 {
-    return divisor == 0 ? 0 : std::hash<KeyType>()(key) % divisor;
+    typedef bucket_policy<KeyType> policy;
+    return policy::reduction::reduce(policy::hash(key), divisor);
+}
+
+/// Read a key as written to a row, so that the row may be rehashed.
+template <typename KeyType>
+KeyType key_from_data(const uint8_t* data)
+{
+    KeyType key;
+    std::copy_n(data, std::tuple_size<KeyType>::value, key.begin());
+    return key;
+}
+
+template <>
+inline chain::point key_from_data<chain::point>(const uint8_t* data)
+{
+    auto deserial = make_unsafe_deserializer(data);
+    return chain::point::factory_from_data(deserial);
 }
 
 } // namespace database
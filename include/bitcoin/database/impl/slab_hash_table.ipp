@@ -19,6 +19,11 @@
 #ifndef LIBBITCOIN_DATABASE_SLAB_HASH_TABLE_IPP
 #define LIBBITCOIN_DATABASE_SLAB_HASH_TABLE_IPP
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <utility>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include "../impl/remainder.ipp"
@@ -27,11 +32,57 @@
 namespace libbitcoin {
 namespace database {
 
+static_assert(slab_hash_table_header::items_offset ==
+    slab_hash_table_header_size(0), "Invalid slab hash table header size.");
+
+template <typename KeyType>
+BC_CONSTEXPR size_t slab_hash_table<KeyType>::migration_step;
+
 template <typename KeyType>
 slab_hash_table<KeyType>::slab_hash_table(slab_hash_table_header& header,
-    slab_manager& manager)
-  : header_(header), manager_(manager)
+    slab_manager& manager, size_t max_load)
+  : header_(header),
+    manager_(manager),
+    contention_(0),
+    max_load_(max_load),
+    keys_(0),
+    current_(&header),
+    target_(nullptr),
+    migrated_(0)
+{
+    for (auto& version: versions_)
+        version.store(0);
+}
+
+// Resume a resize recorded by a previous session.
+template <typename KeyType>
+bool slab_hash_table<KeyType>::start()
 {
+    if (header_.relocated())
+    {
+        const auto record = header_.read_relocation();
+        const auto current = relocate(record.offset, record.buckets);
+
+        if (current == nullptr)
+            return false;
+
+        current_.store(current);
+
+        if (record.target_offset != 0)
+        {
+            const auto target = relocate(record.target_offset,
+                record.target_buckets);
+
+            if (target == nullptr || record.migrated >= record.buckets)
+                return false;
+
+            migrated_.store(record.migrated);
+            target_.store(target);
+        }
+    }
+
+    keys_.store(estimate());
+    return true;
 }
 
 // This is not limited to storing unique key values. If duplicate keyed values
@@ -52,23 +103,30 @@ file_offset slab_hash_table<KeyType>::store(const KeyType& key,
 
     // For a given key in this hash table new item creation must be atomic from
     // read of the old value to write of the new. Otherwise concurrent write of
-    // hash table conflicts will corrupt the key's record row. Unfortunmately
-    // there is no efficient way to lock a given bucket, so we lock across
-    // all buckets. But given that this protection is required for concurrent
-    // write but not for read-while-write (slock) we need not lock read.
+    // hash table conflicts will corrupt the key's record row. So we lock the
+    // stripe of the key's bucket, which serializes only those writers that
+    // map to the same stripe. But given that this protection is required for
+    // concurrent write but not for read-while-write (slock) we need not lock
+    // read. The stripe also excludes migration of the key's bucket.
     ///////////////////////////////////////////////////////////////////////////
     // Critical Section.
-    mutex_.lock();
+    auto& mutex = lock_bucket(key);
+
+    array_index index;
+    auto& header = locate(key, index);
 
     // Link new slab.next to current first slab.
-    slab.link(read_bucket_value(key));
+    slab.link(header.read(index));
 
     // Link header to new slab as the new first.
-    link(key, position);
+    header.write(index, position);
 
-    mutex_.unlock();
+    mutex.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
+    ++keys_;
+    grow();
+
     // Return the file offset of the slab data segment.
     return position + slab_row<KeyType>::prefix_size;
 }
@@ -79,49 +137,195 @@ template <typename KeyType>
 file_offset slab_hash_table<KeyType>::update(const KeyType& key,
     write_function write)
 {
-    // Find start item...
-    auto current = read_bucket_value(key);
+    const auto position = find_position(key);
 
-    // Iterate through list...
-    while (current != header_.empty)
-    {
-        const slab_row<KeyType> item(manager_, current);
+    if (position == slab_hash_table_header::empty)
+        return 0;
 
-        // Found.
-        if (item.compare(key))
+    const slab_row<KeyType> item(manager_, position);
+    write(item.data());
+    return item.offset();
+}
+
+// This is limited to returning the first of multiple matching key values.
+// Prefetching is a hint, so the bucket is located without the stripe version.
+template <typename KeyType>
+void slab_hash_table<KeyType>::prefetch_bucket(const KeyType& key) const
+{
+    array_index index;
+    locate(key, index).prefetch(index);
+}
+
+template <typename KeyType>
+void slab_hash_table<KeyType>::prefetch_row(const KeyType& key) const
+{
+    array_index index;
+    const auto position = locate(key, index).read(index);
+
+    if (position == slab_hash_table_header::empty)
+        return;
+
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = manager_.get(position);
+    PREFETCH(REMAP_ADDRESS(memory));
+}
+
+template <typename KeyType>
+memory_ptr slab_hash_table<KeyType>::find(const KeyType& key) const
+{
+    const auto position = find_position(key);
+
+    if (position == slab_hash_table_header::empty)
+        return nullptr;
+
+    const slab_row<KeyType> item(manager_, position);
+    return item.data();
+}
+
+// This is limited to unlinking the first of multiple matching key values.
+template <typename KeyType>
+bool slab_hash_table<KeyType>::unlink(const KeyType& key)
+{
+    // Unlink must not interleave with a store into the same bucket.
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section.
+    auto& mutex = lock_bucket(key);
+
+    array_index index;
+    auto& header = locate(key, index);
+    const auto result = unlink_item(header, index, key);
+
+    mutex.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    if (result)
+        --keys_;
+
+    return result;
+}
+
+// A migrated bucket is visited in the two target buckets it split into.
+template <typename KeyType>
+template <typename UnaryFunction>
+void slab_hash_table<KeyType>::for_each(UnaryFunction f) const
+{
+    typedef typename bucket_policy<KeyType>::reduction reduction;
+    const auto target = target_.load(std::memory_order_acquire);
+    const auto& current = *current_.load(std::memory_order_acquire);
+    const auto migrated = target == nullptr ? 0 :
+        migrated_.load(std::memory_order_acquire);
+    const auto buckets = current.size();
+
+    for (array_index index = 0; index < buckets; ++index)
+    {
+        if (index < migrated)
+        {
+            if (!for_each_item(*target, reduction::lower(index, buckets), f) ||
+                !for_each_item(*target, reduction::upper(index, buckets), f))
+                return;
+        }
+        else if (!for_each_item(current, index, f))
         {
-            write(item.data());
-            return item.offset();
+            return;
         }
+    }
+}
 
-        const auto previous = current;
-        current = item.next_position();
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::migrate(size_t count)
+{
+    // Critical Section.
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(resize_mutex_);
+    return migrate_locked(count);
+    ///////////////////////////////////////////////////////////////////////////
+}
 
-        // This may otherwise produce an infinite loop here.
-        // It indicates that a write operation has interceded.
-        // So we must return gracefully vs. looping forever.
-        if (previous == current)
-            return 0;
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::contention() const
+{
+    return contention_.load();
+}
+
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::buckets() const
+{
+    return current_.load(std::memory_order_acquire)->size();
+}
+
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::keys() const
+{
+    return keys_.load();
+}
+
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::load() const
+{
+    const auto buckets = this->buckets();
+    return buckets == 0 ? 0 : keys() * 100 / buckets;
+}
+
+template <typename KeyType>
+bool slab_hash_table<KeyType>::resizing() const
+{
+    return target_.load(std::memory_order_acquire) != nullptr;
+}
+
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::migrated() const
+{
+    return resizing() ? migrated_.load(std::memory_order_acquire) : 0;
+}
+
+// private
+// ----------------------------------------------------------------------------
+
+// The original bucket count divides that of each resized array, so the items
+// of a bucket and of the two buckets it splits into descend from the same
+// original bucket and share a stripe.
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::stripe(const KeyType& key) const
+{
+    return remainder(key, header_.size()) % lock_stripes;
+}
+
+// The target is loaded before the current array, because it is cleared after
+// the current array is replaced. A reader that observes a mixed state also
+// observes a stripe version change, a writer holds the stripe.
+template <typename KeyType>
+slab_hash_table_header& slab_hash_table<KeyType>::locate(const KeyType& key,
+    array_index& index) const
+{
+    const auto target = target_.load(std::memory_order_acquire);
+    const auto current = current_.load(std::memory_order_acquire);
+    index = remainder(key, current->size());
+
+    if (target != nullptr && index < migrated_.load(std::memory_order_acquire))
+    {
+        index = remainder(key, target->size());
+        return *target;
     }
 
-    return 0;
+    return *current;
 }
 
-// This is limited to returning the first of multiple matching key values.
 template <typename KeyType>
-memory_ptr slab_hash_table<KeyType>::find(const KeyType& key) const
+file_offset slab_hash_table<KeyType>::find_item(
+    const slab_hash_table_header& header, array_index index,
+    const KeyType& key) const
 {
     // Find start item...
-    auto current = read_bucket_value(key);
+    auto current = header.read(index);
 
     // Iterate through list...
-    while (current != header_.empty)
+    while (current != header.empty)
     {
         const slab_row<KeyType> item(manager_, current);
 
         // Found.
         if (item.compare(key))
-            return item.data();
+            return current;
 
         const auto previous = current;
         current = item.next_position();
@@ -131,24 +335,62 @@ memory_ptr slab_hash_table<KeyType>::find(const KeyType& key) const
         // So we must return gracefully vs. looping forever.
         // A parallel write operation cannot safely use this call.
         if (previous == current)
-            return nullptr;
+            return header.empty;
     }
 
-    return nullptr;
+    return header.empty;
 }
 
-// This is limited to unlinking the first of multiple matching key values.
+// A found item is always valid, as items are never moved or freed. A miss is
+// valid only if no bucket of the key's stripe was migrated during the search.
 template <typename KeyType>
-bool slab_hash_table<KeyType>::unlink(const KeyType& key)
+file_offset slab_hash_table<KeyType>::find_position(const KeyType& key) const
+{
+    const auto stripe_index = stripe(key);
+    const auto& version = versions_[stripe_index];
+
+    while (true)
+    {
+        const auto start = version.load(std::memory_order_acquire);
+
+        // Wait for the migration of a bucket of this stripe to complete.
+        if (start % 2 != 0)
+        {
+            mutexes_[stripe_index].lock_shared();
+            mutexes_[stripe_index].unlock_shared();
+            continue;
+        }
+
+        array_index index;
+        const auto& header = locate(key, index);
+        const auto position = find_item(header, index, key);
+
+        if (position != header.empty)
+            return position;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (version.load(std::memory_order_relaxed) == start)
+            return position;
+    }
+}
+
+template <typename KeyType>
+bool slab_hash_table<KeyType>::unlink_item(slab_hash_table_header& header,
+    array_index index, const KeyType& key)
 {
     // Find start item...
-    const auto begin = read_bucket_value(key);
+    const auto begin = header.read(index);
+
+    if (begin == header.empty)
+        return false;
+
     const slab_row<KeyType> begin_item(manager_, begin);
 
     // If start item has the key then unlink from buckets.
     if (begin_item.compare(key))
     {
-        link(key, begin_item.next_position());
+        header.write(index, begin_item.next_position());
         return true;
     }
 
@@ -157,7 +399,7 @@ bool slab_hash_table<KeyType>::unlink(const KeyType& key)
     auto current = begin_item.next_position();
 
     // Iterate through list...
-    while (current != header_.empty)
+    while (current != header.empty)
     {
         const slab_row<KeyType> item(manager_, current);
 
@@ -182,26 +424,64 @@ bool slab_hash_table<KeyType>::unlink(const KeyType& key)
 }
 
 template <typename KeyType>
-array_index slab_hash_table<KeyType>::bucket_index(const KeyType& key) const
+template <typename UnaryFunction>
+bool slab_hash_table<KeyType>::for_each_item(
+    const slab_hash_table_header& header, array_index index,
+    UnaryFunction& f) const
 {
-    const auto bucket = remainder(key, header_.size());
-    BITCOIN_ASSERT(bucket < header_.size());
-    return bucket;
+    // Find start item...
+    auto current = header.read(index);
+
+    // Iterate through list...
+    while (current != header.empty)
+    {
+        const slab_row<KeyType> item(manager_, current);
+
+        if (!f(item.data()))
+            return false;
+
+        const auto previous = current;
+        current = item.next_position();
+
+        // This may otherwise produce an infinite loop here.
+        // It indicates that a write operation has interceded.
+        // So we must return gracefully vs. looping forever.
+        // A parallel write operation cannot safely use this call.
+        if (previous == current)
+            break;
+    }
+
+    return true;
 }
 
 template <typename KeyType>
-file_offset slab_hash_table<KeyType>::read_bucket_value(
-    const KeyType& key) const
+size_t slab_hash_table<KeyType>::count_items(
+    const slab_hash_table_header& header, array_index index) const
 {
-    const auto value = header_.read(bucket_index(key));
-    static_assert(sizeof(value) == sizeof(file_offset), "Invalid size");
-    return value;
+    size_t count = 0;
+    const auto counter = [&count](memory_ptr)
+    {
+        ++count;
+        return true;
+    };
+
+    for_each_item(header, index, counter);
+    return count;
 }
 
 template <typename KeyType>
-void slab_hash_table<KeyType>::link(const KeyType& key, file_offset begin)
+shared_mutex& slab_hash_table<KeyType>::lock_bucket(const KeyType& key)
 {
-    header_.write(bucket_index(key), begin);
+    auto& mutex = mutexes_[stripe(key)];
+
+    // Count the collision, then wait for the other writer.
+    if (!mutex.try_lock())
+    {
+        ++contention_;
+        mutex.lock();
+    }
+
+    return mutex;
 }
 
 template <typename KeyType>
@@ -213,51 +493,205 @@ void slab_hash_table<KeyType>::release(const ListItem& item,
     previous_item.write_next_position(item.next_position());
 }
 
+// Resize
+// ----------------------------------------------------------------------------
+
+template <typename KeyType>
+void slab_hash_table<KeyType>::grow()
+{
+    if (max_load_ == 0 || (!resizing() && load() <= max_load_))
+        return;
+
+    // Only one writer migrates at a time, the others do not wait for it.
+    if (!resize_mutex_.try_lock())
+        return;
+
+    if (resizing() || (load() > max_load_ && begin_resize()))
+        migrate_locked(migration_step);
+
+    resize_mutex_.unlock();
+}
+
+// The target array is allocated in the payload, so the arrays replaced by
+// resizing are not reclaimed. The original header remains as the record.
 template <typename KeyType>
-file_offset slab_hash_table<KeyType>::read_bucket_value_by_index(array_index index) const
+bool slab_hash_table<KeyType>::begin_resize()
 {
-    const auto value = header_.read(index);
-    static_assert(sizeof(value) == sizeof(file_offset), "Invalid size");
-    return value;
+    static BC_CONSTEXPR auto alignment = sizeof(file_offset);
+    const auto buckets = current_.load(std::memory_order_acquire)->size();
+
+    // The bucket count is limited by the index type.
+    if (buckets == 0 || header_.size() == 0 ||
+        buckets > std::numeric_limits<array_index>::max() / 2)
+        return false;
+
+    // Allocate the target array, with room to align its items.
+    const array_index target_buckets = buckets * 2;
+    const auto size = slab_hash_table_header_size(target_buckets) + alignment;
+    const auto unaligned = manager_.offset(manager_.new_slab(size));
+    const auto offset = (unaligned + alignment - 1) / alignment * alignment;
+
+    header_ptr target(new slab_hash_table_header(header_, target_buckets,
+        offset));
+
+    if (!target->create())
+        return false;
+
+    headers_.push_back(std::move(target));
+    migrated_.store(0, std::memory_order_release);
+    target_.store(headers_.back().get(), std::memory_order_release);
+    return true;
 }
 
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::migrate_locked(size_t count)
+{
+    const auto target = target_.load(std::memory_order_acquire);
+
+    if (target == nullptr)
+        return 0;
+
+    const auto current = current_.load(std::memory_order_acquire);
+    const auto buckets = current->size();
+    const auto first = migrated_.load(std::memory_order_acquire);
+    const auto last = static_cast<array_index>(
+        std::min<size_t>(buckets, first + count));
 
+    for (auto index = first; index < last; ++index)
+        split(*current, *target, index);
+
+    // Replace the current array once all of its buckets are migrated.
+    if (last == buckets)
+    {
+        current_.store(target, std::memory_order_release);
+        target_.store(nullptr, std::memory_order_release);
+    }
 
+    write_relocation();
+    return last - first;
+}
+
+// Items are relinked in their original order, so that duplicates continue to
+// resolve to the most recently stored.
 template <typename KeyType>
-template <typename UnaryFunction>
-void slab_hash_table<KeyType>::for_each(UnaryFunction f) const {
-    array_index index = 0;
-    while (index < header_.size()) {
+void slab_hash_table<KeyType>::split(const slab_hash_table_header& current,
+    slab_hash_table_header& target, array_index index)
+{
+    typedef typename bucket_policy<KeyType>::reduction reduction;
+    const auto origin = reduction::origin(index, current.size(),
+        header_.size());
+    const auto stripe_index = origin % lock_stripes;
+    auto& version = versions_[stripe_index];
+    auto& mutex = mutexes_[stripe_index];
+    const auto empty = slab_hash_table_header::empty;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section.
+    mutex.lock();
 
-        // Find start item...
-        auto current = read_bucket_value_by_index(index);
+    // Readers of the stripe observe the odd version and wait for completion.
+    version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
 
-        // Iterate through list...
-        while (current != header_.empty) {
-            const slab_row<KeyType> item(manager_, current);
+    // The tails of the chains of the lower and upper buckets of the split.
+    const auto lower = reduction::lower(index, current.size());
+    file_offset tails[] = { empty, empty };
+    auto position = current.read(index);
 
-            //DO SOMETHING
-            if (!f(item.data())) { //memory_ptr
-                return;
-            }
+    while (position != empty)
+    {
+        slab_row<KeyType> item(manager_, position);
+        const auto next = item.next_position();
+        const auto bucket = remainder(item.key(), target.size());
+        BITCOIN_ASSERT(bucket == lower ||
+            bucket == reduction::upper(index, current.size()));
+        auto& tail = tails[bucket == lower ? 0 : 1];
 
-            const auto previous = current;
-            current = item.next_position();
+        if (tail == empty)
+            target.write(bucket, position);
+        else
+            slab_row<KeyType>(manager_, tail).write_next_position(position);
 
-            // This may otherwise produce an infinite loop here.
-            // It indicates that a write operation has interceded.
-            // So we must return gracefully vs. looping forever.
-            // A parallel write operation cannot safely use this call.
-            if (previous == current)
-                break;
-        }
+        tail = position;
 
-        ++index;
+        if (next == position)
+            break;
+
+        position = next;
     }
 
+    for (const auto tail: tails)
+        if (tail != empty)
+            slab_row<KeyType>(manager_, tail).write_next_position(empty);
+
+    migrated_.store(index + 1, std::memory_order_release);
+    version.fetch_add(1, std::memory_order_release);
+
+    mutex.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+template <typename KeyType>
+void slab_hash_table<KeyType>::write_relocation()
+{
+    const auto current = current_.load(std::memory_order_acquire);
+    const auto target = target_.load(std::memory_order_acquire);
+
+    slab_hash_table_header::relocation record;
+    record.offset = current->offset();
+    record.buckets = current->size();
+    record.target_offset = target == nullptr ? 0 : target->offset();
+    record.target_buckets = target == nullptr ? 0 : target->size();
+    record.migrated = target == nullptr ? 0 : migrated_.load();
+    header_.write_relocation(record);
+}
+
+// A zero offset refers to the original header.
+template <typename KeyType>
+slab_hash_table_header* slab_hash_table<KeyType>::relocate(
+    file_offset offset, array_index buckets)
+{
+    if (offset == 0)
+        return &header_;
+
+    headers_.emplace_back(new slab_hash_table_header(header_, buckets,
+        offset));
 
+    return headers_.back()->start() ? headers_.back().get() : nullptr;
 }
 
+// A migrated bucket is counted from the two target buckets it split into.
+template <typename KeyType>
+size_t slab_hash_table<KeyType>::estimate() const
+{
+    typedef typename bucket_policy<KeyType>::reduction reduction;
+    const auto target = target_.load(std::memory_order_acquire);
+    const auto& current = *current_.load(std::memory_order_acquire);
+    const auto migrated = target == nullptr ? 0 :
+        migrated_.load(std::memory_order_acquire);
+    const size_t buckets = current.size();
+    const auto samples = std::min<size_t>(buckets, 1024);
+
+    if (samples == 0)
+        return 0;
+
+    size_t count = 0;
+
+    for (size_t sample = 0; sample < samples; ++sample)
+    {
+        const auto index = static_cast<array_index>(sample * buckets /
+            samples);
+
+        if (index < migrated)
+            count += count_items(*target, reduction::lower(index,
+                current.size())) + count_items(*target, reduction::upper(
+                index, current.size()));
+        else
+            count += count_items(current, index);
+    }
+
+    return count * buckets / samples;
+}
 
 } // namespace database
 } // namespace libbitcoin
@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_SLAB_OPEN_HASH_TABLE_IPP
+#define LIBBITCOIN_DATABASE_SLAB_OPEN_HASH_TABLE_IPP
+
+#include <algorithm>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/memory/memory.hpp>
+#include "../impl/remainder.ipp"
+
+namespace libbitcoin {
+namespace database {
+
+// The low 48 bits of a bucket are the slab position, the high 16 bits are the
+// fingerprint. Positions at or above the tombstone cannot be represented.
+static BC_CONSTEXPR file_offset open_position_mask = 0x0000ffffffffffff;
+static BC_CONSTEXPR file_offset open_fingerprint_mask = ~open_position_mask;
+
+template <typename KeyType>
+const file_offset slab_open_hash_table<KeyType>::tombstone =
+    slab_hash_table_header::empty - 1;
+
+template <typename KeyType>
+BC_CONSTEXPR size_t slab_open_hash_table<KeyType>::store_stripes;
+
+template <typename KeyType>
+slab_open_hash_table<KeyType>::slab_open_hash_table(
+    slab_hash_table_header& header, slab_manager& manager)
+  : header_(header), manager_(manager), claimed_(0)
+{
+    for (auto& stripe: stores_)
+        stripe.count.store(0, std::memory_order_relaxed);
+}
+
+// The claim count is not stored, so it is counted from the bucket array.
+template <typename KeyType>
+bool slab_open_hash_table<KeyType>::start()
+{
+    size_t claimed = 0;
+
+    for (array_index index = 0; index < header_.size(); ++index)
+    {
+        const auto value = header_.read(index);
+
+        if (value != header_.empty && value != tombstone)
+            ++claimed;
+    }
+
+    claimed_.store(claimed, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename KeyType>
+bool slab_open_hash_table<KeyType>::reserve(size_t count)
+{
+    const size_t buckets = header_.size();
+    auto claimed = claimed_.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (count > buckets - claimed)
+            return false;
+    } while (!claimed_.compare_exchange_weak(claimed, claimed + count,
+        std::memory_order_relaxed));
+
+    return true;
+}
+
+template <typename KeyType>
+void slab_open_hash_table<KeyType>::release(size_t count)
+{
+    BITCOIN_ASSERT(claimed_.load(std::memory_order_relaxed) >= count);
+    claimed_.fetch_sub(count, std::memory_order_relaxed);
+}
+
+// This is not limited to storing unique key values. If duplicate keyed values
+// are stored then find, update and unlink apply to the most recently stored
+// value, which is consistent with the chained table. A store claims exactly
+// one free bucket, which was held for it by reserve, so the probe finds one.
+template <typename KeyType>
+file_offset slab_open_hash_table<KeyType>::store(const KeyType& key,
+    write_function write, size_t value_size)
+{
+    // Create and populate the slab before it is published in a bucket.
+    //   [ KeyType  ] <==
+    //   [ value... ] <==
+    const auto position = manager_.new_slab(key_size + value_size);
+    BITCOIN_ASSERT(position < (open_position_mask & tombstone));
+
+    const auto memory = manager_.get(position);
+    auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory));
+    serial.write_forward(key);
+    serial.write_delegated(write);
+
+    const auto print = fingerprint(key);
+    auto bucket = print | position;
+    const auto buckets = header_.size();
+    auto index = bucket_index(key);
+
+    // The store is counted while in progress, and the count is ordered
+    // before the probe, so a concurrent unlink does not collapse a tombstone
+    // that this probe has passed (see collapse).
+    auto& stripe = stores_[index % store_stripes].count;
+    stripe.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Claim the first free bucket in the probe sequence. A failed exchange
+    // means another writer changed the bucket, so it is read again. An older
+    // duplicate is displaced by the newer and then carried forward, which
+    // keeps duplicates ordered newest first in the probe sequence.
+    for (array_index probe = 0; probe < buckets;)
+    {
+        const auto value = header_.read(index);
+        const auto free = value == header_.empty || value == tombstone;
+        const auto older = !free && (bucket & open_fingerprint_mask) ==
+            (value & open_fingerprint_mask) &&
+            compare(value & open_position_mask, key);
+
+        if (free || older)
+        {
+            if (!header_.compare_exchange(index, value, bucket))
+                continue;
+
+            if (free)
+            {
+                stripe.fetch_sub(1, std::memory_order_release);
+                return position + key_size;
+            }
+
+            bucket = value;
+        }
+
+        ++probe;
+        if (++index == buckets)
+            index = 0;
+    }
+
+    stripe.fetch_sub(1, std::memory_order_release);
+
+    // The slab is not linked, so it is only unused space in the payload.
+    BITCOIN_ASSERT_MSG(false, "Store without a reserved bucket.");
+    return 0;
+}
+
+// Execute a writer against a key's buffer if the key is found.
+// Return the file offset of the found value (or zero).
+template <typename KeyType>
+file_offset slab_open_hash_table<KeyType>::update(const KeyType& key,
+    write_function write)
+{
+    array_index index;
+    file_offset position;
+
+    if (!find_bucket(index, position, key))
+        return 0;
+
+    const auto memory = manager_.get(position + key_size);
+    auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory));
+    write(serial);
+    return position + key_size;
+}
+
+template <typename KeyType>
+memory_ptr slab_open_hash_table<KeyType>::find(const KeyType& key) const
+{
+    array_index index;
+    file_offset position;
+
+    if (!find_bucket(index, position, key))
+        return nullptr;
+
+    return manager_.get(position + key_size);
+}
+
+template <typename KeyType>
+void slab_open_hash_table<KeyType>::prefetch_bucket(const KeyType& key) const
+{
+    header_.prefetch(bucket_index(key));
+}
+
+// Only the home bucket of the probe sequence is considered.
+template <typename KeyType>
+void slab_open_hash_table<KeyType>::prefetch_row(const KeyType& key) const
+{
+    const auto value = header_.read(bucket_index(key));
+
+    if (value == header_.empty || value == tombstone ||
+        (value & open_fingerprint_mask) != fingerprint(key))
+        return;
+
+    // The accessor must remain in scope until the end of the block.
+    const auto memory = manager_.get(value & open_position_mask);
+    PREFETCH(REMAP_ADDRESS(memory));
+}
+
+template <typename KeyType>
+bool slab_open_hash_table<KeyType>::unlink(const KeyType& key)
+{
+    array_index index;
+    file_offset position;
+
+    if (!find_bucket(index, position, key))
+        return false;
+
+    // Fails if another writer has unlinked the bucket in the interim.
+    const auto bucket = fingerprint(key) | position;
+
+    if (!header_.compare_exchange(index, bucket, tombstone))
+        return false;
+
+    // The tombstone is free to a store.
+    claimed_.fetch_sub(1, std::memory_order_relaxed);
+    collapse(index);
+    return true;
+}
+
+template <typename KeyType>
+template <typename UnaryFunction>
+void slab_open_hash_table<KeyType>::for_each(UnaryFunction f) const
+{
+    for (array_index index = 0; index < header_.size(); ++index)
+    {
+        const auto value = header_.read(index);
+
+        if (value == header_.empty || value == tombstone)
+            continue;
+
+        const auto position = value & open_position_mask;
+
+        if (!f(manager_.get(position + key_size)))
+            return;
+    }
+}
+
+// private
+// ----------------------------------------------------------------------------
+
+template <typename KeyType>
+array_index slab_open_hash_table<KeyType>::bucket_index(
+    const KeyType& key) const
+{
+    const auto bucket = remainder(key, header_.size());
+    BITCOIN_ASSERT(bucket < header_.size());
+    return bucket;
+}
+
+template <typename KeyType>
+file_offset slab_open_hash_table<KeyType>::fingerprint(
+    const KeyType& key) const
+{
+    // The high bits of the fingerprint are independent of the bucket index.
+    return bucket_policy<KeyType>::fingerprint(key) & open_fingerprint_mask;
+}
+
+// The probe ends at the first empty bucket or at the first match, tombstones
+// are skipped. Other fingerprints are rejected without reading the slab.
+template <typename KeyType>
+bool slab_open_hash_table<KeyType>::find_bucket(array_index& out_index,
+    file_offset& out_position, const KeyType& key) const
+{
+    const auto print = fingerprint(key);
+    const auto buckets = header_.size();
+    auto index = bucket_index(key);
+
+    for (array_index probe = 0; probe < buckets; ++probe)
+    {
+        const auto value = header_.read(index);
+
+        if (value == header_.empty)
+            return false;
+
+        if (value != tombstone && (value & open_fingerprint_mask) == print)
+        {
+            const auto position = value & open_position_mask;
+
+            if (compare(position, key))
+            {
+                out_index = index;
+                out_position = position;
+                return true;
+            }
+        }
+
+        if (++index == buckets)
+            index = 0;
+    }
+
+    return false;
+}
+
+// No probe passes an empty bucket, so a tombstone that is followed by an
+// empty bucket terminates no probe of a stored key, and may be emptied. A
+// store in progress may have passed the bucket before it was unlinked, and
+// may yet claim the following bucket, so nothing is emptied while one is
+// counted. A store that begins later reads the tombstone, and claims it
+// (either as tombstone or as empty) before reaching the following bucket.
+template <typename KeyType>
+void slab_open_hash_table<KeyType>::collapse(array_index index)
+{
+    // Orders the tombstone before the counts (pairs with the store fence).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (const auto& stripe: stores_)
+        if (stripe.count.load(std::memory_order_acquire) != 0)
+            return;
+
+    const auto buckets = header_.size();
+    const auto next = index + 1 == buckets ? 0 : index + 1;
+
+    if (header_.read(next) != header_.empty)
+        return;
+
+    // Empty the run of tombstones, ending at the first claimed bucket.
+    for (array_index probe = 0; probe < buckets; ++probe)
+    {
+        if (!header_.compare_exchange(index, tombstone, header_.empty))
+            return;
+
+        index = index == 0 ? buckets - 1 : index - 1;
+    }
+}
+
+template <typename KeyType>
+bool slab_open_hash_table<KeyType>::compare(file_offset position,
+    const KeyType& key) const
+{
+    const auto memory = manager_.get(position);
+    return std::equal(key.begin(), key.end(), REMAP_ADDRESS(memory));
+}
+
+} // namespace database
+} // namespace libbitcoin
+
+#endif
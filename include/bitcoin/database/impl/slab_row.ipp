@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <bitcoin/database/memory/memory.hpp>
+#include "../impl/remainder.ipp"
 
 namespace libbitcoin {
 namespace database {
@@ -56,6 +57,9 @@ public:
     /// Does this match?
     bool compare(const KeyType& key) const;
 
+    /// The key of this item.
+    KeyType key() const;
+
     /// The actual user data.
     memory_ptr data() const;
 
@@ -122,6 +126,7 @@ void slab_row<KeyType>::link(file_offset next)
     //*************************************************************************
     serial.template write_little_endian<file_offset>(next);
     //*************************************************************************
+    manager_.dirty(next_data, sizeof(file_offset));
 }
 
 template <typename KeyType>
@@ -131,6 +136,13 @@ bool slab_row<KeyType>::compare(const KeyType& key) const
     return std::equal(key.begin(), key.end(), REMAP_ADDRESS(memory));
 }
 
+template <typename KeyType>
+KeyType slab_row<KeyType>::key() const
+{
+    const auto memory = raw_data(key_start);
+    return key_from_data<KeyType>(REMAP_ADDRESS(memory));
+}
+
 template <typename KeyType>
 memory_ptr slab_row<KeyType>::data() const
 {
@@ -173,6 +185,7 @@ void slab_row<KeyType>::write_next_position(file_offset next)
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(mutex_);
     serial.template write_little_endian<file_offset>(next);
+    manager_.dirty(REMAP_ADDRESS(memory), sizeof(file_offset));
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_JOURNAL_HPP
+#define LIBBITCOIN_DATABASE_JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/define.hpp>
+#include <bitcoin/database/memory/memory_map.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+/// This class is not thread safe, commits must be serialized by the caller.
+/// A redo journal of the ranges written to a set of memory maps. Each commit
+/// appends the written bytes and is made durable by one sequential fsync of
+/// the journal. The maps are flushed at checkpoints, which truncate the
+/// journal, and a journal left by a failure is replayed into the files.
+class BCD_API journal
+  : noncopyable
+{
+public:
+    typedef boost::filesystem::path path;
+
+    /// Commits larger than this are checkpointed instead of journaled.
+    static const uint64_t maximum_commit;
+
+    /// Replay and remove the journal (if any), into files of its directory.
+    /// The files must not be mapped, a partial final commit is discarded.
+    static bool replay(const path& filename);
+
+    /// Construct a journal which checkpoints after interval commits.
+    journal(const path& filename, size_t interval);
+
+    /// Close the journal file (the file is not removed).
+    ~journal();
+
+    /// Record the writes to the file, attach before writing.
+    void attach(memory_map& file);
+
+    /// Create the journal file, discarding any existing content.
+    bool open();
+
+    /// Append the ranges written since the last commit and sync the journal.
+    bool commit();
+
+    /// Flush the attached files and truncate the journal.
+    bool checkpoint();
+
+    /// Remove the journal, call after the attached files are closed.
+    bool close();
+
+private:
+    bool write(const uint8_t* data, size_t size);
+    bool handle_error(const std::string& context) const;
+
+    const path filename_;
+    const size_t interval_;
+    std::vector<memory_map*> files_;
+    int file_handle_;
+    size_t commits_;
+    uint64_t size_;
+};
+
+} // namespace database
+} // namespace libbitcoin
+
+#endif
@@ -26,6 +26,10 @@
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
 
+#ifdef _MSC_VER
+    #include <xmmintrin.h>
+#endif
+
 namespace libbitcoin {
 namespace database {
 
@@ -66,6 +70,17 @@ public:
     #define REMAP_WRITE(mutex)
 #endif // REMAP_SAFETY
 
+// Hint that the address will soon be read. This neither blocks nor faults, so
+// a batch of prefetches overlaps the latency of its memory reads.
+#if defined(__GNUC__) || defined(__clang__)
+    #define PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER)
+    #define PREFETCH(address) _mm_prefetch( \
+        reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+    #define PREFETCH(address)
+#endif
+
 #ifdef ALLOCATE_SAFETY
     #define ALLOCATE_READ(mutex) shared_lock lock(mutex)
     #define ALLOCATE_WRITE(mutex) unique_lock lock(mutex)
@@ -23,18 +23,65 @@
 #include <sys/mman.h>
 #endif
 #include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/histogram.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 
 namespace libbitcoin {
 namespace database {
 
+/// Kernel hints for the mapping of a file, ignored where unsupported.
+/// The header hints apply to the hash table header, see advise_header.
+struct BCD_API mapping_policy
+{
+    /// The expected order of access to the file.
+    enum class access : uint8_t
+    {
+        normal,
+        random,
+        sequential
+    };
+
+    mapping_policy();
+
+    /// The access advice for the mapping (random).
+    access advice;
+
+    /// Back the mapping with transparent huge pages where possible.
+    bool huge_pages;
+
+    /// Interleave the pages of the mapping over the allowed NUMA nodes.
+    bool interleave;
+
+    /// Prefault the header when mapped.
+    bool populate_header;
+
+    /// Lock the header in memory (subject to RLIMIT_MEMLOCK).
+    bool lock_header;
+
+    /// Address space reserved for growth in place (zero disables).
+    /// Growth within the reservation does not move the mapping or wait on
+    /// readers, growth beyond it remaps and doubles the reservation.
+    size_t reservation;
+
+    /// Growth is rounded up to a multiple of the chunk, which is allocated
+    /// on disk (not sparse) and the next chunk allocated ahead by a worker
+    /// thread of the map (zero disables, where supported). This is set for
+    /// each table by the *_mapping members of database::settings.
+    size_t allocation_chunk;
+};
+
 /// This class is thread safe, allowing concurent read and write.
 /// A change to the size of the memory map waits on and locks read and write.
 class BCD_API memory_map
@@ -42,13 +89,23 @@ class BCD_API memory_map
 public:
     typedef boost::filesystem::path path;
     typedef std::shared_ptr<shared_mutex> mutex_ptr;
+    typedef std::pair<size_t, size_t> range;
+    typedef std::vector<range> ranges;
 
     static const size_t default_expansion;
 
+    /// The minor and major page faults of the process (if supported).
+    static void faults(size_t& out_minor, size_t& out_major);
+
+    /// The latencies of file growth by reserve, across all maps.
+    static histogram& resizes();
+
     /// Construct a database (start is currently called, may throw).
     memory_map(const path& filename);
     memory_map(const path& filename, mutex_ptr mutex);
     memory_map(const path& filename, mutex_ptr mutex, size_t expansion);
+    memory_map(const path& filename, mutex_ptr mutex, size_t expansion,
+        const mapping_policy& policy);
 
     /// Close the database.
     ~memory_map();
@@ -60,7 +117,7 @@ public:
     /// Open and map database files.
     bool open();
 
-    /// Flush the memory map to disk.
+    /// Flush the pages written since the last flush to disk.
     bool flush() const;
 
     /// Unmap and release database files, can be restarted.
@@ -75,6 +132,31 @@ public:
     memory_ptr reserve(size_t size);
     memory_ptr reserve(size_t size, size_t growth_ratio);
 
+    /// The name of the mapped file.
+    const path& filename() const;
+
+    /// Apply the header hints of the policy to the leading size bytes.
+    void advise_header(size_t size);
+
+    /// The number of bytes of the mapping resident in memory (if supported).
+    size_t resident() const;
+
+    // Written ranges.
+    // ------------------------------------------------------------------------
+
+    /// Start or stop recording written ranges (discards recorded ranges).
+    void track(bool enable);
+
+    /// Record a written range by offset, its pages are flushed by flush().
+    /// An accessor must be held, as the range is recorded without a lock.
+    void dirty(size_t offset, size_t size);
+
+    /// Record a written range by address, an accessor must be held.
+    void dirty(const uint8_t* address, size_t size);
+
+    /// Obtain and clear the written ranges (if tracking), ordered and coalesced.
+    ranges take_dirty();
+
 private:
     static size_t file_size(int file_handle);
     static int open_file(const boost::filesystem::path& filename);
@@ -84,16 +166,30 @@ private:
     size_t page() const;
     bool unmap();
     bool map(size_t size);
+    bool reserve_map(size_t size);
+    bool extend_map(size_t size);
     bool remap(size_t size);
     bool truncate(size_t size);
+    void preallocate(size_t size);
+    void preallocator();
+    void join_preallocation();
+    void stop_preallocation();
     bool truncate_mapped(size_t size);
+    bool truncate_reserved(size_t size);
+    size_t mapping_size() const;
+    size_t page_ceiling(size_t size) const;
     bool validate(size_t size);
+    void size_pages();
+    bool flush_pages(size_t& out_bytes) const;
+    bool advise();
+    void advise_header();
+    size_t resident_pages() const;
 
     void log_mapping() const;
     void log_resizing(size_t size) const;
-    void log_flushed() const;
+    void log_flushed(size_t bytes, size_t milliseconds) const;
     void log_unmapping() const;
-    void log_unmapped() const;
+    void log_unmapped(size_t resident) const;
 
     // Optionally guard against concurrent remap.
     mutex_ptr remap_mutex_;
@@ -102,13 +198,39 @@ private:
     const int file_handle_;
     const size_t expansion_;
     const boost::filesystem::path filename_;
+    const mapping_policy policy_;
 
-    // Protected by internal mutex.
+    // Protected by internal mutex, except that growth within the reservation
+    // changes file_size_ (only) while readers hold the mutex.
     uint8_t* data_;
-    size_t file_size_;
+    size_t reserved_;
+    std::atomic<size_t> file_size_;
     size_t logical_size_;
+    size_t header_size_;
+    bool header_locked_;
     std::atomic<bool> closed_;
     mutable upgrade_mutex mutex_;
+
+    // Written ranges are protected by mutex, and only recorded if tracking.
+    std::atomic<bool> tracking_;
+    ranges dirty_;
+    mutable shared_mutex dirty_mutex_;
+
+    // Pages are a bitmap of the pages written since the last flush. It spans
+    // the mapping (or reservation) and is only sized when it is mapped, so
+    // that writers can set its bits without a lock.
+    const size_t page_size_;
+    std::unique_ptr<std::atomic<uint64_t>[]> pages_;
+    size_t page_words_;
+
+    // Allocation of the chunk beyond the file, requested under the upgrade
+    // lock. The worker is started by the first request and lives until close.
+    // The requested position is zero when no allocation is outstanding.
+    std::thread preallocator_;
+    size_t preallocation_;
+    bool preallocator_stopping_;
+    std::mutex preallocation_mutex_;
+    std::condition_variable preallocation_condition_;
 };
 
 } // namespace database
@@ -25,17 +25,42 @@
 namespace libbitcoin {
 namespace database {
 
+/// The kind of table indexed by a header, as kinds share the file format.
+enum class table_kind : uint32_t
+{
+    chained = 0,
+    open = 1
+};
+
 /**
  * Implements contigious memory array with a fixed size elements.
  *
  * File format looks like:
  *
  *  [   size:IndexType   ]
+ *  [     version:4      ]
+ *  [       kind:4       ]
+ *  [   relocation:28    ]
+ *  [   padding:0-7      ]
  *  [ [      ...       ] ]
  *  [ [ item:ValueType ] ]
  *  [ [      ...       ] ]
  *
  * Empty elements are represented by the value hash_table_header.empty
+ *
+ * The version identifies the layout of the store and the kind identifies
+ * the table that the header indexes. Both are written by create, and a
+ * header of another version or kind fails start, so that a store written
+ * with another layout or table is rejected rather than misread.
+ *
+ * Items are padded to their natural alignment so that they can be read and
+ * written as atomic words, without a lock. A read observes either the old
+ * or the new value of a concurrent write, never a torn value.
+ *
+ * A header may also be placed at an offset within the file, which allows a
+ * table to grow its bucket array into its payload. The relocation record of
+ * the original header locates the bucket array(s) in use. It is zero unless
+ * the table has been resized, and is never read by a lookup.
  */
 template <typename IndexType, typename ValueType>
 class hash_table_header
@@ -43,31 +68,93 @@ class hash_table_header
 public:
     static const ValueType empty;
 
-    hash_table_header(memory_map& file, IndexType buckets);
+    /// The location of relocated items and of a migration in progress.
+    /// A zero offset refers to the original header, a zero target_offset
+    /// indicates that no migration is in progress.
+    struct relocation
+    {
+        file_offset offset;
+        IndexType buckets;
+        file_offset target_offset;
+        IndexType target_buckets;
+        IndexType migrated;
+    };
+
+    /// The layout version of the store. This must be incremented with any
+    /// change to the header, to the bucket placement of keys or to the rows
+    /// of a table. The tag in the high bytes distinguishes a version from
+    /// the first item of an unversioned header.
+    static BC_CONSTEXPR uint32_t version = 0x76620000 | 2;
+
+    /// The size of the relocation record, which follows the kind.
+    static BC_CONSTEXPR size_t relocation_size = 2 * sizeof(file_offset) +
+        3 * sizeof(IndexType);
+
+    /// The file offset of the relocation record.
+    static BC_CONSTEXPR file_offset relocation_offset = sizeof(IndexType) +
+        2 * sizeof(uint32_t);
+
+    /// The file offset of the first item, aligned to the item size.
+    static BC_CONSTEXPR file_offset items_offset =
+        (relocation_offset + relocation_size + sizeof(ValueType) - 1) /
+            sizeof(ValueType) * sizeof(ValueType);
+
+    hash_table_header(memory_map& file, IndexType buckets,
+        table_kind kind=table_kind::chained);
+
+    /// A header at the given offset within the file of the other header.
+    /// The offset must be aligned to the item size and the file must be
+    /// sized to hold the items.
+    hash_table_header(const hash_table_header& other, IndexType buckets,
+        file_offset offset);
 
     /// Allocate the hash table and populate with empty values.
     bool create();
 
     /// Must be called before use. Loads the size from the file.
+    /// Returns false if the file is of another size, version or kind.
     bool start();
 
-    /// Read item's value.
+    /// True if the relocation record is in use.
+    bool relocated() const;
+
+    /// Read the relocation record.
+    relocation read_relocation() const;
+
+    /// Write the relocation record (the original header only).
+    void write_relocation(const relocation& value);
+
+    /// Read item's value (acquire).
     ValueType read(IndexType index) const;
 
-    /// Write value to item.
+    /// Write value to item (release).
     void write(IndexType index, ValueType value);
 
+    /// Hint that the item will soon be read (does not block).
+    void prefetch(IndexType index) const;
+
+    /// Write value to item if it holds expected (acquire-release).
+    /// Returns false if the item held another value.
+    bool compare_exchange(IndexType index, ValueType expected,
+        ValueType value);
+
     /// The hash table size (bucket count).
     IndexType size() const;
 
+    /// The file offset of the header.
+    file_offset offset() const;
+
 private:
+    hash_table_header(memory_map& file, IndexType buckets, table_kind kind,
+        file_offset offset);
 
     // Locate the item in the memory map.
     file_offset item_position(IndexType index) const;
 
     memory_map& file_;
     IndexType buckets_;
-    mutable shared_mutex mutex_;
+    const table_kind kind_;
+    const file_offset offset_;
 };
 
 } // namespace database
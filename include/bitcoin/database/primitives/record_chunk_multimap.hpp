@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_RECORD_CHUNK_MULTIMAP_HPP
+#define LIBBITCOIN_DATABASE_RECORD_CHUNK_MULTIMAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/define.hpp>
+#include <bitcoin/database/memory/memory.hpp>
+#include <bitcoin/database/primitives/record_hash_table.hpp>
+#include <bitcoin/database/primitives/record_list.hpp>
+#include <bitcoin/database/primitives/record_manager.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+template <typename KeyType>
+BC_CONSTFUNC size_t hash_table_chunk_multimap_record_size(size_t summary_size)
+{
+    // The newest chunk index precedes the summary.
+    return hash_table_record_size<KeyType>(sizeof(array_index) +
+        summary_size);
+}
+
+BC_CONSTFUNC size_t chunk_record_size(size_t row_size, size_t chunk_rows)
+{
+    // The list link and row count precede the rows.
+    return sizeof(array_index) + sizeof(uint32_t) + chunk_rows * row_size;
+}
+
+/**
+ * A multimap hashtable where each key maps to a set of fixed size
+ * values, stored in chunks of rows.
+ *
+ * The map links keys to the newest chunk of a linked list of chunks.
+ * Rows are appended to the newest chunk until it is full, and then a
+ * new chunk is linked ahead of it. A chunk holds the count of its rows.
+ *
+ *   [ next:4  ]
+ *   [ count:4 ]
+ *   [ row     ] * chunk_rows
+ *
+ * Rows of a key are therefore mostly contiguous, and a scan reads one
+ * chunk per chunk_rows rows. Writers of a key are serialized by a fixed
+ * set of mutexes striped over the keys.
+ *
+ * The map value may also hold a fixed size summary of the rows of the key,
+ * which is updated with each added row and reverted with each deleted row.
+ */
+template <typename KeyType>
+class record_chunk_multimap
+{
+public:
+    typedef record_hash_table<KeyType> record_hash_table_type;
+    typedef serializer<uint8_t*>::functor write_function;
+
+    /// Update the summary in place for an added row.
+    typedef std::function<void(uint8_t* summary)> update_function;
+
+    /// Revert the summary in place for a deleted row, given the newest row
+    /// that remains.
+    typedef std::function<void(uint8_t* summary, const uint8_t* deleted,
+        const uint8_t* newest)> revert_function;
+
+    /// The number of writer mutexes, keys are mapped onto these by modulo.
+    static BC_CONSTEXPR size_t lock_stripes = 64;
+
+    /// The manager record size must be chunk_record_size(row_size, rows).
+    /// The map record size must be hash_table_chunk_multimap_record_size.
+    record_chunk_multimap(record_hash_table_type& map, record_manager& chunks,
+        size_t row_size, size_t chunk_rows, size_t summary_size=0);
+
+    /// Lookup a key, returning the index of its newest chunk.
+    array_index lookup(const KeyType& key) const;
+
+    /// A copy of the summary of the key, empty if the key doesn't exist.
+    data_chunk summary(const KeyType& key) const;
+
+    /// The index of the next older chunk, or record_list::empty.
+    array_index next(array_index chunk) const;
+
+    /// The number of rows in the chunk.
+    size_t count(array_index chunk) const;
+
+    /// The row at the position in the chunk, newer rows are at higher
+    /// positions.
+    memory_ptr get(array_index chunk, size_t position) const;
+
+    /// Add a new row for a key. If the key doesn't exist, it will be created
+    /// with a zeroed summary. The summary is updated once the row is added.
+    void add_row(const KeyType& key, write_function write,
+        update_function update=nullptr);
+
+    /// Delete the last row entry that was added. This means when deleting
+    /// blocks we must walk backwards and delete in reverse order. The
+    /// summary is reverted unless the key is removed.
+    bool delete_last_row(const KeyType& key, revert_function revert=nullptr);
+
+private:
+    typedef std::array<shared_mutex, lock_stripes> stripes;
+
+    // Add a new chunk with a single row ahead of the existing chunks.
+    array_index create_chunk(array_index next, write_function write);
+
+    // Create new key with a single row.
+    void create_new(const KeyType& key, write_function write,
+        update_function update);
+
+    // Revert the summary of a start info for the deleted row.
+    void revert_summary(uint8_t* start_info, revert_function revert,
+        memory_ptr deleted, memory_ptr newest);
+
+    // Set the row count of the chunk.
+    void set_count(array_index chunk, size_t count);
+
+    record_hash_table_type& map_;
+    record_manager& manager_;
+    record_list chunks_;
+    const size_t row_size_;
+    const size_t chunk_rows_;
+    const size_t summary_size_;
+
+    // Guards the chunk links and summaries of the map and the chunk counts.
+    mutable shared_mutex mutex_;
+
+    // Serializes the writers of a key.
+    stripes writers_;
+};
+
+} // namespace database
+} // namespace libbitcoin
+
+#include <bitcoin/database/impl/record_chunk_multimap.ipp>
+
+#endif
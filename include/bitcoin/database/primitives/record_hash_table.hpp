@@ -19,9 +19,13 @@
 #ifndef LIBBITCOIN_DATABASE_RECORD_HASH_TABLE_HPP
 #define LIBBITCOIN_DATABASE_RECORD_HASH_TABLE_HPP
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <tuple>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include <bitcoin/database/primitives/hash_table_header.hpp>
@@ -56,6 +60,10 @@ typedef hash_table_header<array_index, array_index> record_hash_table_header;
  * By using the record_manager instead of slabs, we can have smaller
  * indexes avoiding reading/writing extra bytes to the file.
  * Using fixed size records is therefore faster.
+ *
+ * Linking is guarded by a fixed set of mutexes striped over the buckets.
+ * Given a max_load the bucket array is doubled into the payload and the
+ * buckets are migrated incrementally by writers, as with slab_hash_table.
  */
 template <typename KeyType>
 class record_hash_table
@@ -63,7 +71,20 @@ class record_hash_table
 public:
     typedef serializer<uint8_t*>::functor write_function;
 
-    record_hash_table(record_hash_table_header& header, record_manager& manager);
+    /// The number of link mutexes, buckets are mapped onto these by modulo.
+    static BC_CONSTEXPR size_t lock_stripes = 64;
+
+    /// The number of buckets migrated by each store while resizing.
+    static BC_CONSTEXPR size_t migration_step = 16;
+
+    /// The max_load is the number of keys per hundred buckets above which
+    /// the bucket array is doubled, zero disables resizing.
+    record_hash_table(record_hash_table_header& header,
+        record_manager& manager, size_t max_load=0);
+
+    /// Load a relocated bucket array (if any) and estimate the key count.
+    /// Call after the header and manager are started.
+    bool start();
 
     /// Execute a write. The provided write() function must write the correct
     /// number of bytes (record_size - key_size - sizeof(array_index)).
@@ -76,24 +97,95 @@ public:
     /// Delete a key-value pair from the hashtable by unlinking the node.
     bool unlink(const KeyType& key);
 
+    /// Record an in-place write to a found value (see memory_map::dirty).
+    void dirty(const uint8_t* address, size_t size) const;
+
+    /// Migrate up to count buckets of a resize in progress.
+    /// Returns the number of buckets migrated.
+    size_t migrate(size_t count);
+
+    /// The number of buckets of the current bucket array.
+    size_t buckets() const;
+
+    /// The estimated number of keys, sampled by start() and then counted.
+    size_t keys() const;
+
+    /// The estimated number of keys per hundred buckets.
+    size_t load() const;
+
+    /// True if the bucket array is being migrated.
+    bool resizing() const;
+
+    /// The number of buckets of the current array already migrated.
+    size_t migrated() const;
+
 private:
-    // What is the bucket given a hash.
-    array_index bucket_index(const KeyType& key) const;
+    typedef std::array<shared_mutex, lock_stripes> stripes;
+    typedef std::array<std::atomic<size_t>, lock_stripes> versions;
+    typedef std::unique_ptr<record_hash_table_header> header_ptr;
+
+    // The stripe of a key, derived from the bucket of the original array.
+    size_t stripe(const KeyType& key) const;
 
-    // What is the record start index for a chain.
-    array_index read_bucket_value(const KeyType& key) const;
+    // The bucket array and bucket index of a key, given the resize state.
+    record_hash_table_header& locate(const KeyType& key,
+        array_index& index) const;
 
-    // Link a new chain into the bucket header.
-    void link(const KeyType& key, array_index begin);
+    // Find the key in the chain of the bucket.
+    array_index find_item(const record_hash_table_header& header,
+        array_index index, const KeyType& key) const;
+
+    // Unlink the key from the chain of the bucket.
+    bool unlink_item(record_hash_table_header& header, array_index index,
+        const KeyType& key);
+
+    // The number of items in the chain of the bucket.
+    size_t count_items(const record_hash_table_header& header,
+        array_index index) const;
+
+    // Lock the stripe guarding the bucket of the key.
+    shared_mutex& lock_bucket(const KeyType& key);
 
     // Release node from linked chain.
     template <typename ListItem>
     void release(const ListItem& item, file_offset previous);
 
+    // Start or advance a resize as required by the load.
+    void grow();
+
+    // Allocate the target bucket array, resize_mutex_ must be held.
+    bool begin_resize();
+
+    // Migrate buckets, resize_mutex_ must be held.
+    size_t migrate_locked(size_t count);
+
+    // Split a bucket of the current array into the target array.
+    void split(const record_hash_table_header& current,
+        record_hash_table_header& target, array_index index);
+
+    // Record the resize state in the original header.
+    void write_relocation();
+
+    // Create a bucket array header located by a relocation record.
+    record_hash_table_header* relocate(file_offset offset,
+        array_index buckets);
+
+    // Estimate the number of keys by sampling bucket chains.
+    size_t estimate() const;
+
     record_hash_table_header& header_;
     record_manager& manager_;
-    mutable shared_mutex mutex_;
-
+    mutable stripes mutexes_;
+
+    // Resize state, the target is null unless resizing.
+    const size_t max_load_;
+    std::atomic<size_t> keys_;
+    std::atomic<record_hash_table_header*> current_;
+    std::atomic<record_hash_table_header*> target_;
+    std::atomic<array_index> migrated_;
+    versions versions_;
+    std::vector<header_ptr> headers_;
+    shared_mutex resize_mutex_;
 };
 
 } // namespace database
@@ -33,7 +33,8 @@ namespace database {
 static BC_CONSTEXPR auto minimum_records_size = sizeof(array_index);
 BC_CONSTFUNC size_t record_hash_table_header_size(size_t buckets)
 {
-    return sizeof(array_index) + minimum_records_size * buckets;
+    // The size, version, kind and relocation record precede the buckets.
+    return 10 * sizeof(array_index) + minimum_records_size * buckets;
 }
 
 /// The record manager represents a collection of fixed size chunks of
@@ -67,6 +68,15 @@ public:
     /// Return memory object for the record at the specified index.
     const memory_ptr get(array_index record) const;
 
+    /// The file offset of the record at the specified index.
+    file_offset offset(array_index record) const;
+
+    /// The size of each record.
+    size_t record_size() const;
+
+    /// Record an in-place write within a record (see memory_map::dirty).
+    void dirty(const uint8_t* address, size_t size) const;
+
 private:
 
     // The record index of a disk position.
@@ -19,8 +19,12 @@
 #ifndef LIBBITCOIN_DATABASE_SLAB_HASH_TABLE_HPP
 #define LIBBITCOIN_DATABASE_SLAB_HASH_TABLE_HPP
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include <bitcoin/database/primitives/hash_table_header.hpp>
@@ -50,6 +54,17 @@ typedef hash_table_header<array_index, file_offset> slab_hash_table_header;
  * data can be lost but the hashtable is never corrupted.
  * Instead we prefer speed and batch that operation. The user should
  * call allocator.sync() after a series of store() calls.
+ *
+ * Linking is guarded by a fixed set of mutexes striped over the buckets,
+ * so concurrent writers only serialize when their buckets share a stripe.
+ *
+ * Given a max_load the table grows by doubling its bucket array into the
+ * payload. Buckets are migrated incrementally by writers, each bucket of
+ * the current array is split into two buckets of the target array. Readers
+ * are not locked, each stripe carries a version which is odd during the
+ * migration of one of its buckets, and a failed lookup that observed a
+ * version change is retried. The relocation is recorded in the original
+ * header and is resumed by start().
  */
 template <typename KeyType>
 class slab_hash_table
@@ -57,7 +72,20 @@ class slab_hash_table
 public:
     typedef serializer<uint8_t*>::functor write_function;
 
-    slab_hash_table(slab_hash_table_header& header, slab_manager& manager);
+    /// The number of link mutexes, buckets are mapped onto these by modulo.
+    static BC_CONSTEXPR size_t lock_stripes = 64;
+
+    /// The number of buckets migrated by each store while resizing.
+    static BC_CONSTEXPR size_t migration_step = 16;
+
+    /// The max_load is the number of keys per hundred buckets above which
+    /// the bucket array is doubled, zero disables resizing.
+    slab_hash_table(slab_hash_table_header& header, slab_manager& manager,
+        size_t max_load=0);
+
+    /// Load a relocated bucket array (if any) and estimate the key count.
+    /// Call after the header and manager are started.
+    bool start();
 
     /// Execute a write. value_size is the required size of the buffer.
     /// Returns the file offset of the new value.
@@ -71,33 +99,116 @@ public:
     /// Find the slab for a given key. Returns a null pointer if not found.
     memory_ptr find(const KeyType& key) const;
 
+    /// Hint that the key's bucket will soon be read (does not block).
+    void prefetch_bucket(const KeyType& key) const;
+
+    /// Hint that the first row of the key's bucket will soon be read. This
+    /// reads the bucket, so prefetch the buckets of a batch of keys first.
+    void prefetch_row(const KeyType& key) const;
+
     /// Delete a key-value pair from the hashtable by unlinking the node.
     bool unlink(const KeyType& key);
 
     template <typename UnaryFunction>
     void for_each(UnaryFunction f) const;
 
+    /// Migrate up to count buckets of a resize in progress.
+    /// Returns the number of buckets migrated.
+    size_t migrate(size_t count);
+
+    /// The number of times a writer found its bucket stripe locked.
+    size_t contention() const;
+
+    /// The number of buckets of the current bucket array.
+    size_t buckets() const;
+
+    /// The estimated number of keys, sampled by start() and then counted.
+    size_t keys() const;
+
+    /// The estimated number of keys per hundred buckets.
+    size_t load() const;
+
+    /// True if the bucket array is being migrated.
+    bool resizing() const;
+
+    /// The number of buckets of the current array already migrated.
+    size_t migrated() const;
+
 private:
+    typedef std::array<shared_mutex, lock_stripes> stripes;
+    typedef std::array<std::atomic<size_t>, lock_stripes> versions;
+    typedef std::unique_ptr<slab_hash_table_header> header_ptr;
+
+    // The stripe of a key, derived from the bucket of the original array.
+    size_t stripe(const KeyType& key) const;
+
+    // The bucket array and bucket index of a key, given the resize state.
+    slab_hash_table_header& locate(const KeyType& key,
+        array_index& index) const;
+
+    // Find the key in the chain of the bucket.
+    file_offset find_item(const slab_hash_table_header& header,
+        array_index index, const KeyType& key) const;
+
+    // Find the key in its chain, retrying if a migration interceded.
+    file_offset find_position(const KeyType& key) const;
+
+    // Unlink the key from the chain of the bucket.
+    bool unlink_item(slab_hash_table_header& header, array_index index,
+        const KeyType& key);
 
-    // What is the bucket given a hash.
-    array_index bucket_index(const KeyType& key) const;
+    // Apply the function to each item of the bucket, false if stopped.
+    template <typename UnaryFunction>
+    bool for_each_item(const slab_hash_table_header& header,
+        array_index index, UnaryFunction& f) const;
 
-    // What is the slab start position for a chain.
-    file_offset read_bucket_value(const KeyType& key) const;
+    // The number of items in the chain of the bucket.
+    size_t count_items(const slab_hash_table_header& header,
+        array_index index) const;
 
-    // Link a new chain into the bucket header.
-    void link(const KeyType& key, file_offset begin);
+    // Lock the stripe guarding the bucket of the key, counting collisions.
+    shared_mutex& lock_bucket(const KeyType& key);
 
     // Release node from linked chain.
     template <typename ListItem>
     void release(const ListItem& item, file_offset previous);
 
-    file_offset read_bucket_value_by_index(array_index index) const;
+    // Start or advance a resize as required by the load.
+    void grow();
+
+    // Allocate the target bucket array, resize_mutex_ must be held.
+    bool begin_resize();
+
+    // Migrate buckets, resize_mutex_ must be held.
+    size_t migrate_locked(size_t count);
+
+    // Split a bucket of the current array into the target array.
+    void split(const slab_hash_table_header& current,
+        slab_hash_table_header& target, array_index index);
+
+    // Record the resize state in the original header.
+    void write_relocation();
+
+    // Create a bucket array header located by a relocation record.
+    slab_hash_table_header* relocate(file_offset offset, array_index buckets);
 
+    // Estimate the number of keys by sampling bucket chains.
+    size_t estimate() const;
 
     slab_hash_table_header& header_;
     slab_manager& manager_;
-    mutable shared_mutex mutex_;
+    mutable stripes mutexes_;
+    std::atomic<size_t> contention_;
+
+    // Resize state, the target is null unless resizing.
+    const size_t max_load_;
+    std::atomic<size_t> keys_;
+    std::atomic<slab_hash_table_header*> current_;
+    std::atomic<slab_hash_table_header*> target_;
+    std::atomic<array_index> migrated_;
+    versions versions_;
+    std::vector<header_ptr> headers_;
+    shared_mutex resize_mutex_;
 };
 
 } // namespace database
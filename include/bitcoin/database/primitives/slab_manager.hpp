@@ -31,7 +31,8 @@ namespace database {
 BC_CONSTEXPR size_t minimum_slabs_size = sizeof(file_offset);
 BC_CONSTFUNC size_t slab_hash_table_header_size(size_t buckets)
 {
-    return sizeof(file_offset) + minimum_slabs_size * buckets;
+    // The size, version, kind and relocation record precede the buckets.
+    return 5 * sizeof(file_offset) + minimum_slabs_size * buckets;
 }
 
 /// The slab manager represents a growing collection of various sized
@@ -51,24 +52,32 @@ public:
     /// Synchronise the payload size to disk.
     void sync() const;
 
+    /// Synchronise a payload size read by payload_size to disk, so that
+    /// slabs allocated since are not committed.
+    void sync(file_offset payload_size) const;
+
+    /// Get the size of all slabs and size prefix (excludes header).
+    file_offset payload_size() const;
+
     /// Allocate a slab and return its position, sync() after writing.
     file_offset new_slab(size_t size);
 
     /// Return memory object for the slab at the specified position.
     const memory_ptr get(file_offset position) const;
 
-protected:
+    /// The file offset of the slab at the specified position.
+    file_offset offset(file_offset position) const;
 
-    /// Get the size of all slabs and size prefix (excludes header).
-    file_offset payload_size() const;
+    /// Record an in-place write within a slab (see memory_map::dirty).
+    void dirty(const uint8_t* address, size_t size) const;
 
 private:
 
     // Read the size of the data from the file.
     void read_size();
 
-    // Write the size of the data from the file.
-    void write_size() const;
+    // Write the size of the data to the file.
+    void write_size(file_offset payload_size) const;
 
     // This class is thread and remap safe.
     memory_map& file_;
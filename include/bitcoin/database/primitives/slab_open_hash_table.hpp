@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_DATABASE_SLAB_OPEN_HASH_TABLE_HPP
+#define LIBBITCOIN_DATABASE_SLAB_OPEN_HASH_TABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/memory/memory.hpp>
+#include <bitcoin/database/primitives/hash_table_header.hpp>
+#include <bitcoin/database/primitives/slab_hash_table.hpp>
+#include <bitcoin/database/primitives/slab_manager.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+/**
+ * A hashtable mapping hashes to variable sized values (slabs), using open
+ * addressing (linear probing) over the bucket array in place of chaining.
+ *
+ * Each bucket packs a short fingerprint of the key with the slab position,
+ * so that probes over non-matching keys are resolved within the bucket
+ * array, without a read of the slab:
+ *
+ *   [ fingerprint:2 ][ position:6 ]
+ *
+ * The slab holds the key and the value, there is no next pointer:
+ *
+ *   [ KeyType  ]
+ *   [ value... ]
+ *
+ * Buckets are claimed by compare-and-swap, so store takes no lock. Unlinked
+ * buckets become tombstones, which find skips and store reuses. A run of
+ * tombstones that ends at an empty bucket is emptied by unlink, unless a
+ * store is in progress, so that probes remain short under churn. The table
+ * does not grow, so buckets must exceed the number of keys with headroom
+ * for short probes. Each store consumes a bucket held by reserve, which
+ * fails when the table is full, so that a writer can fail before it writes.
+ *
+ * Duplicate keys are ordered newest first in the probe sequence, so a probe
+ * ends at the first match.
+ *
+ * The header file format is that of the slab_hash_table, of the open kind.
+ * The user should call allocator.sync() after a series of store() calls.
+ */
+template <typename KeyType>
+class slab_open_hash_table
+{
+public:
+    typedef serializer<uint8_t*>::functor write_function;
+
+    static BC_CONSTEXPR size_t key_size = std::tuple_size<KeyType>::value;
+
+    slab_open_hash_table(slab_hash_table_header& header,
+        slab_manager& manager);
+
+    /// Must be called before use. Counts the claimed buckets.
+    bool start();
+
+    /// Hold buckets for the given number of stores.
+    /// Returns false, holding none, if the table cannot hold them.
+    bool reserve(size_t count);
+
+    /// Return buckets held by reserve and not consumed by store.
+    void release(size_t count);
+
+    /// Execute a write, consuming a bucket held by reserve. value_size is
+    /// the required size of the buffer. Returns the file offset of the new
+    /// value (or zero if no bucket was reserved).
+    file_offset store(const KeyType& key, write_function write,
+        size_t value_size);
+
+    /// Execute a writer against a key's buffer if the key is found.
+    /// Returns the file offset of the found value (or zero).
+    file_offset update(const KeyType& key, write_function write);
+
+    /// Find the slab for a given key. Returns a null pointer if not found.
+    memory_ptr find(const KeyType& key) const;
+
+    /// Hint that the key's bucket will soon be read (does not block).
+    void prefetch_bucket(const KeyType& key) const;
+
+    /// Hint that the first row of the key's bucket will soon be read. This
+    /// reads the bucket, so prefetch the buckets of a batch of keys first.
+    void prefetch_row(const KeyType& key) const;
+
+    /// Delete a key-value pair from the hashtable by tombstoning its bucket.
+    bool unlink(const KeyType& key);
+
+    template <typename UnaryFunction>
+    void for_each(UnaryFunction f) const;
+
+private:
+    // The number of counters of stores in progress.
+    static BC_CONSTEXPR size_t store_stripes = 16;
+
+    // A counter of stores in progress, padded to its own cache line.
+    struct stores
+    {
+        std::atomic<size_t> count;
+        uint8_t padding[64 - sizeof(std::atomic<size_t>)];
+    };
+
+    // A bucket that has been unlinked (distinct from empty).
+    static const file_offset tombstone;
+
+    // The first bucket in the probe sequence of the key.
+    array_index bucket_index(const KeyType& key) const;
+
+    // The fingerprint of the key, as positioned within a bucket.
+    file_offset fingerprint(const KeyType& key) const;
+
+    // Find the bucket of the most recently stored value of the key.
+    bool find_bucket(array_index& out_index, file_offset& out_position,
+        const KeyType& key) const;
+
+    // Empty the tombstone at the index, and the run of tombstones preceding
+    // it, if the following bucket is empty and no store is in progress.
+    void collapse(array_index index);
+
+    // Does the slab at the position hold the key?
+    bool compare(file_offset position, const KeyType& key) const;
+
+    slab_hash_table_header& header_;
+    slab_manager& manager_;
+    std::array<stores, store_stripes> stores_;
+
+    // The number of buckets claimed by keys or held by reserve.
+    std::atomic<size_t> claimed_;
+};
+
+} // namespace database
+} // namespace libbitcoin
+
+#include <bitcoin/database/impl/slab_open_hash_table.ipp>
+
+#endif
@@ -29,9 +29,19 @@ namespace libbitcoin {
 namespace database {
 
 /// Deferred read transaction result.
+/// The stored transaction is preceded by a table of the offsets of its outputs
+/// within it, so that an output is reached without parsing those before it.
+/// [height:4][position:4][outputs:4][offset:4]...[transaction]
 class BCD_API transaction_result
 {
 public:
+    /// The size of the output offset table of the transaction.
+    static size_t offsets_size(const chain::transaction& tx);
+
+    /// Write the output offset table of the transaction.
+    static void write_offsets(serializer<uint8_t*>& serial,
+        const chain::transaction& tx);
+
     transaction_result(const memory_ptr slab);
     transaction_result(const memory_ptr slab, hash_digest&& hash);
     transaction_result(const memory_ptr slab, const hash_digest& hash);
@@ -57,10 +67,29 @@ public:
     /// The output at the specified index within this transaction.
     chain::output output(uint32_t index) const;
 
+    /// The outputs of the transaction (including spender heights).
+    chain::output::list outputs() const;
+
+    /// The inputs of the transaction.
+    chain::input::list inputs() const;
+
+    /// The previous outputs of the inputs, read without parsing scripts.
+    chain::output_point::list previous_outputs() const;
+
+    /// The size of the output offset table and transaction as stored.
+    size_t body_size() const;
+
+    /// Write the output offset table and transaction as stored, given its
+    /// body_size (which walks the inputs, so is obtained once).
+    void write_body(serializer<uint8_t*>& serial, size_t size) const;
+
     /// The transaction.
     chain::transaction transaction() const;
 
 private:
+    static uint8_t* output_address(uint8_t* memory, uint32_t index);
+    static uint8_t* inputs_address(uint8_t* memory);
+
     memory_ptr slab_;
     const hash_digest hash_;
 };
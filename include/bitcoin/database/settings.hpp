@@ -22,6 +22,8 @@
 #include <cstdint>
 #include <boost/filesystem.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/memory/memory_map.hpp>
+#include <bitcoin/database/unspent_outputs.hpp>
 
 namespace libbitcoin {
 namespace database {
@@ -36,6 +38,7 @@ public:
     /// Properties.
     boost::filesystem::path directory;
     bool flush_writes;
+    uint32_t flush_journal_interval;
     uint16_t file_growth_rate;
     uint32_t index_start_height;
     uint32_t block_table_buckets;
@@ -43,7 +46,25 @@ public:
     uint32_t transaction_unconfirmed_table_buckets;
     uint32_t spend_table_buckets;
     uint32_t history_table_buckets;
+    bool transaction_table_open_addressing;
+    bool transaction_unconfirmed_table_open_addressing;
+    uint16_t hash_table_max_load;
     uint32_t cache_capacity;
+    uint64_t cache_budget;
+    eviction_policy cache_policy;
+
+    /// The kernel and file system policies of each table file. These are
+    /// set per file, for example transaction_table_mapping.allocation_chunk
+    /// grows the transaction table in whole chunks allocated ahead (see
+    /// mapping_policy). The defaults apply no policy.
+    mapping_policy block_table_mapping;
+    mapping_policy block_index_mapping;
+    mapping_policy transaction_table_mapping;
+    mapping_policy transaction_unconfirmed_table_mapping;
+    mapping_policy spend_table_mapping;
+    mapping_policy history_table_mapping;
+    mapping_policy history_rows_mapping;
+    mapping_policy stealth_rows_mapping;
     config::endpoint replier;
 };
 
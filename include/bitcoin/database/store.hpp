@@ -95,6 +95,12 @@ public:
     const path history_rows;
     const path stealth_rows;
 
+    /// Optional output cache snapshot (not created).
+    const path cache_snapshot;
+
+    /// Optional journal of flushed writes (not created).
+    const path write_journal;
+
 protected:
     virtual bool flush() const = 0;
 
@@ -22,9 +22,12 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 #include <boost/bimap.hpp>
 #include <boost/bimap/set_of.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
+#include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
 #include <bitcoin/database/unspent_transaction.hpp>
@@ -32,14 +35,37 @@
 namespace libbitcoin {
 namespace database {
 
+/// The choice of cache entry to evict when the cache is full.
+enum class eviction_policy : uint8_t
+{
+    /// The least recently added.
+    fifo,
+
+    /// The least recently read, each hit takes an exclusive shard lock.
+    lru,
+
+    /// The least recently added not read since it was last passed over.
+    clock,
+
+    /// The lowest height, as young coins are the most likely to be spent.
+    young
+};
+
 /// This class is thread safe.
 /// A circular-by-age hash table of [point, output].
+/// The table is sharded by tx hash, each shard with its own lock and age
+/// order, so that readers and writers of different shards do not contend.
 class BCD_API unspent_outputs
   : noncopyable
 {
 public:
-    // Construct a cache with the specified transaction count limit.
-    unspent_outputs(size_t capacity);
+    /// The maximum number of shards (fewer if capacity is lower).
+    static const size_t max_shards;
+
+    // Construct a cache with the specified transaction count limit and byte
+    // budget (zero for no budget), evicting entries by the policy.
+    unspent_outputs(size_t capacity, size_t budget=0,
+        eviction_policy policy=eviction_policy::fifo);
 
     /// The cache capacity is zero.
     bool disabled() const;
@@ -50,9 +76,24 @@ public:
     /// The number of elements in the cache.
     size_t size() const;
 
+    /// The approximate number of bytes used by the elements of the cache.
+    size_t bytes() const;
+
+    /// The number of elements evicted to make room for others.
+    size_t evictions() const;
+
     /// The cache performance as a ratio of hits to accesses.
     float hit_rate() const;
 
+    /// The number of shards.
+    size_t shards() const;
+
+    /// The number of hits in the shard.
+    size_t hits(size_t shard) const;
+
+    /// The number of accesses of the shard.
+    size_t queries(size_t shard) const;
+
     /// Add a set of outputs to the cache (purges older entry).
     void add(const chain::transaction& transaction, size_t height,
         bool confirmed);
@@ -68,6 +109,17 @@ public:
         const chain::output_point& point, size_t fork_height,
         bool require_confirmed) const;
 
+    /// Write the cache, oldest first, to a file tagged with the top block of
+    /// the store with which the cache is consistent.
+    bool save(const boost::filesystem::path& file,
+        const config::checkpoint& top) const;
+
+    /// Add the contents of a file saved at the same top block. The file is
+    /// removed, so that it cannot be loaded after the store has changed.
+    /// Returns false if the file is missing, invalid or saved at another top.
+    bool load(const boost::filesystem::path& file,
+        const config::checkpoint& top);
+
     bool get_is_confirmed(chain::output& out_output, size_t& out_height, bool& out_coinbase, bool& out_is_confirmed,
         const chain::output_point& point, size_t fork_height,
         bool require_confirmed) const;
@@ -76,19 +128,43 @@ public:
 private:
     // A bidirection map is used for efficient output and position retrieval.
     // This produces the effect of a circular buffer tx hash table of outputs.
+    // The ordering key is the sequence, preceded by the height for the young
+    // coins policy.
     typedef boost::bimaps::bimap<
         boost::bimaps::unordered_set_of<unspent_transaction>,
-        boost::bimaps::set_of<uint32_t>> unspent_transactions;
+        boost::bimaps::set_of<uint64_t>> unspent_transactions;
+
+    struct shard
+    {
+        shard(size_t capacity, size_t budget);
+
+        // These are thread safe.
+        const size_t capacity;
+        const size_t budget;
+        mutable std::atomic<size_t> hits;
+        mutable std::atomic<size_t> queries;
+        std::atomic<size_t> evictions;
+
+        // These are protected by mutex.
+        uint64_t sequence;
+        size_t bytes;
+        unspent_transactions unspent;
+        mutable upgrade_mutex mutex;
+    };
+
+    typedef std::unique_ptr<shard> shard_ptr;
+
+    shard& select(const hash_digest& tx_hash) const;
+    uint64_t order(shard& shard, const unspent_transaction& unspent) const;
+    void evict(shard& shard, size_t bytes);
+    void insert(unspent_transaction&& unspent);
 
     // These are thread safe.
     const size_t capacity_;
-    mutable std::atomic<size_t> hits_;
-    mutable std::atomic<size_t> queries_;
+    const eviction_policy policy_;
 
-    // These are protected by mutex.
-    uint32_t sequence_;
-    unspent_transactions unspent_;
-    mutable upgrade_mutex mutex_;
+    // The shards are not resized after construction.
+    std::vector<shard_ptr> shards_;
 };
 
 } // namespace database
@@ -19,10 +19,11 @@
 #ifndef LIBBITCOIN_DATABASE_UNSPENT_TRANSACTION_HPP
 #define LIBBITCOIN_DATABASE_UNSPENT_TRANSACTION_HPP
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
-#include <memory>
-#include <unordered_map>
+#include <vector>
+#include <boost/container/flat_map.hpp>
 #include <boost/functional/hash_fwd.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
@@ -34,8 +35,11 @@ namespace database {
 class BCD_API unspent_transaction
 {
 public:
-    typedef std::unordered_map<uint32_t, chain::output> output_map;
-    typedef std::shared_ptr<output_map> output_map_ptr;
+    // The outputs are stored inline, ordered by index. A removed output is
+    // marked in place, and the map is compacted once half of it is removed,
+    // so that the removal of each output of a large tx is amortized O(1).
+    typedef boost::container::flat_map<uint32_t, chain::output> output_map;
+    typedef output_map* output_map_ptr;
 
     // Move/copy constructors.
     unspent_transaction(unspent_transaction&& other);
@@ -46,6 +50,8 @@ public:
     explicit unspent_transaction(const chain::output_point& point);
     explicit unspent_transaction(const chain::transaction& tx, size_t height,
         bool confirmed);
+    explicit unspent_transaction(const hash_digest& hash, size_t height,
+        bool coinbase, bool confirmed, output_map&& outputs);
 
     /// Properties.
     size_t height() const;
@@ -54,8 +60,25 @@ public:
     const hash_digest& hash() const;
 
     /// Access to outputs is mutable and unprotected (not thread safe).
+    /// This includes outputs that have been removed but not compacted.
     output_map_ptr outputs() const;
 
+    /// The output at the index, null if not present or removed.
+    const chain::output* find(uint32_t index) const;
+
+    /// True if the output at the position within outputs has been removed.
+    bool removed(size_t position) const;
+
+    /// Remove the output at the index, false if not present or removed.
+    bool remove(uint32_t index) const;
+
+    /// The number of outputs that have not been removed.
+    size_t size() const;
+
+    /// The entry has been read since the flag was last cleared (thread safe).
+    bool referenced() const;
+    void set_referenced(bool value) const;
+
     /// Operators.
     bool operator==(const unspent_transaction& other) const;
     unspent_transaction& operator=(unspent_transaction&& other);
@@ -71,7 +94,15 @@ private:
 
     // This is not thead safe and is publicly reachable.
     // The outputs can be changed without affecting the bimapping.
-    mutable output_map_ptr outputs_;
+    mutable output_map outputs_;
+
+    // These are not thread safe, the removal marks by position in outputs_
+    // (empty until an output is removed) and their count.
+    mutable std::vector<bool> removed_;
+    mutable size_t removed_count_;
+
+    // This is thread safe and does not affect the bimapping.
+    mutable std::atomic<bool> referenced_;
 };
 
 } // namespace database
@@ -19,14 +19,18 @@
 #include <bitcoin/database/data_base.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/define.hpp>
+#include <bitcoin/database/histogram.hpp>
 #include <bitcoin/database/settings.hpp>
 #include <bitcoin/database/store.hpp>
 
@@ -105,7 +109,7 @@ bool data_base::create(const block& genesis)
             history_->create() &&
             stealth_->create();
 
-    if (!created)
+    if (!created || (journal_ && !journal_->open()))
         return false;
 
     // Store the first block.
@@ -123,6 +127,10 @@ bool data_base::open()
     if (!store::open())
         return false;
 
+    // Restore the writes committed before an unclean shutdown.
+    if (!journal::replay(write_journal))
+        return false;
+
     start();
 
     auto opened =
@@ -141,6 +149,14 @@ bool data_base::open()
             history_->open() &&
             stealth_->open();
 
+    opened = opened && (!journal_ || journal_->open());
+
+    // The snapshot is loaded before any write, since a concurrent load could
+    // restore an output spent after the open.
+    config::checkpoint top;
+    if (opened && top_checkpoint(top))
+        transactions_->load_cache(cache_snapshot, top);
+
     closed_ = false;
     return opened;
 }
@@ -154,6 +170,12 @@ bool data_base::close()
 
     closed_ = true;
 
+    // The cache is consistent with the store as of the top block. The outcome
+    // is ignored since the snapshot is an optimization.
+    config::checkpoint top;
+    if (top_checkpoint(top))
+        transactions_->save_cache(cache_snapshot, top);
+
     auto closed =
         blocks_->close() &&
         transactions_->close() &&
@@ -171,11 +193,45 @@ bool data_base::close()
             history_->close() &&
             stealth_->close();
 
+    // The files are flushed on close, so the journal is no longer required.
+    if (journal_)
+        closed = closed && journal_->close();
+
+    // Faults are not attributed to files, the maps log their own residency.
+    size_t minor_faults;
+    size_t major_faults;
+    memory_map::faults(minor_faults, major_faults);
+
+    LOG_DEBUG(LOG_DATABASE)
+        << "Page faults: minor [" << minor_faults << "], major ["
+        << major_faults << "]";
+
+    for (const auto& latency: latencies())
+        LOG_DEBUG(LOG_DATABASE)
+            << "Latency " << latency;
+
     return closed && store::close();
     // Unlock exclusive file access and conditionally the global flush lock.
     ///////////////////////////////////////////////////////////////////////////
 }
 
+// private
+bool data_base::top_checkpoint(config::checkpoint& out_top) const
+{
+    size_t height;
+
+    if (!blocks_->top(height))
+        return false;
+
+    const auto result = blocks_->get(height);
+
+    if (!result)
+        return false;
+
+    out_top = config::checkpoint{ result.hash(), height };
+    return true;
+}
+
 // protected
 void data_base::start()
 {
@@ -183,15 +239,21 @@ void data_base::start()
 
     blocks_ = std::make_shared<block_database>(block_table, block_index,
         settings_.block_table_buckets, settings_.file_growth_rate,
-        remap_mutex_);
+        remap_mutex_, settings_.block_table_mapping,
+        settings_.block_index_mapping);
 
     transactions_ = std::make_shared<transaction_database>(transaction_table,
         settings_.transaction_table_buckets, settings_.file_growth_rate,
-        settings_.cache_capacity, remap_mutex_);
+        settings_.cache_capacity, remap_mutex_,
+        settings_.transaction_table_open_addressing,
+        settings_.hash_table_max_load, settings_.cache_budget,
+        settings_.cache_policy, settings_.transaction_table_mapping);
 
     //TODO: BITPRIM: FER: transaction_table_buckets and file_growth_rate
     transactions_unconfirmed_ = std::make_shared<transaction_unconfirmed_database>(transaction_unconfirmed_table,
-        settings_.transaction_unconfirmed_table_buckets, settings_.file_growth_rate, remap_mutex_);
+        settings_.transaction_unconfirmed_table_buckets, settings_.file_growth_rate, remap_mutex_,
+        settings_.transaction_unconfirmed_table_open_addressing,
+        settings_.transaction_unconfirmed_table_mapping);
 
 
     if (use_indexes)
@@ -200,14 +262,36 @@ void data_base::start()
         // unspents_ = std::make_shared<unspent_database_v2>(unspent_table, "unspent_table", mutex_);
         spends_ = std::make_shared<spend_database>(spend_table,
             settings_.spend_table_buckets, settings_.file_growth_rate,
-            remap_mutex_);
+            remap_mutex_, settings_.hash_table_max_load,
+            settings_.spend_table_mapping);
 
         history_ = std::make_shared<history_database>(history_table,
             history_rows, settings_.history_table_buckets,
-            settings_.file_growth_rate, remap_mutex_);
+            settings_.file_growth_rate, remap_mutex_,
+            settings_.history_table_mapping, settings_.history_rows_mapping);
 
         stealth_ = std::make_shared<stealth_database>(stealth_rows,
-            settings_.file_growth_rate, remap_mutex_);
+            settings_.file_growth_rate, remap_mutex_,
+            settings_.stealth_rows_mapping);
+    }
+
+    journal_.reset();
+
+    if (!settings_.flush_writes || settings_.flush_journal_interval == 0)
+        return;
+
+    journal_ = std::make_shared<journal>(write_journal,
+        settings_.flush_journal_interval);
+
+    blocks_->attach(*journal_);
+    transactions_->attach(*journal_);
+    transactions_unconfirmed_->attach(*journal_);
+
+    if (use_indexes)
+    {
+        spends_->attach(*journal_);
+        history_->attach(*journal_);
+        stealth_->attach(*journal_);
     }
 }
 
@@ -221,6 +305,12 @@ bool data_base::flush() const
     ////if (closed_)
     ////    return true;
 
+    const histogram::timer timer(flush_latency_);
+
+    // A single sync of the journal, the files are flushed at its checkpoints.
+    if (journal_)
+        return journal_->commit();
+
     auto flushed =
         blocks_->flush() &&
         transactions_->flush() &&
@@ -242,6 +332,13 @@ bool data_base::flush() const
 
 // protected
 void data_base::synchronize()
+{
+    synchronize(transactions_->end());
+}
+
+// protected
+// Transactions stored after the end (by a pipelined push) are not committed.
+void data_base::synchronize(file_offset transactions_end)
 {
     if (use_indexes)
     {
@@ -251,7 +348,7 @@ void data_base::synchronize()
         stealth_->synchronize();
     }
 
-    transactions_->synchronize();
+    transactions_->synchronize(transactions_end);
     transactions_unconfirmed_->synchronize();
     blocks_->synchronize();
 }
@@ -297,6 +394,47 @@ const stealth_database& data_base::stealth() const
     return *stealth_;
 }
 
+// Metrics.
+// ----------------------------------------------------------------------------
+
+// Pipelined pushes record their stages, so that push_transactions is storage
+// plus indexing and push_heights is spend marking, as in a synchronous push.
+latency::list data_base::latencies() const
+{
+    latency::list out
+    {
+        { "push", push_latency_.capture() },
+        { "push_transactions", push_transactions_latency_.capture() },
+        { "push_heights", push_heights_latency_.capture() },
+        { "pop", pop_latency_.capture() },
+        { "reorganize", reorganize_latency_.capture() },
+        { "flush", flush_latency_.capture() },
+        { "memory_map.reserve", memory_map::resizes().capture() }
+    };
+
+    if (transactions_)
+    {
+        const auto reads = transactions_->latencies();
+        out.insert(out.end(), reads.begin(), reads.end());
+    }
+
+    return out;
+}
+
+void data_base::reset_latencies()
+{
+    push_latency_.reset();
+    push_transactions_latency_.reset();
+    push_heights_latency_.reset();
+    pop_latency_.reset();
+    reorganize_latency_.reset();
+    flush_latency_.reset();
+    memory_map::resizes().reset();
+
+    if (transactions_)
+        transactions_->reset_latencies();
+}
+
 // Synchronous writers.
 // ----------------------------------------------------------------------------
 
@@ -339,6 +477,19 @@ code data_base::verify_push(const block& block, size_t height)
     return error::success;
 }
 
+// Blocks after the first of a push_all are linked to their predecessor, as
+// the predecessor header may not yet be stored.
+code data_base::verify_push(const block& block, const chain::block& parent)
+{
+    if (block.transactions().empty())
+        return error::empty_block;
+
+    if (block.header().previous_block_hash() != parent.header().hash())
+        return error::store_block_missing_parent;
+
+    return error::success;
+}
+
 code data_base::verify_push(const transaction& tx)
 {
     const auto result = transactions_->get(tx.hash(), max_size_t, false);
@@ -368,11 +519,16 @@ bool data_base::end_insert() const
 // This is designed for write concurrency but only with itself.
 code data_base::insert(const chain::block& block, size_t height)
 {
+    const histogram::timer timer(push_latency_);
     const auto ec = verify_insert(block, height);
 
     if (ec)
         return ec;
 
+    // The table must hold the txs before any is written.
+    if (!transactions_->reserve(block.transactions().size()))
+        return error::operation_failed;
+
     if (!push_transactions(block, height) || !push_heights(block, height))
         return error::operation_failed;
 
@@ -394,6 +550,16 @@ code data_base::push(const chain::transaction& tx, uint32_t forks)
     if (ec)
         return ec;
 
+    // The tables must hold the tx before it is written.
+    if (!transactions_->reserve(1))
+        return error::operation_failed;
+
+    if (!transactions_unconfirmed_->reserve(1))
+    {
+        transactions_->release(1);
+        return error::operation_failed;
+    }
+
     // Begin Flush Lock and Sequential Lock
     //vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
     if (!begin_write())
@@ -419,11 +585,16 @@ code data_base::push(const block& block, size_t height)
     ///////////////////////////////////////////////////////////////////////////
     unique_lock lock(write_mutex_);
 
+    const histogram::timer timer(push_latency_);
     const auto ec = verify_push(block, height);
 
     if (ec)
         return ec;
 
+    // The table must hold the txs before any is written.
+    if (!transactions_->reserve(block.transactions().size()))
+        return error::operation_failed;
+
     // Begin Flush Lock and Sequential Lock
     //vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
     if (!begin_write())
@@ -444,6 +615,16 @@ code data_base::push(const block& block, size_t height)
 // To push in order call with bucket = 0 and buckets = 1 (defaults).
 bool data_base::push_transactions(const chain::block& block, size_t height,
     size_t bucket, size_t buckets)
+{
+    const histogram::timer timer(push_transactions_latency_);
+
+    return
+        store_transactions(block, height, bucket, buckets) &&
+        index_transactions(block, height, bucket, buckets);
+}
+
+bool data_base::store_transactions(const chain::block& block, size_t height,
+    size_t bucket, size_t buckets)
 {
     BITCOIN_ASSERT(bucket < buckets);
     const auto& txs = block.transactions();
@@ -455,17 +636,33 @@ bool data_base::push_transactions(const chain::block& block, size_t height,
         const auto& tx = txs[position];
         transactions_->store(tx, height, position);
         transactions_unconfirmed_->unlink_if_exists(tx.hash());
+    }
 
-        if (height < settings_.index_start_height)
-            continue;
+    return true;
+}
+
+bool data_base::index_transactions(const chain::block& block, size_t height,
+    size_t bucket, size_t buckets)
+{
+    BITCOIN_ASSERT(bucket < buckets);
 
-        const auto tx_hash = tx.hash();
+    if (height < settings_.index_start_height)
+        return true;
+
+    const auto& txs = block.transactions();
+    const auto count = txs.size();
+
+    for (auto position = bucket; position < count;
+        position = ceiling_add(position, buckets))
+    {
+        const auto& tx = txs[position];
+        const decoded_transaction decoded(tx);
 
         if (position != 0)
-            push_inputs(tx_hash, height, tx.inputs());
+            push_inputs(decoded, height, tx.inputs());
 
-        push_outputs(tx_hash, height, tx.outputs());
-        push_stealth(tx_hash, height, tx.outputs());
+        push_outputs(decoded, height, tx.outputs());
+        push_stealth(decoded, height);
     }
 
     return true;
@@ -473,118 +670,115 @@ bool data_base::push_transactions(const chain::block& block, size_t height,
 
 bool data_base::push_heights(const chain::block& block, size_t height)
 {
+    const histogram::timer timer(push_heights_latency_);
     transactions_->synchronize();
+    return push_spends(block, height);
+}
+
+bool data_base::push_spends(const chain::block& block, size_t height)
+{
     const auto& txs = block.transactions();
 
     // Skip coinbase as it has no previous output.
-    for (auto tx = txs.begin() + 1; tx != txs.end(); ++tx) {
-        for (const auto& input: tx->inputs()) {
-            if (!transactions_->spend(input.previous_output(), height)) {
+    for (auto tx = txs.begin() + 1; tx != txs.end(); ++tx)
+        for (const auto& input: tx->inputs())
+            if (!transactions_->spend(input.previous_output(), height))
                 return false;
-            }
-        }
-    }
 
     return true;
 }
 
-void data_base::push_inputs(const hash_digest& tx_hash, size_t height,
-    const input::list& inputs)
+bool data_base::push_spends(const output_point::list& previous_outputs,
+    size_t height)
 {
-    //std::cout << "FER - void data_base::push_inputs(const hash_digest& tx_hash, size_t height, const input::list& inputs)\n";
+    for (const auto& previous: previous_outputs)
+        if (!transactions_->spend(previous, height))
+            return false;
 
-    for (uint32_t index = 0; index < inputs.size(); ++index)
-    {
-        const auto& input = inputs[index];
-        const input_point point{ tx_hash, index };
+    return true;
+}
 
-        spends_->store(input.previous_output(), point);
+// Inputs are partitioned by previous output tx hash, so that no two buckets
+// update the same transaction.
+data_base::spends_ptr data_base::partition_spends(const chain::block& block,
+    size_t buckets)
+{
+    BITCOIN_ASSERT(buckets != 0);
+    const auto spends = std::make_shared<std::vector<output_point::list>>(
+        buckets);
 
-        // Try to extract an address.
-        const auto address = input.address();
-        if (!address)
-            continue;
+    const auto& txs = block.transactions();
 
-        const auto& previous = input.previous_output();
-        history_->add_input(address.hash(), point, height, previous);
+    // Skip coinbase as it has no previous output.
+    for (auto tx = txs.begin() + 1; tx != txs.end(); ++tx)
+    {
+        for (const auto& input: tx->inputs())
+        {
+            const auto& previous = input.previous_output();
+            (*spends)[remainder(previous.hash(), buckets)].push_back(previous);
+        }
     }
 
-    //std::cout << "FER - void data_base::push_inputs(const hash_digest& tx_hash, size_t height, const input::list& inputs) - END\n";
-
+    return spends;
 }
 
-void data_base::push_outputs(const hash_digest& tx_hash, size_t height,
-    const output::list& outputs)
+void data_base::push_inputs(const decoded_transaction& decoded,
+    size_t height, const input::list& inputs)
 {
-    // OLD before merging (Feb2017)
-    //std::cout << "FER - void data_base::push_outputs(const hash_digest& tx_hash, size_t height, const output::list& outputs)\n";
-    // if (height < settings_.index_start_height)
-    //     return;
+    const auto& tx_hash = decoded.hash();
 
-    for (uint32_t index = 0; index < outputs.size(); ++index)
+    for (uint32_t index = 0; index < inputs.size(); ++index)
     {
-        const auto& output = outputs[index];
-
-        // Try to extract an address.
-        const auto address = output.address();
-        if (!address)
-            continue;
-
-        const auto value = output.value();
-        const output_point point{ tx_hash, index };
-        history_->add_output(address.hash(), point, height, value);
+        const input_point point{ tx_hash, index };
+        spends_->store(inputs[index].previous_output(), point);
     }
 
-    //std::cout << "FER - void data_base::push_outputs(const hash_digest& tx_hash, size_t height, const output::list& outputs) - END\n";
-
+    for (const auto& address: decoded.inputs())
+    {
+        const input_point point{ tx_hash, address.first };
+        const auto& previous = inputs[address.first].previous_output();
+        history_->add_input(address.second, point, height, previous);
+    }
 }
 
-void data_base::push_stealth(const hash_digest& tx_hash, size_t height,
-    const output::list& outputs)
+void data_base::push_outputs(const decoded_transaction& decoded,
+    size_t height, const output::list& outputs)
 {
-    // std::cout << "void data_base::push_stealth(const hash_digest& tx_hash, size_t height, const output::list& outputs)\n";
-    if (outputs.empty())
-        return;
-
-    // Stealth outputs are paired by convention.
-    for (size_t index = 0; index < (outputs.size() - 1); ++index)
+    for (const auto& address: decoded.outputs())
     {
-        const auto& ephemeral_script = outputs[index].script();
-        const auto& payment_output = outputs[index + 1];
-
-        // Try to extract the payment address from the second output.
-        const auto address = payment_output.address();
-        if (!address)
-            continue;
-
-        // Try to extract an unsigned ephemeral key from the first output.
-        hash_digest unsigned_ephemeral_key;
-        if (!extract_ephemeral_key(unsigned_ephemeral_key, ephemeral_script))
-            continue;
-
-        // Try to extract a stealth prefix from the first output.
-        uint32_t prefix;
-        if (!to_stealth_prefix(prefix, ephemeral_script))
-            continue;
+        const auto value = outputs[address.first].value();
+        const output_point point{ decoded.hash(), address.first };
+        history_->add_output(address.second, point, height, value);
+    }
+}
 
-        // The payment address versions are arbitrary and unused here.
-        const stealth_compact row
-        {
-            unsigned_ephemeral_key,
-            address.hash(),
-            tx_hash
-        };
+void data_base::push_stealth(const decoded_transaction& decoded,
+    size_t height)
+{
+    for (const auto& stealth: decoded.stealth_rows())
+        stealth_->store(stealth.prefix, height, stealth.row);
+}
 
-        stealth_->store(prefix, height, row);
-    }
+// Take the previous outputs of the inputs, without their scripts.
+static output_point::list to_previous_outputs(const input::list& inputs)
+{
+    output_point::list points;
+    points.reserve(inputs.size());
 
-    // std::cout << "void data_base::push_stealth(const hash_digest& tx_hash, size_t height, const output::list& outputs) - END\n";
+    for (const auto& input: inputs)
+        points.push_back(input.previous_output());
 
+    return points;
 }
 
 // A false return implies store corruption.
-bool data_base::pop(block& out_block)
+// The transactions are popped from their stored form. Each is deserialized
+// only if the block is requested, and otherwise only its inputs and outputs
+// are read if indexed, and only its previous outputs if not. The stored form
+// is accessed for one transaction at a time.
+bool data_base::pop(block* out_block)
 {
+    const histogram::timer timer(pop_latency_);
     size_t height;
 
     // The blockchain is empty (nothing to pop, not even genesis).
@@ -597,34 +791,73 @@ bool data_base::pop(block& out_block)
         return false;
 
     const auto count = block.transaction_count();
-    transaction::list transactions;
-    transactions.reserve(count);
+    const auto indexed = height >= settings_.index_start_height;
+    transaction::list txs(out_block == nullptr ? 0 : count);
+
+    // The popped txs are pooled, so the pool must hold them before any pop.
+    if (!transactions_unconfirmed_->reserve(count))
+        return false;
 
-    for (size_t position = 0; position < count; ++position)
+    // Loop txs backwards, the reverse of how they were added.
+    // Remove txs, then outputs, then inputs (also reverse order).
+    for (auto position = count; position-- > 0;)
     {
         const auto tx_hash = block.transaction_hash(position);
-        const auto tx = transactions_->get(tx_hash, height, true);
+        const auto coinbase = position == 0;
+        output_point::list previous_outputs;
+        std::shared_ptr<decoded_transaction> decoded;
 
-        if (!tx || (tx.height() != height) || (tx.position() != position))
-            return false;
+        // The accessor is released before the indexes are updated.
+        {
+            const auto tx = transactions_->get(tx_hash, height, true);
 
-        // Deserialize transaction and move it to the block.
-        transactions.emplace_back(tx.transaction());
-    }
+            if (!tx || (tx.height() != height) || (tx.position() != position))
+                return false;
 
-    // Loop txs backwards, the reverse of how they were added.
-    // Remove txs, then outputs, then inputs (also reverse order).
-    for (auto tx = transactions.rbegin(); tx != transactions.rend(); ++tx)
-    {
-        if (!transactions_->unconfirm(tx->hash()))
-            return false;
+            // Addresses are only required for the indexes, and are decoded
+            // from the lists of the deserialized transaction if requested.
+            if (out_block != nullptr)
+            {
+                auto& popped = txs[position];
+                popped = tx.transaction();
+
+                if (!coinbase)
+                    previous_outputs = to_previous_outputs(popped.inputs());
+
+                if (indexed)
+                    decoded = std::make_shared<decoded_transaction>(tx_hash,
+                        popped.inputs(), popped.outputs(), coinbase);
+            }
+            else if (indexed)
+            {
+                const auto inputs = coinbase ? input::list{} : tx.inputs();
+                previous_outputs = to_previous_outputs(inputs);
+                decoded = std::make_shared<decoded_transaction>(tx_hash,
+                    inputs, tx.outputs(), coinbase);
+            }
+            else if (!coinbase)
+            {
+                previous_outputs = tx.previous_outputs();
+            }
+
+            if (!transactions_->unconfirm(tx_hash))
+                return false;
+
+            transactions_unconfirmed_->store(tx);
+        }
+
+        if (!indexed)
+        {
+            if (!pop_spends(previous_outputs))
+                return false;
 
-        transactions_unconfirmed_->store(*tx);
+            continue;
+        }
 
-        if (!pop_outputs(tx->outputs(), height))
+        if (!pop_outputs(*decoded, height))
             return false;
 
-        if (!tx->is_coinbase() && !pop_inputs(tx->inputs(), height))
+        if (!coinbase && !pop_inputs(*decoded, previous_outputs))
             return false;
     }
 
@@ -635,64 +868,79 @@ bool data_base::pop(block& out_block)
     synchronize();
 
     // Return the block.
-    out_block = chain::block(block.header(), std::move(transactions));
+    if (out_block != nullptr)
+        *out_block = chain::block(block.header(), std::move(txs));
+
     return true;
 }
 
 // A false return implies store corruption.
-bool data_base::pop_inputs(const input::list& inputs, size_t height)
+bool data_base::pop_spends(const output_point::list& previous_outputs)
 {
     // Loop in reverse.
-    for (auto input = inputs.rbegin(); input != inputs.rend(); ++input)
-    {
-        if (!transactions_->unspend(input->previous_output()))
+    for (auto point = previous_outputs.rbegin();
+        point != previous_outputs.rend(); ++point)
+        if (!transactions_->unspend(*point))
             return false;
 
-        if (height < settings_.index_start_height)
-            continue;
+    return true;
+}
+
+// A false return implies store corruption.
+bool data_base::pop_inputs(const decoded_transaction& decoded,
+    const output_point::list& previous_outputs)
+{
+    if (!pop_spends(previous_outputs))
+        return false;
 
+    // Loop in reverse.
+    for (auto point = previous_outputs.rbegin();
+        point != previous_outputs.rend(); ++point)
+    {
         // All spends are confirmed.
         // This can fail if index start has been changed between restarts.
         // So ignore the error here and succeeed even if not found.
-        /* bool */ spends_->unlink(input->previous_output());
+        /* bool */ spends_->unlink(*point);
+    }
 
-        // Try to extract an address.
-        const auto address = payment_address::extract(input->script());
+    const auto& addresses = decoded.inputs();
 
-        // All history entries are confirmed.
-        if (address)
-        {
-            // This can fail if index start has been changed between restarts.
-            // So ignore the error here and succeeed even if not found.
-            /* bool */ history_->delete_last_row(address.hash());
-        }
+    // All history entries are confirmed.
+    for (auto address = addresses.rbegin(); address != addresses.rend();
+        ++address)
+    {
+        // This can fail if index start has been changed between restarts.
+        // So ignore the error here and succeeed even if not found.
+        /* bool */ history_->delete_last_row(address->second);
     }
 
     return true;
 }
 
 // A false return implies store corruption.
-bool data_base::pop_outputs(const output::list& outputs, size_t height)
+bool data_base::pop_outputs(const decoded_transaction& decoded,
+    size_t height)
 {
-    if (height < settings_.index_start_height)
-        return true;
+    const auto& addresses = decoded.outputs();
 
-    // Loop in reverse.
-    for (auto output = outputs.rbegin(); output != outputs.rend(); ++output)
+    // All history entries are confirmed.
+    for (auto address = addresses.rbegin(); address != addresses.rend();
+        ++address)
     {
-        // Try to extract an address.
-        const auto address = payment_address::extract(output->script());
+        // This can fail if index start has been changed between restarts.
+        // So ignore the error here and succeeed even if not found.
+        /* bool */ history_->delete_last_row(address->second);
+    }
 
-        // All history entries are confirmed.
-        if (address)
-        {
-            // This can fail if index start has been changed between restarts.
-            // So ignore the error here and succeeed even if not found.
-            /* bool */ history_->delete_last_row(address.hash());
-        }
+    const auto& stealths = decoded.stealth_rows();
 
-        // All stealth entries are confirmed.
-        // Stealth unlink is not implemented as there is no way to correlate.
+    // All stealth entries are confirmed, and none is above the popped block.
+    for (auto stealth = stealths.rbegin(); stealth != stealths.rend();
+        ++stealth)
+    {
+        // This can fail if index start has been changed between restarts,
+        // or if another row of the block in the bucket was unlinked with it.
+        /* bool */ stealth_->unlink(stealth->prefix, height);
     }
 
     return true;
@@ -700,21 +948,67 @@ bool data_base::pop_outputs(const output::list& outputs, size_t height)
 
 // Asynchronous writers.
 // ----------------------------------------------------------------------------
+
+// Invoke the handler once after count calls, with the first error (if any).
+// Unlike bc::synchronize this does not terminate on error, so no stage of the
+// pipeline is still writing when the handler is invoked.
+static handle0 join(handle0 handler, size_t count)
+{
+    BITCOIN_ASSERT(count != 0);
+    const auto pending = std::make_shared<std::atomic<size_t>>(count);
+    const auto failure = std::make_shared<std::atomic<int>>(error::success);
+
+    return [handler, pending, failure](const code& ec)
+    {
+        auto expected = static_cast<int>(error::success);
+        if (ec)
+            failure->compare_exchange_strong(expected, ec.value());
+
+        if (--(*pending) == 0)
+            handler(static_cast<error::error_code_t>(failure->load()));
+    };
+}
+
+static size_t microseconds(const asio::time_point& start,
+    const asio::time_point& end)
+{
+    const auto elapsed = end - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        elapsed).count();
+}
+
 // Add a list of blocks in order.
 // If the dispatch threadpool is shut down when this is running the handler
 // will never be invoked, resulting in a threadpool.join indefinite hang.
+// Blocks are pushed in stages: transaction storage, then spend marking and
+// indexing (concurrently), then the header. The transactions of each block are
+// stored while the preceding block completes its remaining stages.
 void data_base::push_all(block_const_ptr_list_const_ptr in_blocks,
     size_t first_height, dispatcher& dispatch, result_handler handler)
 {
     DEBUG_ONLY(safe_add(in_blocks->size(), first_height));
 
+    if (in_blocks->empty())
+    {
+        handler(error::success);
+        return;
+    }
+
+    const auto phases = std::make_shared<push_phases>();
+
+    const result_handler stored =
+        std::bind(&data_base::push_next,
+            this, _1, in_blocks, 0, first_height, phases, std::ref(dispatch),
+                handler);
+
     // This is the beginning of the push_all sequence.
-    push_next(error::success, in_blocks, 0, first_height, dispatch, handler);
+    store_block(in_blocks, 0, first_height, phases, dispatch, stored);
 }
 
+// The transactions of the block at index have been stored.
 void data_base::push_next(const code& ec,
     block_const_ptr_list_const_ptr blocks, size_t index, size_t height,
-    dispatcher& dispatch, result_handler handler)
+    push_phases_ptr phases, dispatcher& dispatch, result_handler handler)
 {
     if (ec || index >= blocks->size())
     {
@@ -724,76 +1018,185 @@ void data_base::push_next(const code& ec,
     }
 
     const auto block = (*blocks)[index];
+    const auto next_index = index + 1;
+    const auto next_phases = std::make_shared<push_phases>();
 
-    // Set push start time for the block.
-    block->validation.start_push = asio::steady_clock::now();
+    // No transactions are being stored, so this is the end of the block's.
+    phases->transactions_end = transactions_->end();
 
     const result_handler next =
         std::bind(&data_base::push_next,
-            this, _1, blocks, index + 1, height + 1, std::ref(dispatch),
-                handler);
+            this, _1, blocks, next_index, height + 1, next_phases,
+                std::ref(dispatch), handler);
 
-    // This is the beginning of the block sub-sequence.
-    dispatch.concurrent(&data_base::do_push,
-        this, block, height, std::ref(dispatch), next);
+    if (next_index == blocks->size())
+    {
+        complete_block(block, height, phases, dispatch, next);
+        return;
+    }
+
+    // The next block proceeds once its transactions are stored and this
+    // block is complete, as its inputs may spend outputs of this block.
+    const auto joined = join(next, 2);
+    dispatch.concurrent(&data_base::store_block,
+        this, blocks, next_index, height + 1, next_phases, std::ref(dispatch),
+            joined);
+
+    complete_block(block, height, phases, dispatch, joined);
 }
 
-void data_base::do_push(block_const_ptr block, size_t height,
-    dispatcher& dispatch, result_handler handler)
+void data_base::store_block(block_const_ptr_list_const_ptr blocks,
+    size_t index, size_t height, push_phases_ptr phases, dispatcher& dispatch,
+    result_handler handler)
 {
-    result_handler block_complete =
-        std::bind(&data_base::handle_push_transactions,
-            this, _1, block, height, handler);
+    const auto block = (*blocks)[index];
+
+    // Set push start time for the block.
+    block->validation.start_push = asio::steady_clock::now();
 
     // This ensures linkage and that the there is at least one tx.
-    const auto ec = verify_push(*block, height);
+    const auto ec = index == 0 ? verify_push(*block, height) :
+        verify_push(*block, *(*blocks)[index - 1]);
 
     if (ec)
     {
-        block_complete(ec);
+        handler(ec);
         return;
     }
 
+    // The table must hold the txs before any is written.
+    if (!transactions_->reserve(block->transactions().size()))
+    {
+        handler(error::operation_failed);
+        return;
+    }
+
+    const auto stored = [phases, handler](const code& ec)
+    {
+        phases->stored = asio::steady_clock::now();
+        handler(ec);
+    };
+
     const auto threads = dispatch.size();
     const auto buckets = std::min(threads, block->transactions().size());
-    const auto join_handler = bc::synchronize(std::move(block_complete),
-        buckets, NAME "_do_push");
+    const auto joined = join(stored, buckets);
 
     for (size_t bucket = 0; bucket < buckets; ++bucket)
-        dispatch.concurrent(&data_base::do_push_transactions,
-            this, block, height, bucket, buckets, join_handler);
+        dispatch.concurrent(&data_base::do_store_transactions,
+            this, block, height, bucket, buckets, joined);
 }
 
-void data_base::do_push_transactions(block_const_ptr block, size_t height,
+void data_base::do_store_transactions(block_const_ptr block, size_t height,
     size_t bucket, size_t buckets, result_handler handler)
 {
-    const auto result = push_transactions(*block, height, bucket, buckets);
+    const auto result = store_transactions(*block, height, bucket, buckets);
     handler(result ? error::success : error::operation_failed);
 }
 
-void data_base::handle_push_transactions(const code& ec, block_const_ptr block,
-    size_t height, result_handler handler)
+// Spend marking and indexing are independent, the header is stored last.
+void data_base::complete_block(block_const_ptr block, size_t height,
+    push_phases_ptr phases, dispatcher& dispatch, result_handler handler)
 {
-    if (ec)
+    phases->completing = asio::steady_clock::now();
+
+    const result_handler block_complete =
+        std::bind(&data_base::handle_complete_block,
+            this, _1, block, height, phases, handler);
+
+    const auto joined = join(block_complete, 2);
+
+    const auto spent = [phases, joined](const code& ec)
     {
-        handler(ec);
+        phases->spent = asio::steady_clock::now();
+        joined(ec);
+    };
+
+    const auto indexed = [phases, joined](const code& ec)
+    {
+        phases->indexed = asio::steady_clock::now();
+        joined(ec);
+    };
+
+    const auto threads = dispatch.size();
+    const auto spend_buckets = std::min(threads, block->transactions().size());
+    const auto spends_joined = join(spent, spend_buckets);
+
+    const auto spends = partition_spends(*block, spend_buckets);
+
+    // Make the stored transactions visible to spend marking. The next block
+    // may be storing its transactions, which are not committed with these.
+    transactions_->synchronize(phases->transactions_end);
+
+    for (size_t bucket = 0; bucket < spend_buckets; ++bucket)
+        dispatch.concurrent(&data_base::do_push_spends,
+            this, spends, bucket, height, spends_joined);
+
+    if (height < settings_.index_start_height)
+    {
+        indexed(error::success);
         return;
     }
 
-    if (!push_heights(*block, height))
+    const auto index_buckets = std::min(threads, block->transactions().size());
+    const auto index_joined = join(indexed, index_buckets);
+
+    for (size_t bucket = 0; bucket < index_buckets; ++bucket)
+        dispatch.concurrent(&data_base::do_index_transactions,
+            this, block, height, bucket, index_buckets, index_joined);
+}
+
+void data_base::do_index_transactions(block_const_ptr block, size_t height,
+    size_t bucket, size_t buckets, result_handler handler)
+{
+    const auto result = index_transactions(*block, height, bucket, buckets);
+    handler(result ? error::success : error::operation_failed);
+}
+
+void data_base::do_push_spends(spends_ptr spends, size_t bucket,
+    size_t height, result_handler handler)
+{
+    const auto result = push_spends((*spends)[bucket], height);
+    handler(result ? error::success : error::operation_failed);
+}
+
+void data_base::handle_complete_block(const code& ec, block_const_ptr block,
+    size_t height, push_phases_ptr phases, result_handler handler)
+{
+    if (ec)
     {
-        handler(error::operation_failed);
+        handler(ec);
         return;
     }
 
     // Push the block header and synchronize to complete the block.
     blocks_->store(*block, height);
 
-    // Synchronize tx updates, indexes and block.
-    synchronize();
+    // Synchronize tx updates, indexes and block (not the next block's txs).
+    synchronize(phases->transactions_end);
 
     // Set push end time for the block.
-    block->validation.end_push = asio::steady_clock::now();
+    const auto end = asio::steady_clock::now();
+    block->validation.end_push = end;
+
+    const auto start = block->validation.start_push;
+    push_latency_.record(microseconds(start, end));
+    push_transactions_latency_.record(microseconds(start, phases->stored) +
+        microseconds(phases->completing, phases->indexed));
+    push_heights_latency_.record(microseconds(phases->completing,
+        phases->spent));
+
+    LOG_DEBUG(LOG_DATABASE)
+        << "Pushed block [" << height << "] store ("
+        << microseconds(block->validation.start_push, phases->stored)
+        << " us) wait ("
+        << microseconds(phases->stored, phases->completing)
+        << " us) spend ("
+        << microseconds(phases->completing, phases->spent)
+        << " us) index ("
+        << microseconds(phases->completing, phases->indexed)
+        << " us) header ("
+        << microseconds(std::max(phases->spent, phases->indexed), end)
+        << " us)";
 
     // This is the end of the block sub-sequence.
     handler(error::success);
@@ -809,7 +1212,9 @@ void data_base::pop_above(block_const_ptr_list_ptr out_blocks,
     // static const auto not_spent = output::validation::not_spent;
 
     size_t top;
-    out_blocks->clear();
+
+    if (out_blocks)
+        out_blocks->clear();
 
     const auto result = blocks_->get(fork_hash);
 
@@ -831,17 +1236,34 @@ void data_base::pop_above(block_const_ptr_list_ptr out_blocks,
     }
 
     // If the fork is at the top there is one block to pop, and so on.
-    out_blocks->reserve(size);
+    if (out_blocks)
+        out_blocks->resize(size);
 
     // Enqueue blocks so .front() is fork + 1 and .back() is top.
     for (size_t height = top; height > fork; --height)
     {
-        message::block next;
         const auto start_time = asio::steady_clock::now();
 
         // TODO: parallelize pop of transactions within each block.
-        if (!pop(next))
+        if (!out_blocks)
         {
+            if (!pop(nullptr))
+            {
+                handler(error::operation_failed);
+                return;
+            }
+
+            continue;
+        }
+
+        message::block next;
+
+        if (!pop(&next))
+        {
+            // Drop the slots of the blocks that were not popped.
+            const auto unpopped = height - fork;
+            out_blocks->erase(out_blocks->begin(),
+                out_blocks->begin() + unpopped);
             handler(error::operation_failed);
             return;
         }
@@ -853,9 +1275,7 @@ void data_base::pop_above(block_const_ptr_list_ptr out_blocks,
         block->header().validation.height = height;
         block->validation.error = error::success;
         block->validation.start_pop = start_time;
-
-        // TODO: optimize.
-        out_blocks->insert(out_blocks->begin(), block);
+        (*out_blocks)[height - fork - 1] = block;
     }
 
     handler(error::success);
@@ -869,9 +1289,12 @@ void data_base::reorganize(const checkpoint& fork_point,
 {
     const auto next_height = safe_add(fork_point.height(), size_t(1));
 
+    // This includes the wait for the write lock.
+    const auto start = asio::steady_clock::now();
+
     const result_handler pop_handler =
         std::bind(&data_base::handle_pop,
-            this, _1, incoming_blocks, next_height, std::ref(dispatch),
+            this, _1, incoming_blocks, next_height, start, std::ref(dispatch),
                 handler);
 
     // Critical Section.
@@ -891,11 +1314,12 @@ void data_base::reorganize(const checkpoint& fork_point,
 
 void data_base::handle_pop(const code& ec,
     block_const_ptr_list_const_ptr incoming_blocks,
-    size_t first_height, dispatcher& dispatch, result_handler handler)
+    size_t first_height, const asio::time_point& start,
+    dispatcher& dispatch, result_handler handler)
 {
     const result_handler push_handler =
         std::bind(&data_base::handle_push,
-            this, _1, handler);
+            this, _1, start, handler);
 
     if (ec)
     {
@@ -908,7 +1332,8 @@ void data_base::handle_pop(const code& ec,
 
 // We never invoke the caller's handler under the mutex, we never fail to clear
 // the mutex, and we always invoke the caller's handler exactly once.
-void data_base::handle_push(const code& ec, result_handler handler) const
+void data_base::handle_push(const code& ec, const asio::time_point& start,
+    result_handler handler) const
 {
     write_mutex_.unlock();
     // End Critical Section.
@@ -916,11 +1341,14 @@ void data_base::handle_push(const code& ec, result_handler handler) const
 
     if (ec)
     {
+        reorganize_latency_.record(start);
         handler(ec);
         return;
     }
 
-    handler(end_write() ? error::success : error::operation_failed);
+    const auto written = end_write();
+    reorganize_latency_.record(start);
+    handler(written ? error::success : error::operation_failed);
     // End Sequential Lock and Flush Lock
     //^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 }
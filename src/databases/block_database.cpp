@@ -48,16 +48,17 @@ static constexpr auto index_record_size = sizeof(file_offset);
 // Blocks uses a hash table and an array index, both O(1).
 block_database::block_database(const path& map_filename,
     const path& index_filename, size_t buckets, size_t expansion,
-    mutex_ptr mutex)
+    mutex_ptr mutex, const mapping_policy& lookup_mapping,
+    const mapping_policy& index_mapping)
   : initial_map_file_size_(slab_hash_table_header_size(buckets) +
         minimum_slabs_size),
 
-    lookup_file_(map_filename, mutex, expansion),
+    lookup_file_(map_filename, mutex, expansion, lookup_mapping),
     lookup_header_(lookup_file_, buckets),
     lookup_manager_(lookup_file_, slab_hash_table_header_size(buckets)),
     lookup_map_(lookup_header_, lookup_manager_),
 
-    index_file_(index_filename, mutex, expansion),
+    index_file_(index_filename, mutex, expansion, index_mapping),
     index_manager_(index_file_, index_header_size, index_record_size)
 {
 }
@@ -131,6 +132,12 @@ bool block_database::flush() const
         index_file_.flush();
 }
 
+void block_database::attach(journal& journal)
+{
+    journal.attach(lookup_file_);
+    journal.attach(index_file_);
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
@@ -253,6 +260,7 @@ void block_database::write_position(file_offset position, array_index height)
     const auto memory = index_manager_.get(height);
     auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory));
     serial.write_8_bytes_little_endian(position);
+    index_manager_.dirty(REMAP_ADDRESS(memory), sizeof(file_offset));
 
     mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
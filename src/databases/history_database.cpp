@@ -22,8 +22,7 @@
 #include <cstddef>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
-#include <bitcoin/database/primitives/record_multimap_iterable.hpp>
-#include <bitcoin/database/primitives/record_multimap_iterator.hpp>
+#include <bitcoin/database/primitives/record_list.hpp>
 
 namespace libbitcoin {
 namespace database {
@@ -40,28 +39,53 @@ static constexpr auto checksum_size = sizeof(uint64_t);
 static constexpr auto value_size = flag_size + point_size + height_size +
     checksum_size;
 
+static BC_CONSTEXPR size_t rows_per_chunk = 16;
+
+static constexpr auto received_size = sizeof(uint64_t);
+static constexpr auto rows_size = sizeof(uint32_t);
+static constexpr auto unordered_size = sizeof(uint32_t);
+static constexpr auto unordered_position = received_size + rows_size +
+    height_size;
+static constexpr auto summary_size = unordered_position + unordered_size;
+
 static BC_CONSTEXPR auto record_size =
-    hash_table_multimap_record_size<short_hash>();
-static BC_CONSTEXPR auto row_record_size =
-    hash_table_record_size<hash_digest>(value_size);
+    hash_table_chunk_multimap_record_size<short_hash>(summary_size);
+static BC_CONSTEXPR auto chunk_size =
+    chunk_record_size(value_size, rows_per_chunk);
+
+const size_t history_database::chunk_rows = rows_per_chunk;
+
+// Cursor.
+// ----------------------------------------------------------------------------
+
+history_cursor::history_cursor()
+  : started(false), ordered(true), chunk(record_list::empty), position(0)
+{
+}
+
+bool history_cursor::exhausted() const
+{
+    return started && chunk == record_list::empty;
+}
 
 // History uses a hash table index, O(1).
 history_database::history_database(const path& lookup_filename,
     const path& rows_filename, size_t buckets, size_t expansion,
-    mutex_ptr mutex)
+    mutex_ptr mutex, const mapping_policy& lookup_mapping,
+    const mapping_policy& rows_mapping)
   : initial_map_file_size_(record_hash_table_header_size(buckets) +
         minimum_records_size),
 
-    lookup_file_(lookup_filename, mutex, expansion),
+    lookup_file_(lookup_filename, mutex, expansion, lookup_mapping),
     lookup_header_(lookup_file_, buckets),
     lookup_manager_(lookup_file_, record_hash_table_header_size(buckets),
         record_size),
     lookup_map_(lookup_header_, lookup_manager_),
 
-    rows_file_(rows_filename, mutex, expansion),
-    rows_manager_(rows_file_, rows_header_size, row_record_size),
-    rows_list_(rows_manager_),
-    rows_multimap_(lookup_map_, rows_list_)
+    rows_file_(rows_filename, mutex, expansion, rows_mapping),
+    rows_manager_(rows_file_, rows_header_size, chunk_size),
+    rows_multimap_(lookup_map_, rows_manager_, value_size, rows_per_chunk,
+        summary_size)
 {
 }
 
@@ -132,6 +156,82 @@ bool history_database::flush() const
         rows_file_.flush();
 }
 
+void history_database::attach(journal& journal)
+{
+    journal.attach(lookup_file_);
+    journal.attach(rows_file_);
+}
+
+// Summary.
+// ----------------------------------------------------------------------------
+// The summary is [ received:8 ][ rows:4 ][ height:4 ][ unordered:4 ].
+// Unordered counts the rows added below the newest row of the key, as by an
+// insert into a gap. The paginated read stops early only if it is zero.
+
+static void write_summary(uint8_t* summary, uint64_t received, uint32_t rows,
+    uint32_t height, uint32_t unordered)
+{
+    auto serial = make_unsafe_serializer(summary);
+    serial.write_8_bytes_little_endian(received);
+    serial.write_4_bytes_little_endian(rows);
+    serial.write_4_bytes_little_endian(height);
+    serial.write_4_bytes_little_endian(unordered);
+}
+
+static void add_summary(uint8_t* summary, uint64_t value, uint32_t height)
+{
+    const auto received = from_little_endian_unsafe<uint64_t>(summary);
+    const auto rows = from_little_endian_unsafe<uint32_t>(summary +
+        received_size);
+    const auto newest = from_little_endian_unsafe<uint32_t>(summary +
+        received_size + rows_size);
+    const auto unordered = from_little_endian_unsafe<uint32_t>(summary +
+        unordered_position);
+    const auto below = rows != 0 && height < newest;
+
+    write_summary(summary, received + value, rows + 1, height,
+        below ? unordered + 1 : unordered);
+}
+
+// The value of a deleted output is deducted, a spend carries no value. The
+// remaining newest row was the newest when the deleted row was added.
+static void revert_summary(uint8_t* summary, const uint8_t* deleted,
+    const uint8_t* newest)
+{
+    const auto kind = static_cast<point_kind>(deleted[0]);
+    const auto value = kind != point_kind::output ? 0 :
+        from_little_endian_unsafe<uint64_t>(deleted + height_position +
+            height_size);
+    const auto received = from_little_endian_unsafe<uint64_t>(summary);
+    const auto rows = from_little_endian_unsafe<uint32_t>(summary +
+        received_size);
+    const auto height = from_little_endian_unsafe<uint32_t>(newest +
+        height_position);
+    const auto unordered = from_little_endian_unsafe<uint32_t>(summary +
+        unordered_position);
+    const auto below = from_little_endian_unsafe<uint32_t>(deleted +
+        height_position) < height;
+
+    BITCOIN_ASSERT(rows != 0 && received >= value);
+    BITCOIN_ASSERT(!below || unordered != 0);
+    write_summary(summary, received - value, rows - 1, height,
+        below ? unordered - 1 : unordered);
+}
+
+history_summary history_database::summary(const short_hash& key) const
+{
+    const auto summary = rows_multimap_.summary(key);
+
+    if (summary.empty())
+        return{ 0, 0, 0 };
+
+    auto deserial = make_safe_deserializer(summary.begin(), summary.end());
+    const auto received = deserial.read_8_bytes_little_endian();
+    const auto rows = deserial.read_4_bytes_little_endian();
+    const auto height = deserial.read_4_bytes_little_endian();
+    return{ received, rows, height };
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
@@ -148,7 +248,12 @@ void history_database::add_output(const short_hash& key,
         serial.write_8_bytes_little_endian(value);
     };
 
-    rows_multimap_.add_row(key, write);
+    const auto update = [&](uint8_t* summary)
+    {
+        add_summary(summary, value, output_height32);
+    };
+
+    rows_multimap_.add_row(key, write, update);
 }
 
 void history_database::add_input(const short_hash& key,
@@ -165,17 +270,33 @@ void history_database::add_input(const short_hash& key,
         serial.write_8_bytes_little_endian(previous.checksum());
     };
 
-    rows_multimap_.add_row(key, write);
+    const auto update = [&](uint8_t* summary)
+    {
+        add_summary(summary, 0, input_height32);
+    };
+
+    rows_multimap_.add_row(key, write, update);
 }
 
 // This is the history unlink.
 bool history_database::delete_last_row(const short_hash& key)
 {
-    return rows_multimap_.delete_last_row(key);
+    return rows_multimap_.delete_last_row(key, revert_summary);
 }
 
 history_compact::list history_database::get(const short_hash& key,
     size_t limit, size_t from_height) const
+{
+    history_cursor cursor;
+    return get(key, limit, from_height, max_size_t, cursor);
+}
+
+// The read ends at the first row below from_height, so that the cost of an
+// incremental read is its page, not the history of the key. If rows of the
+// key were added out of height order the rows below are skipped instead.
+history_compact::list history_database::get(const short_hash& key,
+    size_t limit, size_t from_height, size_t to_height,
+    history_cursor& cursor) const
 {
     // Read the height value from the row.
     const auto read_height = [](uint8_t* data)
@@ -204,22 +325,60 @@ history_compact::list history_database::get(const short_hash& key,
         };
     };
 
+    if (!cursor.started)
+    {
+        const auto summary = rows_multimap_.summary(key);
+        cursor.ordered = summary.empty() || from_little_endian_unsafe<uint32_t>(
+            summary.data() + unordered_position) == 0;
+        cursor.chunk = rows_multimap_.lookup(key);
+        cursor.started = true;
+
+        if (cursor.chunk != record_list::empty)
+            cursor.position = rows_multimap_.count(cursor.chunk);
+    }
+
     history_compact::list result;
-    const auto start = rows_multimap_.lookup(key);
-    const auto records = record_multimap_iterable(rows_list_, start);
 
-    for (const auto index: records)
+    while (cursor.chunk != record_list::empty)
     {
+        // Move to the next older chunk once this chunk has been read.
+        if (cursor.position == 0)
+        {
+            cursor.chunk = rows_multimap_.next(cursor.chunk);
+
+            if (cursor.chunk != record_list::empty)
+                cursor.position = rows_multimap_.count(cursor.chunk);
+
+            continue;
+        }
+
         // Stop once we reach the limit (if specified).
         if (limit > 0 && result.size() >= limit)
             break;
 
         // This obtains a remap safe address pointer against the rows file.
-        const auto record = rows_list_.get(index);
+        const auto record = rows_multimap_.get(cursor.chunk,
+            cursor.position - 1);
         const auto address = REMAP_ADDRESS(record);
+        const auto height = read_height(address);
+
+        if (height < from_height)
+        {
+            // All following rows are below from_height.
+            if (cursor.ordered)
+            {
+                cursor.chunk = record_list::empty;
+                break;
+            }
+
+            --cursor.position;
+            continue;
+        }
+
+        --cursor.position;
 
-        // Skip rows below from_height.
-        if (from_height == 0 || read_height(address) >= from_height)
+        // Skip rows above to_height.
+        if (height <= to_height)
             result.push_back(read_row(address));
     }
 
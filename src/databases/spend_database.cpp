@@ -34,15 +34,16 @@ static BC_CONSTEXPR auto record_size = hash_table_record_size<point>(value_size)
 
 // Spends use a hash table index, O(1).
 spend_database::spend_database(const path& filename, size_t buckets,
-    size_t expansion, mutex_ptr mutex)
+    size_t expansion, mutex_ptr mutex, size_t max_load,
+    const mapping_policy& mapping)
   : initial_map_file_size_(record_hash_table_header_size(buckets) +
         minimum_records_size),
 
-    lookup_file_(filename, mutex, expansion),
+    lookup_file_(filename, mutex, expansion, mapping),
     lookup_header_(lookup_file_, buckets),
     lookup_manager_(lookup_file_, record_hash_table_header_size(buckets),
         record_size),
-    lookup_map_(lookup_header_, lookup_manager_)
+    lookup_map_(lookup_header_, lookup_manager_, max_load)
 {
 }
 
@@ -71,7 +72,8 @@ bool spend_database::create()
     // Should not call start after create, already started.
     return
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        lookup_map_.start();
 }
 
 // Startup and shutdown.
@@ -82,7 +84,8 @@ bool spend_database::open()
     return
         lookup_file_.open() &&
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        lookup_map_.start();
 }
 
 bool spend_database::close()
@@ -94,6 +97,14 @@ bool spend_database::close()
 void spend_database::synchronize()
 {
     lookup_manager_.sync();
+
+    if (lookup_map_.resizing())
+    {
+        LOG_DEBUG(LOG_DATABASE)
+            << "Spend table resize: " << lookup_map_.migrated() << " of "
+            << lookup_map_.buckets() << " buckets migrated, load: "
+            << lookup_map_.load() << "%";
+    }
 }
 
 // Flush the memory map to disk.
@@ -102,6 +113,11 @@ bool spend_database::flush() const
     return lookup_file_.flush();
 }
 
+void spend_database::attach(journal& journal)
+{
+    journal.attach(lookup_file_);
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
@@ -151,7 +167,7 @@ spend_statinfo spend_database::statinfo() const
 {
     return
     {
-        lookup_header_.size(),
+        lookup_map_.buckets(),
         lookup_manager_.count()
     };
 }
@@ -18,18 +18,30 @@
  */
 #include <bitcoin/database/databases/stealth_database.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/database/memory/memory.hpp>
+#include <bitcoin/database/primitives/record_chunk_multimap.hpp>
+
+// The AVX2 path is selected at runtime, so it builds without -mavx2.
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+    #define STEALTH_AVX2
+    #include <immintrin.h>
+#endif
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 
 namespace libbitcoin {
 namespace database {
 
 using namespace bc::chain;
 
-static constexpr auto rows_header_size = 0u;
-
 static constexpr auto height_size = sizeof(uint32_t);
 static constexpr auto prefix_size = sizeof(uint32_t);
 
@@ -38,11 +50,43 @@ static constexpr auto prefix_size = sizeof(uint32_t);
 static constexpr auto row_size = prefix_size + height_size + hash_size +
     short_hash_size + hash_size;
 
-// Stealth uses an unindexed array, requiring linear search, (O(n)).
+// The count and ceiling precede the rows of a chunk, following the list link.
+// The ceiling is the greatest height of the rows of the chunk and of the older
+// chunks of its bucket.
+// [ count:4 ][ ceiling:4 ][ row ] * chunk_rows
+static constexpr auto count_size = sizeof(uint32_t);
+static constexpr auto ceiling_size = sizeof(uint32_t);
+static constexpr auto rows_offset = count_size + ceiling_size;
+static constexpr size_t bits_per_byte = 8;
+
+const size_t stealth_database::bucket_bits = bits_per_byte;
+const size_t stealth_database::chunk_rows = 64;
+
+static const auto buckets = array_index(1) << stealth_database::bucket_bits;
+static const auto rows_header_size = record_hash_table_header_size(buckets);
+static const auto chunk_size = chunk_record_size(row_size,
+    stealth_database::chunk_rows) + ceiling_size;
+
+static uint32_t row_height(const uint8_t* rows, size_t position)
+{
+    return from_little_endian_unsafe<uint32_t>(rows + position * row_size +
+        prefix_size);
+}
+
+// The bucket is the leading byte of the prefix, which is the first byte of
+// its little endian serialization (the first filter byte).
+static array_index bucket_of(uint32_t prefix)
+{
+    return prefix & (buckets - 1);
+}
+
+// Stealth uses an array of buckets, requiring linear search of a bucket.
 stealth_database::stealth_database(const path& rows_filename, size_t expansion,
-    mutex_ptr mutex)
-  : rows_file_(rows_filename, mutex, expansion),
-    rows_manager_(rows_file_, rows_header_size, row_size)
+    mutex_ptr mutex, const mapping_policy& mapping)
+  : rows_file_(rows_filename, mutex, expansion, mapping),
+    header_(rows_file_, buckets),
+    rows_manager_(rows_file_, rows_header_size, chunk_size),
+    rows_(rows_manager_)
 {
 }
 
@@ -62,13 +106,16 @@ bool stealth_database::create()
         return false;
 
     // This will throw if insufficient disk space.
-    rows_file_.resize(minimum_records_size);
+    rows_file_.resize(rows_header_size + minimum_records_size);
 
-    if (!rows_manager_.create())
+    if (!header_.create() ||
+        !rows_manager_.create())
         return false;
 
     // Should not call start after create, already started.
-    return rows_manager_.start();
+    return
+        header_.start() &&
+        rows_manager_.start();
 }
 
 // Startup and shutdown.
@@ -78,6 +125,7 @@ bool stealth_database::open()
 {
     return
         rows_file_.open() &&
+        header_.start() &&
         rows_manager_.start();
 }
 
@@ -98,75 +146,414 @@ bool stealth_database::flush() const
     return rows_file_.flush();
 }
 
+void stealth_database::attach(journal& journal)
+{
+    journal.attach(rows_file_);
+}
+
+// Filter.
+// ----------------------------------------------------------------------------
+
+// Reduce the filter to a mask and value over the little endian prefix word,
+// such that filter.is_prefix_of(prefix) == ((prefix & mask) == value).
+// Filter bits beyond the prefix can only match zero bits, so if any is set
+// the filter matches no prefix.
+static bool to_prefix_filter(uint32_t& mask, uint32_t& value,
+    const binary& filter)
+{
+    mask = 0;
+    value = 0;
+    const auto& blocks = filter.blocks();
+
+    for (size_t byte = 0; byte < blocks.size(); ++byte)
+    {
+        const auto bits = std::min(filter.size() - byte * bits_per_byte,
+            size_t(bits_per_byte));
+        const auto byte_mask = uint8_t(0xff << (bits_per_byte - bits));
+
+        if (byte >= prefix_size)
+        {
+            if ((blocks[byte] & byte_mask) != 0)
+                return false;
+
+            continue;
+        }
+
+        const auto shift = byte * bits_per_byte;
+        mask |= uint32_t(byte_mask) << shift;
+        value |= uint32_t(blocks[byte] & byte_mask) << shift;
+    }
+
+    return true;
+}
+
+#ifdef STEALTH_AVX2
+// Eight rows at a time from the given row, gathered at the row stride.
+// Compiled for AVX2 regardless of the build flags and used only when the
+// processor supports it.
+__attribute__((target("avx2")))
+static size_t match_rows_avx2(uint64_t& matches, const uint8_t* rows,
+    size_t row, size_t count, uint32_t mask, uint32_t value,
+    uint32_t from_height)
+{
+    static const auto stride = static_cast<int>(row_size);
+    const auto offsets = _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride,
+        4 * stride, 5 * stride, 6 * stride, 7 * stride);
+    const auto bias = _mm256_set1_epi32(INT32_MIN);
+    const auto masks = _mm256_set1_epi32(static_cast<int>(mask));
+    const auto values = _mm256_set1_epi32(static_cast<int>(value));
+    const auto minimum = _mm256_xor_si256(bias,
+        _mm256_set1_epi32(static_cast<int>(from_height)));
+
+    for (; row + 8 <= count; row += 8)
+    {
+        const auto record = reinterpret_cast<const int*>(rows +
+            row * row_size);
+        const auto prefixes = _mm256_i32gather_epi32(record, offsets, 1);
+        const auto heights = _mm256_i32gather_epi32(record + 1, offsets, 1);
+
+        // Unsigned comparison by signed comparison of biased words.
+        const auto low = _mm256_cmpgt_epi32(minimum,
+            _mm256_xor_si256(heights, bias));
+        const auto match = _mm256_andnot_si256(low, _mm256_cmpeq_epi32(
+            _mm256_and_si256(prefixes, masks), values));
+
+        matches |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(match))) <<
+            row;
+    }
+
+    return row;
+}
+
+static bool has_avx2()
+{
+    static const auto supported = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+
+    return supported;
+}
+
+#endif
+
+#ifdef __SSE2__
+static uint32_t load_word(const uint8_t* address)
+{
+    uint32_t word;
+    std::memcpy(&word, address, sizeof(word));
+    return word;
+}
+
+// Four rows at a time from the given row, loaded at the row stride.
+static size_t match_rows_sse2(uint64_t& matches, const uint8_t* rows,
+    size_t row, size_t count, uint32_t mask, uint32_t value,
+    uint32_t from_height)
+{
+    const auto bias = _mm_set1_epi32(INT32_MIN);
+    const auto masks = _mm_set1_epi32(static_cast<int>(mask));
+    const auto values = _mm_set1_epi32(static_cast<int>(value));
+    const auto minimum = _mm_xor_si128(bias,
+        _mm_set1_epi32(static_cast<int>(from_height)));
+
+    for (; row + 4 <= count; row += 4)
+    {
+        const auto record = rows + row * row_size;
+        const auto prefixes = _mm_setr_epi32(
+            static_cast<int>(load_word(record)),
+            static_cast<int>(load_word(record + row_size)),
+            static_cast<int>(load_word(record + 2 * row_size)),
+            static_cast<int>(load_word(record + 3 * row_size)));
+        const auto heights = _mm_setr_epi32(
+            static_cast<int>(load_word(record + prefix_size)),
+            static_cast<int>(load_word(record + prefix_size + row_size)),
+            static_cast<int>(load_word(record + prefix_size + 2 * row_size)),
+            static_cast<int>(load_word(record + prefix_size + 3 * row_size)));
+
+        // Unsigned comparison by signed comparison of biased words.
+        const auto low = _mm_cmplt_epi32(_mm_xor_si128(heights, bias),
+            minimum);
+        const auto match = _mm_andnot_si128(low, _mm_cmpeq_epi32(
+            _mm_and_si128(prefixes, masks), values));
+
+        matches |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(match))) << row;
+    }
+
+    return row;
+}
+
+#endif
+
+// Set a bit for each of the rows whose prefix matches at or above the height.
+// The x86 vector paths read the little endian words natively, each leaving
+// its remainder to the next.
+static uint64_t match_rows(const uint8_t* rows, size_t count, uint32_t mask,
+    uint32_t value, uint32_t from_height)
+{
+    BITCOIN_ASSERT(count <= sizeof(uint64_t) * bits_per_byte);
+    uint64_t matches = 0;
+    size_t row = 0;
+
+#ifdef STEALTH_AVX2
+    if (has_avx2())
+        row = match_rows_avx2(matches, rows, row, count, mask, value,
+            from_height);
+#endif
+#ifdef __SSE2__
+    row = match_rows_sse2(matches, rows, row, count, mask, value,
+        from_height);
+#endif
+
+    for (; row < count; ++row)
+    {
+        const auto record = rows + row * row_size;
+        const auto prefix = from_little_endian_unsafe<uint32_t>(record);
+        const auto height = from_little_endian_unsafe<uint32_t>(record +
+            prefix_size);
+
+        if (height >= from_height && (prefix & mask) == value)
+            matches |= uint64_t(1) << row;
+    }
+
+    return matches;
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
-// TODO: add serialization to stealth_compact.
 // The prefix is fixed at 32 bits, but the filter is 0-32 bits, so the records
-// cannot be indexed using a hash table. We also do not index by height.
+// cannot be indexed using a hash table. A filter of fewer than bucket_bits
+// matches a contiguous range of buckets, otherwise a single bucket.
 stealth_compact::list stealth_database::scan(const binary& filter,
     size_t from_height) const
 {
     stealth_compact::list result;
+    uint32_t mask;
+    uint32_t value;
 
-    for (array_index row = 0; row < rows_manager_.count(); ++row)
-    {
-        const auto memory = rows_manager_.get(row);
-        auto record = REMAP_ADDRESS(memory);
-        const auto field = from_little_endian_unsafe<uint32_t>(record);
+    // No height is above the 32 bit range of the row.
+    if (from_height > max_uint32 || !to_prefix_filter(mask, value, filter))
+        return result;
 
-        // Skip if prefix doesn't match.
-        if (!filter.is_prefix_of(field))
-            continue;
+    const auto& blocks = filter.blocks();
+    const auto leading = blocks.empty() ? uint8_t(0) : blocks.front();
+    const auto free_bits = bucket_bits - std::min(filter.size(), bucket_bits);
+    const auto first = array_index(leading >> free_bits) << free_bits;
+    const auto last = first + (array_index(1) << free_bits);
 
-        record += prefix_size;
-        const auto height = from_little_endian_unsafe<uint32_t>(record);
+    for (auto bucket = first; bucket < last; ++bucket)
+        scan_bucket(result, bucket, mask, value,
+            static_cast<uint32_t>(from_height));
 
-        // Skip if height is too low.
-        if (height < from_height)
-            continue;
+    return result;
+}
+
+// TODO: add serialization to stealth_compact.
+// Insert may add rows to a bucket out of height order, so each chunk is
+// matched in full and the scan ends at the first chunk whose ceiling is below
+// from_height. Only matching rows are deserialized.
+void stealth_database::scan_bucket(list& result, array_index bucket,
+    uint32_t mask, uint32_t value, uint32_t from_height) const
+{
+    for (auto chunk = header_.read(bucket); chunk != record_list::empty;
+        chunk = rows_.next(chunk))
+    {
+        size_t rows_count;
+        uint32_t ceiling;
+        read_chunk(chunk, rows_count, ceiling);
+
+        // No row of this or an older chunk is at or above from_height.
+        if (ceiling < from_height)
+            return;
+
+        const auto memory = rows_.get(chunk);
+        const auto rows = REMAP_ADDRESS(memory) + rows_offset;
+        const auto matches = match_rows(rows, rows_count, mask, value,
+            from_height);
 
-        // Add row to results.
-        auto deserial = make_unsafe_deserializer(record + height_size);
-        result.push_back(
+        for (auto position = rows_count; position > 0; --position)
         {
-            deserial.read_hash(),
-            deserial.read_short_hash(),
-            deserial.read_hash()
-        });
+            // Skip if prefix doesn't match or height is too low.
+            if ((matches & (uint64_t(1) << (position - 1))) == 0)
+                continue;
+
+            // Add row to results.
+            const auto record = rows + (position - 1) * row_size;
+            auto deserial = make_unsafe_deserializer(record + prefix_size +
+                height_size);
+            result.push_back(
+            {
+                deserial.read_hash(),
+                deserial.read_short_hash(),
+                deserial.read_hash()
+            });
+        }
     }
-
-    // TODO: we could sort result here.
-    return result;
 }
 
 // TODO: add serialization to stealth_compact.
+// A row is written before it is counted or linked, so readers never observe a
+// partial row. Rows of distinct buckets are written concurrently.
 void stealth_database::store(uint32_t prefix, uint32_t height,
     const stealth_compact& row)
 {
-    // Allocate new row.
-    const auto index = rows_manager_.new_records(1);
-    const auto memory = rows_manager_.get(index);
-    const auto data = REMAP_ADDRESS(memory);
+    const auto write = [&](serializer<uint8_t*>& serial)
+    {
+        // Dual key.
+        serial.write_4_bytes_little_endian(prefix);
+        serial.write_4_bytes_little_endian(height);
+
+        // Stealth data.
+        serial.write_hash(row.ephemeral_public_key_hash);
+        serial.write_short_hash(row.public_key_hash);
+        serial.write_hash(row.transaction_hash);
+    };
+
+    const auto bucket = bucket_of(prefix);
+
+    // Critical Section (bucket)
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock writer(writers_[bucket % writers_.size()]);
+
+    const auto newest = header_.read(bucket);
+    size_t rows = chunk_rows;
+    uint32_t ceiling = 0;
 
-    // Write data.
-    auto serial = make_unsafe_serializer(data);
+    if (newest != record_list::empty)
+        read_chunk(newest, rows, ceiling);
 
-    // Dual key.
-    serial.write_4_bytes_little_endian(prefix);
-    serial.write_4_bytes_little_endian(height);
+    ceiling = std::max(ceiling, height);
 
-    // Stealth data.
-    serial.write_hash(row.ephemeral_public_key_hash);
-    serial.write_short_hash(row.public_key_hash);
-    serial.write_hash(row.transaction_hash);
+    if (rows < chunk_rows)
+    {
+        // The remap safe pointer is released before the chunk is updated.
+        {
+            const auto memory = rows_.get(newest);
+            const auto data = REMAP_ADDRESS(memory) + rows_offset +
+                rows * row_size;
+            auto serial = make_unsafe_serializer(data);
+            serial.write_delegated(write);
+            rows_manager_.dirty(data, row_size);
+        }
+
+        write_chunk(newest, rows + 1, ceiling);
+        return;
+    }
+
+    // The chunk is not linked until it is written, so it is not locked.
+    const auto chunk = rows_.insert(newest);
+
+    // The remap safe pointer is released before the header is written.
+    {
+        const auto memory = rows_.get(chunk);
+        auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory));
+        serial.write_4_bytes_little_endian(1);
+        serial.write_4_bytes_little_endian(ceiling);
+        serial.write_delegated(write);
+    }
+
+    header_.write(bucket, chunk);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// The rows at or above the height are removed from each chunk whose ceiling
+// reaches it, keeping the order of the others. The height below then bounds
+// the rows of each such chunk and of the older chunks, so it is the new
+// ceiling. Emptied newest chunks are unlinked but not reclaimed.
+bool stealth_database::unlink(uint32_t prefix, size_t from_height)
+{
+    // No height is above the 32 bit range of the row.
+    if (from_height > max_uint32)
+        return false;
+
+    const auto height = static_cast<uint32_t>(from_height);
+    const auto below = height == 0 ? height : height - 1;
+    const auto bucket = bucket_of(prefix);
+    auto removed = false;
+
+    // Critical Section (bucket)
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock writer(writers_[bucket % writers_.size()]);
+
+    for (auto chunk = header_.read(bucket); chunk != record_list::empty;)
+    {
+        size_t rows;
+        uint32_t ceiling;
+        read_chunk(chunk, rows, ceiling);
+
+        if (ceiling < height)
+            break;
+
+        size_t remaining = 0;
+
+        // The remap safe pointer is released before the chunk is updated.
+        {
+            const auto memory = rows_.get(chunk);
+            const auto data = REMAP_ADDRESS(memory) + rows_offset;
+
+            for (size_t position = 0; position < rows; ++position)
+            {
+                if (row_height(data, position) >= height)
+                    continue;
+
+                if (remaining != position)
+                    std::memmove(data + remaining * row_size,
+                        data + position * row_size, row_size);
+
+                ++remaining;
+            }
+
+            if (remaining != rows && remaining != 0)
+                rows_manager_.dirty(data, remaining * row_size);
+        }
+
+        if (remaining != rows)
+            removed = true;
+
+        const auto next = rows_.next(chunk);
+
+        if (remaining == 0 && header_.read(bucket) == chunk)
+            header_.write(bucket, next);
+        else
+            write_chunk(chunk, remaining, below);
+
+        chunk = next;
+    }
+
+    return removed;
+    ///////////////////////////////////////////////////////////////////////////
 }
 
-////bool stealth_database::unlink()
-////{
-////    // TODO: mark as deleted (not implemented).
-////    return false;
-////}
+void stealth_database::read_chunk(array_index chunk, size_t& count,
+    uint32_t& ceiling) const
+{
+    const auto memory = rows_.get(chunk);
+    const auto address = REMAP_ADDRESS(memory);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(mutex_);
+    count = from_little_endian_unsafe<uint32_t>(address);
+    ceiling = from_little_endian_unsafe<uint32_t>(address + count_size);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void stealth_database::write_chunk(array_index chunk, size_t count,
+    uint32_t ceiling)
+{
+    const auto memory = rows_.get(chunk);
+    const auto address = REMAP_ADDRESS(memory);
+    auto serial = make_unsafe_serializer(address);
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(mutex_);
+    serial.write_4_bytes_little_endian(static_cast<uint32_t>(count));
+    serial.write_4_bytes_little_endian(ceiling);
+    rows_manager_.dirty(address, rows_offset);
+    ///////////////////////////////////////////////////////////////////////////
+}
 
 } // namespace database
 } // namespace libbitcoin
@@ -20,7 +20,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/histogram.hpp>
 #include <bitcoin/database/memory/memory.hpp>
 #include <bitcoin/database/result/transaction_result.hpp>
 
@@ -30,24 +32,36 @@ namespace database {
 using namespace bc::chain;
 using namespace bc::machine;
 
-static constexpr auto value_size = sizeof(uint64_t);
 static constexpr auto height_size = sizeof(uint32_t);
 static constexpr auto version_size = sizeof(uint32_t);
 static constexpr auto locktime_size = sizeof(uint32_t);
 static constexpr auto position_size = sizeof(uint32_t);
+static constexpr auto count_size = sizeof(uint32_t);
+static constexpr auto offset_size = sizeof(uint32_t);
 static constexpr auto version_lock_size = version_size + locktime_size;
 
 const size_t transaction_database::unconfirmed = max_uint32;
 
+// One in this many reads and spends is timed.
+static constexpr size_t latency_sample_rate = 64;
+
 // Transactions uses a hash table index, O(1).
 transaction_database::transaction_database(const path& map_filename,
-    size_t buckets, size_t expansion, size_t cache_capacity, mutex_ptr mutex)
+    size_t buckets, size_t expansion, size_t cache_capacity, mutex_ptr mutex,
+    bool open_addressing, size_t max_load, size_t cache_budget,
+    eviction_policy cache_policy, const mapping_policy& mapping)
   : initial_map_file_size_(slab_hash_table_header_size(buckets) + minimum_slabs_size),
-    lookup_file_(map_filename, mutex, expansion),
-    lookup_header_(lookup_file_, buckets),
+    open_addressing_(open_addressing),
+    lookup_file_(map_filename, mutex, expansion, mapping),
+    lookup_header_(lookup_file_, buckets,
+        open_addressing ? table_kind::open : table_kind::chained),
     lookup_manager_(lookup_file_, slab_hash_table_header_size(buckets)),
-    lookup_map_(lookup_header_, lookup_manager_),
-    cache_(cache_capacity)
+    lookup_map_(lookup_header_, lookup_manager_, max_load),
+    lookup_open_map_(lookup_header_, lookup_manager_),
+    cache_(cache_capacity, cache_budget, cache_policy),
+    get_latency_(latency_sample_rate),
+    get_output_latency_(latency_sample_rate),
+    spend_latency_(latency_sample_rate)
 {
 }
 
@@ -76,7 +90,8 @@ bool transaction_database::create()
     // Should not call start after create, already started.
     return
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        (open_addressing_ ? lookup_open_map_.start() : lookup_map_.start());
 }
 
 // Startup and shutdown.
@@ -88,7 +103,8 @@ bool transaction_database::open()
     return
         lookup_file_.open() &&
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        (open_addressing_ ? lookup_open_map_.start() : lookup_map_.start());
 }
 
 // Close files.
@@ -100,7 +116,25 @@ bool transaction_database::close()
 // Commit latest inserts.
 void transaction_database::synchronize()
 {
-    lookup_manager_.sync();
+    synchronize(end());
+}
+
+file_offset transaction_database::end() const
+{
+    return lookup_manager_.payload_size();
+}
+
+void transaction_database::synchronize(file_offset end)
+{
+    lookup_manager_.sync(end);
+
+    if (lookup_map_.resizing())
+    {
+        LOG_DEBUG(LOG_DATABASE)
+            << "Transaction table resize: " << lookup_map_.migrated()
+            << " of " << lookup_map_.buckets() << " buckets migrated, load: "
+            << lookup_map_.load() << "%";
+    }
 }
 
 // Flush the memory map to disk.
@@ -109,6 +143,46 @@ bool transaction_database::flush() const
     return lookup_file_.flush();
 }
 
+void transaction_database::attach(journal& journal)
+{
+    journal.attach(lookup_file_);
+}
+
+bool transaction_database::save_cache(const path& file,
+    const config::checkpoint& top) const
+{
+    return cache_.save(file, top);
+}
+
+bool transaction_database::load_cache(const path& file,
+    const config::checkpoint& top)
+{
+    if (!cache_.load(file, top))
+        return false;
+
+    LOG_INFO(LOG_DATABASE)
+        << "Output cache loaded: " << cache_.size() << " transactions, "
+        << cache_.bytes() << " bytes.";
+    return true;
+}
+
+latency::list transaction_database::latencies() const
+{
+    return
+    {
+        { "transaction.get", get_latency_.capture() },
+        { "transaction.get_output", get_output_latency_.capture() },
+        { "transaction.spend", spend_latency_.capture() }
+    };
+}
+
+void transaction_database::reset_latencies()
+{
+    get_latency_.reset();
+    get_output_latency_.reset();
+    spend_latency_.reset();
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
@@ -123,7 +197,8 @@ memory_ptr transaction_database::find(const hash_digest& hash,
     // but consistent with the current satoshi implementation. This method
     // encapsulates that assumption which can therefore be fixed in one place.
     //*************************************************************************
-    auto slab = lookup_map_.find(hash /*, fork_height, require_confirmed*/);
+    auto slab = open_addressing_ ? lookup_open_map_.find(hash) :
+        lookup_map_.find(hash /*, fork_height, require_confirmed*/);
 
     if (slab == nullptr || !require_confirmed)
         return slab;
@@ -141,9 +216,27 @@ memory_ptr transaction_database::find(const hash_digest& hash,
         nullptr : slab;
 }
 
+void transaction_database::prefetch_bucket(const hash_digest& hash) const
+{
+    if (open_addressing_)
+        lookup_open_map_.prefetch_bucket(hash);
+    else
+        lookup_map_.prefetch_bucket(hash);
+}
+
+void transaction_database::prefetch_row(const hash_digest& hash) const
+{
+    if (open_addressing_)
+        lookup_open_map_.prefetch_row(hash);
+    else
+        lookup_map_.prefetch_row(hash);
+}
+
 transaction_result transaction_database::get(const hash_digest& hash,
     size_t fork_height, bool require_confirmed) const
 {
+    const histogram::timer timer(get_latency_);
+
     // Limit search to confirmed transactions at or below the fork height.
     // Caller should set fork height to max_size_t for unconfirmed search.
     const auto slab = find(hash, fork_height, require_confirmed);
@@ -156,6 +249,9 @@ bool transaction_database::get_output(output& out_output, size_t& out_height,
     bool& out_coinbase, const output_point& point, size_t fork_height,
     bool require_confirmed) const
 {
+    // This includes hits of the output cache.
+    const histogram::timer timer(get_output_latency_);
+
     if (cache_.get(out_output, out_height, out_coinbase, point, fork_height,
         require_confirmed))
         return true;
@@ -197,6 +293,64 @@ bool transaction_database::get_output_is_confirmed(output& out_output, size_t& o
     return true;
 }
 
+// Each miss of the cache costs a bucket read and a dependent row read. These
+// are issued as prefetches for the whole batch, bucket reads first, so that
+// their latencies overlap before the rows are resolved in order.
+void transaction_database::get_outputs(output_results& out_results,
+    const output_point::list& points, size_t fork_height,
+    bool require_confirmed) const
+{
+    out_results.resize(points.size());
+    std::vector<size_t> misses;
+
+    for (size_t index = 0; index < points.size(); ++index)
+    {
+        auto& result = out_results[index];
+        result.found = cache_.get_is_confirmed(result.output, result.height,
+            result.coinbase, result.confirmed, points[index], fork_height,
+            require_confirmed);
+
+        if (!result.found)
+            misses.push_back(index);
+    }
+
+    for (const auto index: misses)
+        prefetch_bucket(points[index].hash());
+
+    for (const auto index: misses)
+        prefetch_row(points[index].hash());
+
+    for (const auto index: misses)
+    {
+        const auto& point = points[index];
+        auto& result = out_results[index];
+        const auto slab = find(point.hash(), fork_height, require_confirmed);
+
+        // The transaction does not exist at/below fork with matching confirmation.
+        if (!slab)
+            continue;
+
+        const transaction_result transaction(slab, point.hash());
+        result.found = true;
+        result.height = transaction.height();
+        result.coinbase = transaction.position() == 0;
+        result.output = transaction.output(point.index());
+        result.confirmed = transaction.position() != unconfirmed;
+    }
+}
+
+// The chained table grows, so it requires no reservation.
+bool transaction_database::reserve(size_t count)
+{
+    return !open_addressing_ || lookup_open_map_.reserve(count);
+}
+
+void transaction_database::release(size_t count)
+{
+    if (open_addressing_)
+        lookup_open_map_.release(count);
+}
+
 void transaction_database::store(const chain::transaction& tx,
     size_t height, size_t position)
 {
@@ -209,6 +363,8 @@ void transaction_database::store(const chain::transaction& tx,
     {
         if (confirm(hash, height, position))
         {
+            // The tx is not stored, so its reservation is returned.
+            release(1);
             cache_.add(tx, height, true);
             return;
         }
@@ -227,6 +383,7 @@ void transaction_database::store(const chain::transaction& tx,
     {
         serial.write_4_bytes_little_endian(static_cast<size_t>(height));
         serial.write_4_bytes_little_endian(static_cast<size_t>(position));
+        transaction_result::write_offsets(serial, tx);
 
         // WRITE THE TX
         tx.to_data(serial, false);
@@ -234,10 +391,15 @@ void transaction_database::store(const chain::transaction& tx,
 
     const auto tx_size = tx.serialized_size(false);
     BITCOIN_ASSERT(tx_size <= max_size_t - version_lock_size);
-    const auto value_size = version_lock_size + static_cast<size_t>(tx_size);
+    const auto value_size = version_lock_size + static_cast<size_t>(tx_size) +
+        transaction_result::offsets_size(tx);
 
     // Create slab for the new tx instance.
-    lookup_map_.store(hash, write, value_size);
+    if (open_addressing_)
+        lookup_open_map_.store(hash, write, value_size);
+    else
+        lookup_map_.store(hash, write, value_size);
+
     cache_.add(tx, height, position != unconfirmed);
 
     // We report theis here because its a steady interval (block announce).
@@ -245,13 +407,17 @@ void transaction_database::store(const chain::transaction& tx,
     {
         LOG_DEBUG(LOG_DATABASE)
             << "Output cache hit rate: " << cache_.hit_rate() << ", size: "
-            << cache_.size();
+            << cache_.size() << ", bytes: " << cache_.bytes()
+            << ", evictions: " << cache_.evictions();
     }
 }
 
 bool transaction_database::spend(const output_point& point,
     size_t spender_height)
 {
+    // This includes unspend, which is a spend at the not_spent height.
+    const histogram::timer timer(spend_latency_);
+
     // If unspent we could restore the spend to the cache, but not worth it.
     if (spender_height != output::validation::not_spent)
         cache_.remove(point);
@@ -267,26 +433,23 @@ bool transaction_database::spend(const output_point& point,
         return false;
 
     const auto memory = REMAP_ADDRESS(slab);
-    const auto tx_start = memory + height_size + position_size;
-    auto serial = make_unsafe_serializer(tx_start);
-    serial.skip(version_size + locktime_size);
-    const auto outputs = serial.read_size_little_endian();
-    BITCOIN_ASSERT(serial);
+    const auto offsets = memory + height_size + position_size;
+    const auto outputs = from_little_endian_unsafe<uint32_t>(offsets);
 
     // The index is not in the transaction.
     if (point.index() >= outputs)
         return false;
 
-    // Skip outputs until the target output.
-    for (uint32_t output = 0; output < point.index(); ++output)
-    {
-        serial.skip(height_size + value_size);
-        serial.skip(serial.read_size_little_endian());
-        BITCOIN_ASSERT(serial);
-    }
+    // The output offset table locates the target output without parsing.
+    const auto table = offsets + count_size;
+    const auto tx_start = table + outputs * offset_size;
+    const auto offset = from_little_endian_unsafe<uint32_t>(
+        table + point.index() * offset_size);
 
     // Write the spender height to the first word of the target output.
+    auto serial = make_unsafe_serializer(tx_start + offset);
     serial.write_4_bytes_little_endian(spender_height);
+    lookup_file_.dirty(tx_start + offset, sizeof(uint32_t));
     return true;
 }
 
@@ -311,6 +474,7 @@ bool transaction_database::confirm(const hash_digest& hash, size_t height,
     auto serial = make_unsafe_serializer(memory);
     serial.write_4_bytes_little_endian(static_cast<size_t>(height));
     serial.write_4_bytes_little_endian(static_cast<size_t>(position));
+    lookup_file_.dirty(memory, height_size + position_size);
     return true;
 }
 
@@ -39,12 +39,16 @@ const size_t transaction_unconfirmed_database::unconfirmed = max_uint32;
 
 // Transactions uses a hash table index, O(1).
 transaction_unconfirmed_database::transaction_unconfirmed_database(const path& map_filename,
-    size_t buckets, size_t expansion, mutex_ptr mutex)
+    size_t buckets, size_t expansion, mutex_ptr mutex, bool open_addressing,
+    const mapping_policy& mapping)
   : initial_map_file_size_(slab_hash_table_header_size(buckets) + minimum_slabs_size),
-    lookup_file_(map_filename, mutex, expansion),
-    lookup_header_(lookup_file_, buckets),
+    open_addressing_(open_addressing),
+    lookup_file_(map_filename, mutex, expansion, mapping),
+    lookup_header_(lookup_file_, buckets,
+        open_addressing ? table_kind::open : table_kind::chained),
     lookup_manager_(lookup_file_, slab_hash_table_header_size(buckets)),
-    lookup_map_(lookup_header_, lookup_manager_)
+    lookup_map_(lookup_header_, lookup_manager_),
+    lookup_open_map_(lookup_header_, lookup_manager_)
 {}
 
 transaction_unconfirmed_database::~transaction_unconfirmed_database()
@@ -72,7 +76,8 @@ bool transaction_unconfirmed_database::create()
     // Should not call start after create, already started.
     return
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        (!open_addressing_ || lookup_open_map_.start());
 }
 
 // Startup and shutdown.
@@ -84,7 +89,8 @@ bool transaction_unconfirmed_database::open()
     return
         lookup_file_.open() &&
         lookup_header_.start() &&
-        lookup_manager_.start();
+        lookup_manager_.start() &&
+        (!open_addressing_ || lookup_open_map_.start());
 }
 
 // Close files.
@@ -105,6 +111,11 @@ bool transaction_unconfirmed_database::flush() const
     return lookup_file_.flush();
 }
 
+void transaction_unconfirmed_database::attach(journal& journal)
+{
+    journal.attach(lookup_file_);
+}
+
 // Queries.
 // ----------------------------------------------------------------------------
 
@@ -118,7 +129,8 @@ memory_ptr transaction_unconfirmed_database::find(const hash_digest& hash) const
     // but consistent with the current satoshi implementation. This method
     // encapsulates that assumption which can therefore be fixed in one place.
     //*************************************************************************
-    auto slab = lookup_map_.find(hash);
+    auto slab = open_addressing_ ? lookup_open_map_.find(hash) :
+        lookup_map_.find(hash);
     return slab;
 }
 
@@ -132,6 +144,12 @@ transaction_result transaction_unconfirmed_database::get(const hash_digest& hash
     return transaction_result(slab, hash);
 }
 
+// The chained table grows, so it requires no reservation.
+bool transaction_unconfirmed_database::reserve(size_t count)
+{
+    return !open_addressing_ || lookup_open_map_.reserve(count);
+}
+
 void transaction_unconfirmed_database::store(const chain::transaction& tx)
 {
     const auto hash = tx.hash();
@@ -141,6 +159,7 @@ void transaction_unconfirmed_database::store(const chain::transaction& tx)
     {
         serial.write_4_bytes_little_endian(static_cast<size_t>(0));
         serial.write_4_bytes_little_endian(static_cast<size_t>(unconfirmed));
+        transaction_result::write_offsets(serial, tx);
 
         // WRITE THE TX
         tx.to_data(serial, false);
@@ -148,10 +167,35 @@ void transaction_unconfirmed_database::store(const chain::transaction& tx)
 
     const auto tx_size = tx.serialized_size(false);
     BITCOIN_ASSERT(tx_size <= max_size_t - version_lock_size);
-    const auto value_size = version_lock_size + static_cast<size_t>(tx_size);
+    const auto value_size = version_lock_size + static_cast<size_t>(tx_size) +
+        transaction_result::offsets_size(tx);
+
+    // Create slab for the new tx instance.
+    if (open_addressing_)
+        lookup_open_map_.store(hash, write, value_size);
+    else
+        lookup_map_.store(hash, write, value_size);
+}
+
+// The spender heights of the outputs are copied along with the transaction.
+void transaction_unconfirmed_database::store(const transaction_result& result)
+{
+    const auto body_size = result.body_size();
+
+    const auto write = [&](serializer<uint8_t*>& serial)
+    {
+        serial.write_4_bytes_little_endian(static_cast<size_t>(0));
+        serial.write_4_bytes_little_endian(static_cast<size_t>(unconfirmed));
+        result.write_body(serial, body_size);
+    };
+
+    const auto value_size = version_lock_size + body_size;
 
     // Create slab for the new tx instance.
-    lookup_map_.store(hash, write, value_size);
+    if (open_addressing_)
+        lookup_open_map_.store(result.hash(), write, value_size);
+    else
+        lookup_map_.store(result.hash(), write, value_size);
 }
 
 // bool transaction_unconfirmed_database::spend(const output_point& point, size_t spender_height)
@@ -160,11 +204,12 @@ void transaction_unconfirmed_database::store(const chain::transaction& tx)
 // bool transaction_unconfirmed_database::unconfirm(const hash_digest& hash)
 
 bool transaction_unconfirmed_database::unlink(hash_digest const& hash) {
-    return lookup_map_.unlink(hash);
+    return open_addressing_ ? lookup_open_map_.unlink(hash) :
+        lookup_map_.unlink(hash);
 }
 
 bool transaction_unconfirmed_database::unlink_if_exists(hash_digest const& hash) {
-    auto memory = lookup_map_.find(hash);
+    auto memory = find(hash);
     if (memory == nullptr)
         return false;
 
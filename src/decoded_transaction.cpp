@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/database/decoded_transaction.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+using namespace bc::chain;
+using namespace bc::wallet;
+
+decoded_transaction::decoded_transaction(const transaction& tx)
+  : decoded_transaction(tx.hash(), tx.inputs(), tx.outputs(),
+        tx.is_coinbase())
+{
+}
+
+decoded_transaction::decoded_transaction(const hash_digest& hash,
+    const input::list& inputs, const output::list& outputs, bool coinbase)
+  : hash_(hash)
+{
+    if (!coinbase)
+        decode_inputs(inputs);
+
+    decode_outputs(outputs);
+}
+
+const hash_digest& decoded_transaction::hash() const
+{
+    return hash_;
+}
+
+const decoded_transaction::addresses& decoded_transaction::inputs() const
+{
+    return inputs_;
+}
+
+const decoded_transaction::addresses& decoded_transaction::outputs() const
+{
+    return outputs_;
+}
+
+const decoded_transaction::stealths& decoded_transaction::stealth_rows() const
+{
+    return stealths_;
+}
+
+// private
+void decoded_transaction::decode_inputs(const input::list& inputs)
+{
+    for (uint32_t index = 0; index < inputs.size(); ++index)
+    {
+        // Try to extract an address.
+        const auto address = inputs[index].address();
+
+        if (address)
+            inputs_.emplace_back(index, address.hash());
+    }
+}
+
+// private
+// The stealth payment address is that of the second output of a pair, so
+// each output script is only decoded for an address once.
+void decoded_transaction::decode_outputs(const output::list& outputs)
+{
+    for (uint32_t index = 0; index < outputs.size(); ++index)
+    {
+        // Try to extract an address.
+        const auto address = outputs[index].address();
+
+        if (!address)
+            continue;
+
+        outputs_.emplace_back(index, address.hash());
+
+        // Stealth outputs are paired by convention.
+        if (index == 0)
+            continue;
+
+        const auto& ephemeral_script = outputs[index - 1].script();
+
+        // Try to extract an unsigned ephemeral key from the first output.
+        hash_digest unsigned_ephemeral_key;
+        if (!extract_ephemeral_key(unsigned_ephemeral_key, ephemeral_script))
+            continue;
+
+        // Try to extract a stealth prefix from the first output.
+        uint32_t prefix;
+        if (!to_stealth_prefix(prefix, ephemeral_script))
+            continue;
+
+        // The payment address versions are arbitrary and unused here.
+        stealths_.push_back(
+        {
+            prefix,
+            {
+                unsigned_ephemeral_key,
+                address.hash(),
+                hash_
+            }
+        });
+    }
+}
+
+} // namespace database
+} // namespace libbitcoin
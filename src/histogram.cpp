@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/database/histogram.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+BC_CONSTEXPR size_t histogram::sub_bucket_bits;
+BC_CONSTEXPR size_t histogram::sub_buckets;
+BC_CONSTEXPR size_t histogram::buckets;
+
+static size_t most_significant_bit(uint64_t value)
+{
+    size_t bit = 0;
+
+    while (value >>= 1)
+        ++bit;
+
+    return bit;
+}
+
+// Values below sub_buckets have a bucket each. Above that each power of two
+// has sub_buckets buckets, indexed by the bits following the leading bit.
+size_t histogram::bucket(uint64_t value)
+{
+    if (value < sub_buckets)
+        return static_cast<size_t>(value);
+
+    const auto bit = most_significant_bit(value);
+    const auto shift = bit - sub_bucket_bits;
+    const auto mantissa = static_cast<size_t>(value >> shift);
+    return (shift + 1) * sub_buckets + mantissa - sub_buckets;
+}
+
+uint64_t histogram::upper(size_t bucket)
+{
+    if (bucket < sub_buckets)
+        return bucket;
+
+    const auto shift = bucket / sub_buckets - 1;
+    const uint64_t mantissa = bucket % sub_buckets + sub_buckets;
+
+    // The top bucket ends at the maximum value.
+    if (bucket + 1 == buckets)
+        return max_uint64;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+histogram::histogram(size_t sample_rate)
+  : sample_mask_(sample_rate - 1)
+{
+    BITCOIN_ASSERT_MSG(sample_rate != 0 &&
+        (sample_rate & sample_mask_) == 0, "Sample rate not a power of two.");
+
+    reset();
+}
+
+// A per thread xorshift sequence, which does not alias the pattern of calls
+// across the histograms of a thread as a counter would.
+bool histogram::sample() const
+{
+    if (sample_mask_ == 0)
+        return true;
+
+    static thread_local uint32_t state = 0x9e3779b9;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state & sample_mask_) == 0;
+}
+
+// The counts are independent, a concurrent capture may see a value counted
+// but not yet totaled. This is tolerable for reporting purposes. The minimum
+// and maximum are only written when they change.
+void histogram::record(uint64_t microseconds)
+{
+    counts_[bucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(microseconds, std::memory_order_relaxed);
+
+    auto minimum = minimum_.load(std::memory_order_relaxed);
+    while (microseconds < minimum && !minimum_.compare_exchange_weak(minimum,
+        microseconds, std::memory_order_relaxed));
+
+    auto maximum = maximum_.load(std::memory_order_relaxed);
+    while (microseconds > maximum && !maximum_.compare_exchange_weak(maximum,
+        microseconds, std::memory_order_relaxed));
+}
+
+void histogram::record(const asio::time_point& start)
+{
+    const auto elapsed = asio::steady_clock::now() - start;
+    record(std::chrono::duration_cast<std::chrono::microseconds>(
+        elapsed).count());
+}
+
+histogram::snapshot histogram::capture() const
+{
+    snapshot out;
+    out.count = 0;
+    out.sample_rate = sample_mask_ + 1;
+    out.counts.reserve(buckets);
+
+    for (const auto& count: counts_)
+    {
+        out.counts.push_back(count.load(std::memory_order_relaxed));
+        out.count += out.counts.back();
+    }
+
+    out.total = total_.load(std::memory_order_relaxed);
+    out.minimum = out.count == 0 ? 0 :
+        minimum_.load(std::memory_order_relaxed);
+    out.maximum = maximum_.load(std::memory_order_relaxed);
+    return out;
+}
+
+void histogram::reset()
+{
+    for (auto& count: counts_)
+        count.store(0, std::memory_order_relaxed);
+
+    total_.store(0, std::memory_order_relaxed);
+    minimum_.store(max_uint64, std::memory_order_relaxed);
+    maximum_.store(0, std::memory_order_relaxed);
+}
+
+// snapshot
+// ----------------------------------------------------------------------------
+
+uint64_t histogram::snapshot::mean() const
+{
+    return count == 0 ? 0 : total / count;
+}
+
+uint64_t histogram::snapshot::operations() const
+{
+    return count * sample_rate;
+}
+
+uint64_t histogram::snapshot::percentile(double percent) const
+{
+    uint64_t counted = 0;
+    for (const auto count: counts)
+        counted += count;
+
+    if (counted == 0)
+        return 0;
+
+    // The rank is one-based, the percentile of one value is that value.
+    const auto clamped = std::max(0.0, std::min(100.0, percent));
+    const auto rank = std::max(uint64_t(1),
+        static_cast<uint64_t>(clamped * counted / 100.0 + 0.5));
+
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket)
+    {
+        cumulative += counts[bucket];
+
+        if (cumulative >= rank)
+            return std::min(histogram::upper(bucket), maximum);
+    }
+
+    return maximum;
+}
+
+// timer
+// ----------------------------------------------------------------------------
+
+histogram::timer::timer(histogram& histogram)
+  : histogram_(histogram), sampled_(histogram.sample()),
+    start_(sampled_ ? asio::steady_clock::now() : asio::time_point())
+{
+}
+
+histogram::timer::~timer()
+{
+    if (sampled_)
+        histogram_.record(start_);
+}
+
+// latency
+// ----------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& output, const latency& latency)
+{
+    const auto& snapshot = latency.snapshot;
+
+    output << latency.name << ": count [" << snapshot.count << "]";
+
+    if (snapshot.sample_rate > 1)
+        output
+            << " sampled [1/" << snapshot.sample_rate << "] operations [~"
+            << snapshot.operations() << "]";
+
+    output
+        << " mean [" << snapshot.mean() << "] p50 [" << snapshot.percentile(50)
+        << "] p90 [" << snapshot.percentile(90) << "] p99 ["
+        << snapshot.percentile(99) << "] p99.9 ["
+        << snapshot.percentile(99.9) << "] max [" << snapshot.maximum
+        << "] us";
+
+    return output;
+}
+
+} // namespace database
+} // namespace libbitcoin
@@ -0,0 +1,340 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/database/journal.hpp>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include "mman-win32/mman.h"
+    #define FILE_OPEN_PERMISSIONS _S_IREAD | _S_IWRITE
+#else
+    #include <unistd.h>
+    #define FILE_OPEN_PERMISSIONS S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/memory/memory.hpp>
+#include <bitcoin/database/memory/memory_map.hpp>
+
+namespace libbitcoin {
+namespace database {
+
+#define FAIL -1
+#define INVALID_HANDLE -1
+
+// Each commit is a size prefixed payload of file sections:
+// [payload size:8]
+// [name size:1][name][ranges:4]([offset:8][size:8][bytes])...
+static constexpr size_t name_prefix_size = sizeof(uint8_t);
+static constexpr size_t ranges_prefix_size = sizeof(uint32_t);
+static constexpr size_t range_prefix_size = 2 * sizeof(uint64_t);
+
+// A table resize or creation is flushed in place rather than copied.
+const uint64_t journal::maximum_commit = 256 * 1024 * 1024;
+
+static int open_file(const boost::filesystem::path& filename, int flags)
+{
+#ifdef _WIN32
+    return _wopen(filename.wstring().c_str(), flags | O_BINARY,
+        FILE_OPEN_PERMISSIONS);
+#else
+    return ::open(filename.string().c_str(), flags, FILE_OPEN_PERMISSIONS);
+#endif
+}
+
+static bool write_all(int handle, const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        const auto written = ::write(handle, data, size);
+
+        if (written <= 0)
+            return false;
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+// static
+bool journal::replay(const path& filename)
+{
+    boost::system::error_code ec;
+
+    if (!boost::filesystem::exists(filename, ec))
+        return true;
+
+    LOG_INFO(LOG_DATABASE)
+        << "Replaying journal: " << filename;
+
+    const auto directory = filename.parent_path();
+    std::map<std::string, int> handles;
+    bc::ifstream stream(filename.string(), std::ios::binary);
+    istream_reader source(stream);
+    auto success = true;
+
+    const auto open = [&](const std::string& name)
+    {
+        const auto it = handles.find(name);
+
+        if (it != handles.end())
+            return it->second;
+
+        const auto handle = open_file(directory / name, O_RDWR);
+        handles.emplace(name, handle);
+        return handle;
+    };
+
+    while (success && !source.is_exhausted())
+    {
+        const auto size = source.read_8_bytes_little_endian();
+
+        // A commit that was not fully written was not committed.
+        if (!source || size > maximum_commit)
+            break;
+
+        const auto payload = source.read_bytes(size);
+
+        if (!source)
+            break;
+
+        auto deserial = make_safe_deserializer(payload.data(),
+            payload.data() + payload.size());
+
+        while (success && !deserial.is_exhausted())
+        {
+            const auto name_size = deserial.read_byte();
+            const auto name = deserial.read_bytes(name_size);
+            const auto ranges = deserial.read_4_bytes_little_endian();
+            const auto handle = open(std::string(name.begin(), name.end()));
+            success = deserial && handle != INVALID_HANDLE;
+
+            for (uint32_t range = 0; success && range < ranges; ++range)
+            {
+                const auto offset = deserial.read_8_bytes_little_endian();
+                const auto size = deserial.read_8_bytes_little_endian();
+                const auto bytes = deserial.read_bytes(size);
+
+                success = deserial &&
+                    lseek(handle, offset, SEEK_SET) != FAIL &&
+                    write_all(handle, bytes.data(), bytes.size());
+            }
+        }
+    }
+
+    for (const auto& handle: handles)
+        if (handle.second != INVALID_HANDLE)
+            success = (fsync(handle.second) != FAIL) &&
+                (::close(handle.second) != FAIL) && success;
+
+    stream.close();
+
+    // The journal is retained if it could not be applied.
+    if (!success)
+    {
+        LOG_FATAL(LOG_DATABASE)
+            << "The journal failed to replay: " << filename;
+        return false;
+    }
+
+    boost::filesystem::remove(filename, ec);
+    return true;
+}
+
+journal::journal(const path& filename, size_t interval)
+  : filename_(filename),
+    interval_(interval),
+    file_handle_(INVALID_HANDLE),
+    commits_(0),
+    size_(0)
+{
+}
+
+journal::~journal()
+{
+    if (file_handle_ != INVALID_HANDLE)
+        ::close(file_handle_);
+}
+
+void journal::attach(memory_map& file)
+{
+    file.track(true);
+    files_.push_back(&file);
+}
+
+bool journal::open()
+{
+    BITCOIN_ASSERT(file_handle_ == INVALID_HANDLE);
+    file_handle_ = open_file(filename_, O_RDWR | O_CREAT | O_TRUNC);
+
+    if (file_handle_ == INVALID_HANDLE)
+        return handle_error("open");
+
+    commits_ = 0;
+    size_ = 0;
+    return true;
+}
+
+bool journal::commit()
+{
+    std::vector<memory_map::ranges> written;
+    written.reserve(files_.size());
+    uint64_t payload = 0;
+
+    for (const auto file: files_)
+    {
+        written.push_back(file->take_dirty());
+
+        if (written.back().empty())
+            continue;
+
+        payload += name_prefix_size + ranges_prefix_size +
+            file->filename().filename().string().size();
+
+        for (const auto& range: written.back())
+            payload += range_prefix_size + range.second;
+    }
+
+    if (payload == 0)
+        return true;
+
+    // The taken ranges are flushed in place by the checkpoint.
+    if (++commits_ >= interval_ || size_ + payload > maximum_commit)
+        return checkpoint();
+
+    data_chunk prefix(sizeof(uint64_t));
+    auto serial = make_unsafe_serializer(prefix.data());
+    serial.write_8_bytes_little_endian(payload);
+
+    if (!write(prefix.data(), prefix.size()))
+        return false;
+
+    for (size_t index = 0; index < files_.size(); ++index)
+    {
+        const auto& ranges = written[index];
+
+        if (ranges.empty())
+            continue;
+
+        const auto name = files_[index]->filename().filename().string();
+        BITCOIN_ASSERT(name.size() <= max_uint8);
+        BITCOIN_ASSERT(ranges.size() <= max_uint32);
+
+        data_chunk section(name_prefix_size + name.size() +
+            ranges_prefix_size);
+        auto serial = make_unsafe_serializer(section.data());
+        serial.write_byte(static_cast<uint8_t>(name.size()));
+        serial.write_bytes(data_chunk(name.begin(), name.end()));
+        serial.write_4_bytes_little_endian(
+            static_cast<uint32_t>(ranges.size()));
+
+        if (!write(section.data(), section.size()))
+            return false;
+
+        // The accessor must remain in scope until the end of the block.
+        const auto memory = files_[index]->access();
+        const auto start = REMAP_ADDRESS(memory);
+
+        for (const auto& range: ranges)
+        {
+            data_chunk header(range_prefix_size);
+            auto serial = make_unsafe_serializer(header.data());
+            serial.write_8_bytes_little_endian(range.first);
+            serial.write_8_bytes_little_endian(range.second);
+
+            if (!write(header.data(), header.size()) ||
+                !write(start + range.first, range.second))
+                return false;
+        }
+    }
+
+    if (fsync(file_handle_) == FAIL)
+        return handle_error("fsync");
+
+    size_ += sizeof(uint64_t) + payload;
+    return true;
+}
+
+bool journal::checkpoint()
+{
+    // Prior writes are flushed in place, so their ranges are not journaled.
+    for (const auto file: files_)
+    {
+        file->take_dirty();
+
+        if (!file->flush())
+            return false;
+    }
+
+    if (ftruncate(file_handle_, 0) == FAIL ||
+        lseek(file_handle_, 0, SEEK_SET) == FAIL ||
+        fsync(file_handle_) == FAIL)
+        return handle_error("truncate");
+
+    commits_ = 0;
+    size_ = 0;
+    return true;
+}
+
+bool journal::close()
+{
+    if (file_handle_ == INVALID_HANDLE)
+        return true;
+
+    if (::close(file_handle_) == FAIL)
+        return handle_error("close");
+
+    file_handle_ = INVALID_HANDLE;
+    files_.clear();
+
+    boost::system::error_code ec;
+    boost::filesystem::remove(filename_, ec);
+    return !ec;
+}
+
+// private
+bool journal::write(const uint8_t* data, size_t size)
+{
+    return write_all(file_handle_, data, size) || handle_error("write");
+}
+
+// private
+bool journal::handle_error(const std::string& context) const
+{
+#ifdef _WIN32
+    const auto error = GetLastError();
+#else
+    const auto error = errno;
+#endif
+    LOG_FATAL(LOG_DATABASE)
+        << "The journal failed to " << context << ": "
+        << filename_ << " : " << error;
+    return false;
+}
+
+} // namespace database
+} // namespace libbitcoin
@@ -28,18 +28,27 @@
     #include <unistd.h>
     #include <stddef.h>
     #include <sys/mman.h>
+    #include <sys/resource.h>
     #define FILE_OPEN_PERMISSIONS S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH
 #endif
+#ifdef __linux__
+    #include <sys/syscall.h>
+#endif
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fcntl.h>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/database/histogram.hpp>
 #include <bitcoin/database/memory/accessor.hpp>
 #include <bitcoin/database/memory/allocator.hpp>
 #include <bitcoin/database/memory/memory.hpp>
@@ -57,6 +66,60 @@ namespace database {
 // The percentage increase, e.g. 50 is 150% of the target size.
 const size_t memory_map::default_expansion = 50;
 
+mapping_policy::mapping_policy()
+  : advice(access::random),
+    huge_pages(false),
+    interleave(false),
+    populate_header(false),
+    lock_header(false),
+    reservation(0),
+    allocation_chunk(0)
+{
+}
+
+void memory_map::faults(size_t& out_minor, size_t& out_major)
+{
+    out_minor = 0;
+    out_major = 0;
+
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == FAIL)
+        return;
+
+    out_minor = static_cast<size_t>(usage.ru_minflt);
+    out_major = static_cast<size_t>(usage.ru_majflt);
+#endif
+}
+
+histogram& memory_map::resizes()
+{
+    static histogram latencies;
+    return latencies;
+}
+
+// Interleave is applied to the entire mapping, as a policy on part of the
+// mapping would split it, which prevents mremap.
+static bool interleave(void* address, size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+    static constexpr int mpol_interleave = 3;
+    static constexpr unsigned long mpol_f_mems_allowed = 1 << 2;
+    static constexpr unsigned long max_nodes = 1024;
+    static constexpr auto word_bits = 8 * sizeof(unsigned long);
+    unsigned long nodes[max_nodes / word_bits] = { 0 };
+
+    if (syscall(SYS_get_mempolicy, nullptr, nodes, max_nodes, nullptr,
+        mpol_f_mems_allowed) == FAIL)
+        return false;
+
+    return syscall(SYS_mbind, address, size, mpol_interleave, nodes,
+        max_nodes, 0) != FAIL;
+#else
+    return false;
+#endif
+}
+
 size_t memory_map::file_size(int file_handle)
 {
     if (file_handle == INVALID_HANDLE)
@@ -124,10 +187,11 @@ void memory_map::log_resizing(size_t size) const
         << "Resizing: " << filename_ << " [" << size << "]";
 }
 
-void memory_map::log_flushed() const
+void memory_map::log_flushed(size_t bytes, size_t milliseconds) const
 {
     LOG_DEBUG(LOG_DATABASE)
-        << "Flushed: " << filename_ << " [" << logical_size_ << "]";
+        << "Flushed: " << filename_ << " [" << logical_size_ << "] ("
+        << bytes << " bytes in " << milliseconds << " ms)";
 }
 
 void memory_map::log_unmapping() const
@@ -136,10 +200,11 @@ void memory_map::log_unmapping() const
         << "Unmapping: " << filename_ << " [" << logical_size_ << "]";
 }
 
-void memory_map::log_unmapped() const
+void memory_map::log_unmapped(size_t resident) const
 {
     LOG_DEBUG(LOG_DATABASE)
-        << "Unmapped: " << filename_ << " [" << logical_size_ << "]";
+        << "Unmapped: " << filename_ << " [" << logical_size_ << "] ("
+        << resident << " bytes resident)";
 }
 
 memory_map::memory_map(const path& filename)
@@ -152,17 +217,33 @@ memory_map::memory_map(const path& filename, mutex_ptr mutex)
 {
 }
 
-// mmap documentation: tinyurl.com/hnbw8t5
 memory_map::memory_map(const path& filename, mutex_ptr mutex, size_t expansion)
+  : memory_map(filename, mutex, expansion, mapping_policy())
+{
+}
+
+// mmap documentation: tinyurl.com/hnbw8t5
+memory_map::memory_map(const path& filename, mutex_ptr mutex, size_t expansion,
+    const mapping_policy& policy)
   : file_handle_(open_file(filename)),
     expansion_(expansion),
     filename_(filename),
+    policy_(policy),
     data_(nullptr),
+    reserved_(0),
     file_size_(file_size(file_handle_)),
     logical_size_(file_size_),
+    header_size_(0),
+    header_locked_(false),
     closed_(true),
-    remap_mutex_(mutex)
+    remap_mutex_(mutex),
+    tracking_(false),
+    page_size_(page()),
+    page_words_(0),
+    preallocation_(0),
+    preallocator_stopping_(false)
 {
+    BITCOIN_ASSERT(page_size_ != 0);
 }
 
 // Database threads must be joined before close is called (or destruct).
@@ -196,11 +277,14 @@ bool memory_map::open()
     // Initialize data_.
     if (!map(file_size_))
         error_name = "map";
-    else if (madvise(data_, 0, MADV_RANDOM) == FAIL)
+    else if (!advise())
         error_name = "madvise";
     else
         closed_ = false;
 
+    if (!closed_)
+        advise_header();
+
     mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
 
@@ -212,9 +296,12 @@ bool memory_map::open()
     return true;
 }
 
+// Write back the written pages, and only those pages, to disk.
 bool memory_map::flush() const
 {
+    size_t bytes = 0;
     std::string error_name;
+    const auto start = std::chrono::steady_clock::now();
 
     // Critical Section (internal/unconditional)
     ///////////////////////////////////////////////////////////////////////////
@@ -230,8 +317,8 @@ bool memory_map::flush() const
     mutex_.unlock_upgrade_and_lock();
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    if (msync(data_, logical_size_, MS_SYNC) == FAIL)
-        error_name = "flush";
+    if (!flush_pages(bytes))
+        error_name = "msync";
 
     mutex_.unlock();
     ///////////////////////////////////////////////////////////////////////////
@@ -240,7 +327,9 @@ bool memory_map::flush() const
     if (!error_name.empty())
         return handle_error(error_name, filename_);
 
-    log_flushed();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    log_flushed(bytes, std::chrono::duration_cast<std::chrono::milliseconds>(
+        elapsed).count());
     return true;
 }
 
@@ -267,10 +356,15 @@ bool memory_map::close()
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
     closed_ = true;
+    header_locked_ = false;
+    stop_preallocation();
+    size_t bytes;
+    const auto resident = resident_pages() * page_size_;
 
-    if (msync(data_, logical_size_, MS_SYNC) == FAIL)
+    // The fsync is the barrier for the truncation.
+    if (!flush_pages(bytes))
         error_name = "msync";
-    else if (munmap(data_, file_size_) == FAIL)
+    else if (munmap(data_, mapping_size()) == FAIL)
         error_name = "munmap";
     else if (ftruncate(file_handle_, logical_size_) == FAIL)
         error_name = "ftruncate";
@@ -286,7 +380,7 @@ bool memory_map::close()
     if (!error_name.empty())
         return handle_error(error_name, filename_);
 
-    log_unmapped();
+    log_unmapped(resident);
     return true;
 }
 
@@ -351,9 +445,32 @@ memory_ptr memory_map::reserve(size_t size, size_t expansion)
 
     if (size > file_size_)
     {
+        // This includes the wait for readers to release a remapped file.
+        const histogram::timer timer(resizes());
+
         // TODO: manage overflow (requires ceiling_multiply).
         // Expansion is an integral number that represents a real number factor.
-        const size_t target = size * ((expansion + 100.0) / 100.0);
+        size_t target = size * ((expansion + 100.0) / 100.0);
+
+        // Growth in whole chunks limits fragmentation of the file.
+        const auto chunk = policy_.allocation_chunk;
+        if (chunk != 0)
+            target = ((target + chunk - 1) / chunk) * chunk;
+
+        // Growth within the reservation does not move data_, so readers are
+        // not excluded. The upgrade lock excludes other writers.
+        if (page_ceiling(target) <= reserved_)
+        {
+            if (!truncate_reserved(target))
+            {
+                handle_error("resize", filename_);
+                throw std::runtime_error("Resize failure, disk space may be low.");
+            }
+
+            logical_size_ = size;
+            REMAP_ASSIGN(memory, data_);
+            return memory;
+        }
 
         mutex_.unlock_upgrade_and_lock();
         //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -378,9 +495,275 @@ memory_ptr memory_map::reserve(size_t size, size_t expansion)
     ///////////////////////////////////////////////////////////////////////////
 }
 
+const memory_map::path& memory_map::filename() const
+{
+    return filename_;
+}
+
+void memory_map::advise_header(size_t size)
+{
+    // Critical Section (internal)
+    ///////////////////////////////////////////////////////////////////////////
+    mutex_.lock();
+
+    if (!closed_ && size != header_size_)
+    {
+        if (header_locked_)
+            munlock(data_, std::min<size_t>(header_size_, file_size_));
+
+        header_locked_ = false;
+        header_size_ = size;
+        advise_header();
+    }
+
+    mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t memory_map::resident() const
+{
+    // Critical Section (internal)
+    ///////////////////////////////////////////////////////////////////////////
+    REMAP_READ(mutex_);
+
+    return closed_ ? 0 : resident_pages() * page_size_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Written ranges.
+// ----------------------------------------------------------------------------
+
+void memory_map::track(bool enable)
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(dirty_mutex_);
+
+    dirty_.clear();
+    tracking_ = enable;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void memory_map::dirty(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+
+    const auto first = offset / page_size_;
+    const auto last = (offset + size - 1) / page_size_;
+    BITCOIN_ASSERT(last / 64 < page_words_);
+
+    // The held accessor prevents a resize of the bitmap. A set bit is not
+    // written again, which avoids contention on the words of hot pages.
+    for (auto page = first; page <= last; ++page)
+    {
+        auto& word = pages_[page / 64];
+        const auto bit = uint64_t(1) << (page % 64);
+
+        if ((word.load(std::memory_order_relaxed) & bit) == 0)
+            word.fetch_or(bit, std::memory_order_release);
+    }
+
+    if (!tracking_)
+        return;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    unique_lock lock(dirty_mutex_);
+
+    // Sequential writes (allocations) are extended in place.
+    if (!dirty_.empty() && dirty_.back().first + dirty_.back().second ==
+        offset)
+    {
+        dirty_.back().second += size;
+        return;
+    }
+
+    dirty_.emplace_back(offset, size);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// The held accessor prevents a remap, so data_ is stable.
+void memory_map::dirty(const uint8_t* address, size_t size)
+{
+    BITCOIN_ASSERT(address >= data_);
+    dirty(static_cast<size_t>(address - data_), size);
+}
+
+memory_map::ranges memory_map::take_dirty()
+{
+    ranges taken;
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    dirty_mutex_.lock();
+    std::swap(taken, dirty_);
+    dirty_mutex_.unlock();
+    ///////////////////////////////////////////////////////////////////////////
+
+    if (taken.empty())
+        return taken;
+
+    std::sort(taken.begin(), taken.end());
+
+    // Merge overlapping and adjacent ranges.
+    ranges merged{ taken.front() };
+
+    for (auto it = std::next(taken.begin()); it != taken.end(); ++it)
+    {
+        auto& last = merged.back();
+        const auto end = last.first + last.second;
+
+        if (it->first > end)
+        {
+            merged.push_back(*it);
+            continue;
+        }
+
+        last.second = std::max(end, it->first + it->second) - last.first;
+    }
+
+    return merged;
+}
+
 // privates
 // ----------------------------------------------------------------------------
 
+// Hints other than the access advice are best effort.
+bool memory_map::advise()
+{
+    auto advice = MADV_RANDOM;
+
+    switch (policy_.advice)
+    {
+        case mapping_policy::access::normal:
+            advice = MADV_NORMAL;
+            break;
+        case mapping_policy::access::sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case mapping_policy::access::random:
+            break;
+    }
+
+    if (madvise(data_, file_size_, advice) == FAIL)
+        return false;
+
+#ifdef MADV_HUGEPAGE
+    if (policy_.huge_pages)
+        madvise(data_, file_size_, MADV_HUGEPAGE);
+#endif
+
+    if (policy_.interleave)
+        interleave(data_, file_size_);
+
+    return true;
+}
+
+// The header hints are best effort, a failed lock is retried on remap.
+void memory_map::advise_header()
+{
+    const auto size = std::min<size_t>(header_size_, file_size_);
+
+    if (size == 0)
+        return;
+
+    if (policy_.populate_header)
+    {
+#ifdef MADV_POPULATE_READ
+        madvise(data_, size, MADV_POPULATE_READ);
+#else
+        madvise(data_, size, MADV_WILLNEED);
+#endif
+    }
+
+    if (policy_.lock_header && !header_locked_)
+        header_locked_ = (mlock(data_, size) != FAIL);
+}
+
+size_t memory_map::resident_pages() const
+{
+#ifdef __linux__
+    if (data_ == nullptr || file_size_ == 0)
+        return 0;
+
+    std::vector<unsigned char> pages((file_size_ + page_size_ - 1) /
+        page_size_);
+
+    if (mincore(data_, file_size_, pages.data()) == FAIL)
+        return 0;
+
+    return std::count_if(pages.begin(), pages.end(), [](unsigned char page)
+    {
+        return (page & 1) != 0;
+    });
+#else
+    return 0;
+#endif
+}
+
+// Write back each run of written pages, and clear the pages. Each run is
+// synchronous, so no fsync of the file is required.
+// The mapping must be held open (or closed) by the caller.
+bool memory_map::flush_pages(size_t& out_bytes) const
+{
+    out_bytes = 0;
+    size_t run = 0;
+    size_t end = 0;
+
+    // Pages beyond the mapping are not yet backed by the file.
+    const auto sync = [&]()
+    {
+        const auto offset = run * page_size_;
+        const auto size = std::min((end - run) * page_size_,
+            file_size_ > offset ? file_size_ - offset : 0);
+
+        if (size != 0 && msync(data_ + offset, size, MS_SYNC) == FAIL)
+            return false;
+
+        out_bytes += size;
+        return true;
+    };
+
+    const auto pages = (file_size_ + page_size_ - 1) / page_size_;
+    const auto words = std::min(page_words_, (pages + 63) / 64);
+
+    for (size_t index = 0; index < words; ++index)
+    {
+        auto& word = pages_[index];
+
+        // Skip clean words without writing them.
+        const auto value = word.load(std::memory_order_relaxed) == 0 ? 0 :
+            word.exchange(0, std::memory_order_acquire);
+
+        if (value == 0 && end == run)
+            continue;
+
+        for (size_t bit = 0; bit < 64; ++bit)
+        {
+            const auto page = index * 64 + bit;
+
+            // Extend the run to the next clean page.
+            if ((value & (uint64_t(1) << bit)) != 0)
+            {
+                if (end != page)
+                    run = page;
+
+                end = page + 1;
+            }
+            else if (end == page && end != run)
+            {
+                if (!sync())
+                    return false;
+
+                run = end;
+            }
+        }
+    }
+
+    return end == run || sync();
+}
+
 size_t memory_map::page() const
 {
 #ifdef _WIN32
@@ -400,10 +783,22 @@ size_t memory_map::page() const
 #endif
 }
 
+size_t memory_map::page_ceiling(size_t size) const
+{
+    return ((size + page_size_ - 1) / page_size_) * page_size_;
+}
+
+// The reservation is unmapped with the file mapping that it contains.
+size_t memory_map::mapping_size() const
+{
+    return reserved_ == 0 ? file_size_.load() : reserved_;
+}
+
 bool memory_map::unmap()
 {
-    const auto success = (munmap(data_, file_size_) != FAIL);
+    const auto success = (munmap(data_, mapping_size()) != FAIL);
     file_size_ = 0;
+    reserved_ = 0;
     data_ = nullptr;
     return success;
 }
@@ -413,14 +808,73 @@ bool memory_map::map(size_t size)
     if (size == 0)
         return false;
 
+    // The reservation is an optimization, so a failure falls back to mmap.
+    if (policy_.reservation != 0 && reserve_map(size))
+        return true;
+
     data_ = reinterpret_cast<uint8_t*>(mmap(0, size, PROT_READ | PROT_WRITE,
         MAP_SHARED, file_handle_, 0));
 
     return validate(size);
 }
 
+// Reserve inaccessible address space and map the file over its start.
+// The reservation is at least double the size so that a remap beyond it is
+// followed by proportionally more growth in place.
+bool memory_map::reserve_map(size_t size)
+{
+#ifdef _WIN32
+    return false;
+#else
+    const auto reservation = page_ceiling(std::max(policy_.reservation,
+        2 * size));
+
+    const auto base = mmap(0, reservation, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, INVALID_HANDLE, 0);
+
+    if (base == MAP_FAILED)
+        return false;
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+        file_handle_, 0) == MAP_FAILED)
+    {
+        munmap(base, reservation);
+        return false;
+    }
+
+    data_ = reinterpret_cast<uint8_t*>(base);
+    reserved_ = reservation;
+    return validate(size);
+#endif
+}
+
+// Map the file pages beyond the current mapping over the reservation. The
+// mapped pages are not replaced, so readers of them are unaffected.
+bool memory_map::extend_map(size_t size)
+{
+#ifdef _WIN32
+    return false;
+#else
+    const auto mapped = page_ceiling(file_size_);
+    const auto target = page_ceiling(size);
+    BITCOIN_ASSERT(target <= reserved_);
+
+    if (target > mapped && mmap(data_ + mapped, target - mapped,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file_handle_,
+        mapped) == MAP_FAILED)
+        return false;
+
+    file_size_ = size;
+    return true;
+#endif
+}
+
 bool memory_map::remap(size_t size)
 {
+    // A reservation is replaced, as it cannot be extended in place.
+    if (reserved_ != 0)
+        return unmap() && map(size);
+
 #ifdef MREMAP_MAYMOVE
     data_ = reinterpret_cast<uint8_t*>(mremap(data_, file_size_, size,
         MREMAP_MAYMOVE));
@@ -431,11 +885,110 @@ bool memory_map::remap(size_t size)
 #endif
 }
 
+// Allocated growth avoids a block allocation fault on the first write to
+// each new page. Shrinking, or an unsupported file system, uses ftruncate.
 bool memory_map::truncate(size_t size)
 {
+    join_preallocation();
+
+#ifdef __linux__
+    const auto chunk = policy_.allocation_chunk;
+    const auto current = file_size(file_handle_);
+
+    if (chunk != 0 && size > current)
+    {
+        if (fallocate(file_handle_, 0, current, size - current) != FAIL)
+        {
+            preallocate(size);
+            return true;
+        }
+
+        if (errno != EOPNOTSUPP)
+            return false;
+    }
+#endif
+
     return ftruncate(file_handle_, size) != FAIL;
 }
 
+// Allocate the next chunk beyond the end of the file without changing its
+// size, so that the next growth only has to extend the size. The growth has
+// joined any previous allocation, so at most one is outstanding.
+void memory_map::preallocate(size_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    BITCOIN_ASSERT(size != 0);
+
+    {
+        std::lock_guard<std::mutex> lock(preallocation_mutex_);
+
+        if (!preallocator_.joinable())
+            preallocator_ = std::thread(&memory_map::preallocator, this);
+
+        preallocation_ = size;
+    }
+
+    preallocation_condition_.notify_all();
+#endif
+}
+
+// The worker of the map, which allocates each requested chunk in turn.
+void memory_map::preallocator()
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    std::unique_lock<std::mutex> lock(preallocation_mutex_);
+
+    while (true)
+    {
+        preallocation_condition_.wait(lock, [this]()
+        {
+            return preallocator_stopping_ || preallocation_ != 0;
+        });
+
+        if (preallocation_ == 0)
+            return;
+
+        const auto size = preallocation_;
+        lock.unlock();
+
+        // This is best effort, a failure is handled by the next growth.
+        fallocate(file_handle_, FALLOC_FL_KEEP_SIZE, size,
+            policy_.allocation_chunk);
+
+        lock.lock();
+        preallocation_ = 0;
+        preallocation_condition_.notify_all();
+    }
+#endif
+}
+
+// The preallocation is normally complete well before the next growth.
+void memory_map::join_preallocation()
+{
+    std::unique_lock<std::mutex> lock(preallocation_mutex_);
+    preallocation_condition_.wait(lock, [this]()
+    {
+        return preallocation_ == 0;
+    });
+}
+
+// The worker completes an outstanding allocation before it stops, and is
+// started again by the first request after a reopen.
+void memory_map::stop_preallocation()
+{
+    {
+        std::lock_guard<std::mutex> lock(preallocation_mutex_);
+        preallocator_stopping_ = true;
+    }
+
+    preallocation_condition_.notify_all();
+
+    if (preallocator_.joinable())
+        preallocator_.join();
+
+    preallocator_stopping_ = false;
+}
+
 bool memory_map::truncate_mapped(size_t size)
 {
     log_resizing(size);
@@ -444,6 +997,12 @@ bool memory_map::truncate_mapped(size_t size)
     ///////////////////////////////////////////////////////////////////////////
     conditional_lock lock(remap_mutex_);
 
+    // A locked header splits the mapping, which would prevent its remap.
+    if (header_locked_)
+        munlock(data_, std::min<size_t>(header_size_, file_size_));
+
+    header_locked_ = false;
+
 #ifndef MREMAP_MAYMOVE
     if (!unmap())
         return false;
@@ -453,10 +1012,35 @@ bool memory_map::truncate_mapped(size_t size)
         return false;
 
 #ifndef MREMAP_MAYMOVE
-    return map(size);
+    if (!map(size))
+        return false;
 #else
-    return remap(size);
+    if (!remap(size))
+        return false;
 #endif
+
+    if (!advise())
+        return false;
+
+    advise_header();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Called with the upgrade lock, readers may hold the mutex.
+bool memory_map::truncate_reserved(size_t size)
+{
+    log_resizing(size);
+
+    // Critical Section (conditional/external)
+    ///////////////////////////////////////////////////////////////////////////
+    conditional_lock lock(remap_mutex_);
+
+    if (!truncate(size) || !extend_map(size))
+        return false;
+
+    // The header hints are unaffected as the header is not remapped.
+    return advise();
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -470,8 +1054,30 @@ bool memory_map::validate(size_t size)
     }
 
     file_size_ = size;
+    size_pages();
     return true;
 }
 
+// Called with the exclusive lock, so there are no writers of the bitmap.
+void memory_map::size_pages()
+{
+    const auto pages = (mapping_size() + page_size_ - 1) / page_size_;
+    const auto words = (pages + 63) / 64;
+
+    if (words <= page_words_)
+        return;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> resized(
+        new std::atomic<uint64_t>[words]);
+
+    for (size_t index = 0; index < words; ++index)
+        resized[index].store(index < page_words_ ?
+            pages_[index].load(std::memory_order_relaxed) : 0,
+            std::memory_order_relaxed);
+
+    pages_.swap(resized);
+    page_words_ = words;
+}
+
 } // namespace database
 } // namespace libbitcoin
@@ -36,7 +36,10 @@ extern "C" {
 #define MS_INVALIDATE   4
 
 /* Flags for madvise (stub). */
+#define MADV_NORMAL     0
 #define MADV_RANDOM     0
+#define MADV_SEQUENTIAL 0
+#define MADV_WILLNEED   0
 
 void* mmap(void* addr, size_t len, int prot, int flags, int fildes, oft__ off);
 int munmap(void* addr, size_t len);
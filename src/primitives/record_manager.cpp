@@ -130,7 +130,9 @@ array_index record_manager::new_records(size_t count)
 
     const size_t position = record_to_position(record_count_ + count);
     const size_t required_size = header_size_ + position;
-    file_.reserve(required_size);
+    const auto memory = file_.reserve(required_size);
+    file_.dirty(header_size_ + record_to_position(record_count_),
+        count * record_size_);
     record_count_ += count;
 
     return next_record_index;
@@ -148,6 +150,21 @@ const memory_ptr record_manager::get(array_index record) const
     return memory;
 }
 
+file_offset record_manager::offset(array_index record) const
+{
+    return header_size_ + record_to_position(record);
+}
+
+size_t record_manager::record_size() const
+{
+    return record_size_;
+}
+
+void record_manager::dirty(const uint8_t* address, size_t size) const
+{
+    file_.dirty(address, size);
+}
+
 // privates
 
 // Read the count value from the first 32 bits of the file after the header.
@@ -171,6 +188,7 @@ void record_manager::write_count()
     auto payload_size_address = REMAP_ADDRESS(memory) + header_size_;
     auto serial = make_unsafe_serializer(payload_size_address);
     serial.write_little_endian(record_count_);
+    file_.dirty(header_size_, sizeof(array_index));
 }
 
 array_index record_manager::position_to_record(file_offset position) const
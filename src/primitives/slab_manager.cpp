@@ -64,7 +64,7 @@ bool slab_manager::create()
     // This currently throws if there is insufficient space.
     file_.resize(header_size_ + payload_size_);
 
-    write_size();
+    write_size(payload_size_);
     return true;
     ///////////////////////////////////////////////////////////////////////////
 }
@@ -89,11 +89,21 @@ void slab_manager::sync() const
     ///////////////////////////////////////////////////////////////////////////
     ALLOCATE_WRITE(mutex_);
 
-    write_size();
+    write_size(payload_size_);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void slab_manager::sync(file_offset payload_size) const
+{
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    ALLOCATE_WRITE(mutex_);
+
+    BITCOIN_ASSERT(payload_size <= payload_size_);
+    write_size(payload_size);
     ///////////////////////////////////////////////////////////////////////////
 }
 
-// protected
 file_offset slab_manager::payload_size() const
 {
     // Critical Section
@@ -116,7 +126,8 @@ file_offset slab_manager::new_slab(size_t size)
     const auto next_slab_position = payload_size_;
 
     const size_t required_size = header_size_ + payload_size_ + size;
-    file_.reserve(required_size);
+    const auto memory = file_.reserve(required_size);
+    file_.dirty(header_size_ + payload_size_, size);
     payload_size_ += size;
 
     return next_slab_position;
@@ -135,6 +146,16 @@ const memory_ptr slab_manager::get(file_offset position) const
     return memory;
 }
 
+file_offset slab_manager::offset(file_offset position) const
+{
+    return header_size_ + position;
+}
+
+void slab_manager::dirty(const uint8_t* address, size_t size) const
+{
+    file_.dirty(address, size);
+}
+
 // privates
 
 // Read the size value from the first 64 bits of the file after the header.
@@ -150,7 +171,7 @@ void slab_manager::read_size()
 }
 
 // Write the size value to the first 64 bits of the file after the header.
-void slab_manager::write_size() const
+void slab_manager::write_size(file_offset payload_size) const
 {
     BITCOIN_ASSERT(header_size_ + sizeof(file_offset) <= file_.size());
 
@@ -158,7 +179,8 @@ void slab_manager::write_size() const
     const auto memory = file_.access();
     const auto payload_size_address = REMAP_ADDRESS(memory) + header_size_;
     auto serial = make_unsafe_serializer(payload_size_address);
-    serial.write_little_endian(payload_size_);
+    serial.write_little_endian(payload_size);
+    file_.dirty(header_size_, sizeof(file_offset));
 }
 
 } // namespace database
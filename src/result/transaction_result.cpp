@@ -30,11 +30,79 @@ namespace database {
 
 using namespace bc::chain;
 
-static constexpr size_t value_size = sizeof(uint64_t);
 static constexpr size_t height_size = sizeof(uint32_t);
 static constexpr size_t version_size = sizeof(uint32_t);
 static constexpr size_t locktime_size = sizeof(uint32_t);
 static constexpr size_t position_size = sizeof(uint32_t);
+static constexpr size_t count_size = sizeof(uint32_t);
+static constexpr size_t offset_size = sizeof(uint32_t);
+static constexpr size_t offsets_start = height_size + position_size;
+static constexpr size_t version_lock_size = version_size + locktime_size;
+static constexpr size_t spender_height_size = sizeof(uint32_t);
+static constexpr size_t value_size = sizeof(uint64_t);
+static constexpr size_t point_size = hash_size + sizeof(uint32_t);
+static constexpr size_t sequence_size = sizeof(uint32_t);
+
+size_t transaction_result::offsets_size(const chain::transaction& tx)
+{
+    return count_size + tx.outputs().size() * offset_size;
+}
+
+// The offsets are relative to the start of the transaction, and each locates
+// the spender height word that leads the output.
+void transaction_result::write_offsets(serializer<uint8_t*>& serial,
+    const chain::transaction& tx)
+{
+    const auto& outputs = tx.outputs();
+    auto offset = version_lock_size +
+        message::variable_uint_size(outputs.size());
+
+    BITCOIN_ASSERT(outputs.size() <= max_uint32);
+    serial.write_4_bytes_little_endian(static_cast<uint32_t>(outputs.size()));
+
+    for (const auto& output: outputs)
+    {
+        BITCOIN_ASSERT(offset <= max_uint32);
+        serial.write_4_bytes_little_endian(static_cast<uint32_t>(offset));
+        offset += output.serialized_size(false);
+    }
+}
+
+// Returns nullptr if the index is not in the transaction.
+uint8_t* transaction_result::output_address(uint8_t* memory, uint32_t index)
+{
+    const auto offsets = memory + offsets_start;
+    const auto outputs = from_little_endian_unsafe<uint32_t>(offsets);
+
+    if (index >= outputs)
+        return nullptr;
+
+    const auto table = offsets + count_size;
+    const auto tx_start = table + outputs * offset_size;
+    return tx_start + from_little_endian_unsafe<uint32_t>(
+        table + index * offset_size);
+}
+
+// The stored transaction is [locktime][version][outputs][inputs], so the
+// inputs follow the last output.
+uint8_t* transaction_result::inputs_address(uint8_t* memory)
+{
+    const auto offsets = memory + offsets_start;
+    const auto outputs = from_little_endian_unsafe<uint32_t>(offsets);
+
+    if (outputs == 0)
+    {
+        const auto tx_start = offsets + count_size;
+        return tx_start + version_lock_size + message::variable_uint_size(0);
+    }
+
+    // Skip the last output, [spender height:4][value:8][script].
+    const auto last = output_address(memory, outputs - 1);
+    const auto script = last + spender_height_size + value_size;
+    auto deserial = make_unsafe_deserializer(script);
+    const auto script_size = deserial.read_size_little_endian();
+    return script + message::variable_uint_size(script_size) + script_size;
+}
 
 transaction_result::transaction_result(const memory_ptr slab)
   : slab_(slab), hash_(null_hash)
@@ -88,31 +156,27 @@ bool transaction_result::is_spent(size_t fork_height) const
 
     BITCOIN_ASSERT(slab_);
     const auto memory = REMAP_ADDRESS(slab_);
-    const auto position_start = memory + height_size;
-    auto deserial = make_unsafe_deserializer(position_start);
-    const auto position = deserial.read_4_bytes_little_endian();
 
     // Cannot be spent if unconfirmed.
-    if (position == transaction_database::unconfirmed)
+    if (position() == transaction_database::unconfirmed)
         return false;
 
-    deserial.skip(version_size + locktime_size);
-    const auto outputs = deserial.read_size_little_endian();
-    BITCOIN_ASSERT(deserial);
+    const auto offsets = memory + offsets_start;
+    const auto outputs = from_little_endian_unsafe<uint32_t>(offsets);
+    const auto table = offsets + count_size;
+    const auto tx_start = table + outputs * offset_size;
 
     // Search all outputs for an unspent indication.
     for (uint32_t output = 0; output < outputs; ++output)
     {
-        const auto spender_height = deserial.read_4_bytes_little_endian();
-        BITCOIN_ASSERT(deserial);
+        const auto offset = from_little_endian_unsafe<uint32_t>(
+            table + output * offset_size);
+        const auto spender_height = from_little_endian_unsafe<uint32_t>(
+            tx_start + offset);
 
         // A spend from above the fork height is not an actual spend.
         if (spender_height == not_spent || spender_height > fork_height)
             return false;
-
-        deserial.skip(value_size);
-        deserial.skip(deserial.read_size_little_endian());
-        BITCOIN_ASSERT(deserial);
     }
 
     return true;
@@ -122,35 +186,114 @@ bool transaction_result::is_spent(size_t fork_height) const
 chain::output transaction_result::output(uint32_t index) const
 {
     BITCOIN_ASSERT(slab_);
-    const auto memory = REMAP_ADDRESS(slab_);
-    const auto outputs_start = memory + height_size + position_size +
-        version_size + locktime_size;
-    auto deserial = make_unsafe_deserializer(outputs_start);
-    const auto outputs = deserial.read_size_little_endian();
-    BITCOIN_ASSERT(deserial);
+    const auto address = output_address(REMAP_ADDRESS(slab_), index);
 
-    if (index >= outputs)
+    if (address == nullptr)
         return{};
 
-    // Skip outputs until the target output.
-    for (uint32_t output = 0; output < index; ++output)
-    {
-        deserial.skip(height_size + value_size);
-        deserial.skip(deserial.read_size_little_endian());
-        BITCOIN_ASSERT(deserial);
-    }
-
     // Read and return the target output (including spender height).
+    auto deserial = make_unsafe_deserializer(address);
     chain::output out;
     out.from_data(deserial, false);
     return out;
 }
 
+chain::output::list transaction_result::outputs() const
+{
+    BITCOIN_ASSERT(slab_);
+    const auto memory = REMAP_ADDRESS(slab_);
+    const auto offsets = memory + offsets_start;
+    const auto count = from_little_endian_unsafe<uint32_t>(offsets);
+
+    // The outputs are contiguous, [spender height:4][value:8][script].
+    chain::output::list outputs(count);
+
+    if (count == 0)
+        return outputs;
+
+    auto deserial = make_unsafe_deserializer(output_address(memory, 0));
+
+    for (auto& output: outputs)
+        output.from_data(deserial, false);
+
+    return outputs;
+}
+
+chain::input::list transaction_result::inputs() const
+{
+    BITCOIN_ASSERT(slab_);
+    auto deserial = make_unsafe_deserializer(inputs_address(
+        REMAP_ADDRESS(slab_)));
+
+    chain::input::list inputs(deserial.read_size_little_endian());
+
+    for (auto& input: inputs)
+        input.from_data(deserial, false);
+
+    return inputs;
+}
+
+chain::output_point::list transaction_result::previous_outputs() const
+{
+    BITCOIN_ASSERT(slab_);
+    auto deserial = make_unsafe_deserializer(inputs_address(
+        REMAP_ADDRESS(slab_)));
+
+    const auto count = deserial.read_size_little_endian();
+    chain::output_point::list points;
+    points.reserve(count);
+
+    for (size_t input = 0; input < count; ++input)
+    {
+        auto hash = deserial.read_hash();
+        const auto index = deserial.read_4_bytes_little_endian();
+        points.emplace_back(std::move(hash), index);
+
+        // Skip the script and sequence.
+        deserial.skip(deserial.read_size_little_endian());
+        deserial.skip(sequence_size);
+    }
+
+    return points;
+}
+
+size_t transaction_result::body_size() const
+{
+    BITCOIN_ASSERT(slab_);
+    const auto memory = REMAP_ADDRESS(slab_);
+    const auto inputs = inputs_address(memory);
+    auto deserial = make_unsafe_deserializer(inputs);
+
+    const auto count = deserial.read_size_little_endian();
+    size_t size = message::variable_uint_size(count);
+
+    for (size_t input = 0; input < count; ++input)
+    {
+        deserial.skip(point_size);
+        const auto script_size = deserial.read_size_little_endian();
+        deserial.skip(script_size + sequence_size);
+        size += point_size + message::variable_uint_size(script_size) +
+            script_size + sequence_size;
+    }
+
+    return static_cast<size_t>(inputs - (memory + offsets_start)) + size;
+}
+
+void transaction_result::write_body(serializer<uint8_t*>& serial,
+    size_t size) const
+{
+    BITCOIN_ASSERT(slab_);
+    const auto memory = REMAP_ADDRESS(slab_);
+    serial.write_bytes(memory + offsets_start, size);
+}
+
 chain::transaction transaction_result::transaction() const
 {
     BITCOIN_ASSERT(slab_);
     const auto memory = REMAP_ADDRESS(slab_);
-    const auto tx_start = memory + height_size + position_size;
+    const auto offsets = memory + offsets_start;
+    const auto outputs = from_little_endian_unsafe<uint32_t>(offsets);
+    const auto tx_start = offsets + count_size + outputs * offset_size;
     auto deserial = make_unsafe_deserializer(tx_start);
 
     // READ THE TX
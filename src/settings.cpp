@@ -28,6 +28,10 @@ using namespace boost::filesystem;
 settings::settings()
   : directory("blockchain"),
     flush_writes(false),
+
+    // Writes journaled between flushes of the files (0 flushes each write).
+    flush_journal_interval(0),
+
     file_growth_rate(50),
     index_start_height(0),
 
@@ -37,7 +41,18 @@ settings::settings()
     transaction_unconfirmed_table_buckets(0),
     spend_table_buckets(0),
     history_table_buckets(0),
-    cache_capacity(0)
+
+    // Hash table collision strategy (must match the store).
+    transaction_table_open_addressing(false),
+    transaction_unconfirmed_table_open_addressing(false),
+
+    // Keys per hundred buckets above which tables are resized (0 disables).
+    hash_table_max_load(0),
+
+    // Unspent output cache limits (0 disables), and bytes (0 is unlimited).
+    cache_capacity(0),
+    cache_budget(0),
+    cache_policy(eviction_policy::fifo)
 {}
 
 settings::settings(config::settings context)
@@ -39,6 +39,8 @@ using namespace bc::database;
 #define HISTORY_TABLE "history_table"
 #define HISTORY_ROWS "history_rows"
 #define STEALTH_ROWS "stealth_rows"
+#define CACHE_SNAPSHOT "cache_snapshot"
+#define WRITE_JOURNAL "write_journal"
 
 // The threashold max_uint32 is used to align with fixed-width config settings,
 // and size_t is used to align with the database height domain.
@@ -76,7 +78,13 @@ store::store(const path& prefix, bool with_indexes, bool flush_each_write)
     spend_table(prefix / SPEND_TABLE),
     history_table(prefix / HISTORY_TABLE),
     history_rows(prefix / HISTORY_ROWS),
-    stealth_rows(prefix / STEALTH_ROWS)
+    stealth_rows(prefix / STEALTH_ROWS),
+
+    // Optional cache snapshot.
+    cache_snapshot(prefix / CACHE_SNAPSHOT),
+
+    // Optional write journal.
+    write_journal(prefix / WRITE_JOURNAL)
 {
 }
 
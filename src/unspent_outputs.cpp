@@ -18,7 +18,12 @@
  */
 #include <bitcoin/database/unspent_outputs.hpp>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <boost/bimap/support/lambda.hpp>
+#include <boost/filesystem.hpp>
 #include <bitcoin/bitcoin.hpp>
 
 namespace libbitcoin {
@@ -26,10 +31,55 @@ namespace database {
 
 using namespace bc::chain;
 
+const size_t unspent_outputs::max_shards = 16;
+
+// An entry larger than this fraction of its shard's budget is not admitted, so
+// that a huge transaction does not flush the shard.
+static constexpr size_t admission_divisor = 4;
+
+// Approximate bimap node and bucket overhead of an entry.
+static constexpr size_t entry_overhead = 6 * sizeof(void*);
+
+static size_t output_bytes(const output& output)
+{
+    return sizeof(unspent_transaction::output_map::value_type) +
+        output.script().serialized_size(false);
+}
+
+static size_t entry_bytes(const unspent_transaction& unspent)
+{
+    auto bytes = sizeof(unspent_transaction) + sizeof(uint64_t) +
+        entry_overhead;
+    size_t position = 0;
+
+    // Removed outputs were deducted as they were removed.
+    for (const auto& output: *unspent.outputs())
+        if (!unspent.removed(position++))
+            bytes += output_bytes(output.second);
+
+    return bytes;
+}
+
+unspent_outputs::shard::shard(size_t capacity, size_t budget)
+  : capacity(capacity), budget(budget), hits(0), queries(0), evictions(0),
+    sequence(0), bytes(0)
+{
+}
+
 // Because of BIP30 it is safe to use tx hashes as identifiers here.
-unspent_outputs::unspent_outputs(size_t capacity)
-  : capacity_(capacity), hits_(1), queries_(1), sequence_(0)
+// The capacity and budget are divided among the shards, so the totals are
+// unchanged.
+unspent_outputs::unspent_outputs(size_t capacity, size_t budget,
+    eviction_policy policy)
+  : capacity_(capacity), policy_(policy)
 {
+    const auto count = std::max(std::min(capacity, max_shards), size_t(1));
+    shards_.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+        shards_.emplace_back(new shard(
+            capacity / count + (index < capacity % count ? 1 : 0),
+            budget / count + (index < budget % count ? 1 : 0)));
 }
 
 bool unspent_outputs::disabled() const
@@ -39,28 +89,137 @@ bool unspent_outputs::disabled() const
 
 size_t unspent_outputs::empty() const
 {
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    shared_lock lock(mutex_);
-
-    return unspent_.empty();
-    ///////////////////////////////////////////////////////////////////////////
+    return size() == 0;
 }
 
 size_t unspent_outputs::size() const
 {
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    shared_lock lock(mutex_);
+    size_t total = 0;
 
-    return unspent_.size();
-    ///////////////////////////////////////////////////////////////////////////
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard->mutex);
+
+        total += shard->unspent.size();
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return total;
+}
+
+size_t unspent_outputs::bytes() const
+{
+    size_t total = 0;
+
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard->mutex);
+
+        total += shard->bytes;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    return total;
+}
+
+size_t unspent_outputs::evictions() const
+{
+    size_t total = 0;
+
+    for (const auto& shard: shards_)
+        total += shard->evictions;
+
+    return total;
 }
 
 float unspent_outputs::hit_rate() const
 {
-    // These values could overflow or divide by zero, but that's okay.
-    return hits_ * 1.0f / queries_;
+    // Both counts start at one, so that the rate is one before any access.
+    size_t hits = 1;
+    size_t queries = 1;
+
+    for (const auto& shard: shards_)
+    {
+        hits += shard->hits;
+        queries += shard->queries;
+    }
+
+    // These values could overflow, but that's okay.
+    return hits * 1.0f / queries;
+}
+
+size_t unspent_outputs::shards() const
+{
+    return shards_.size();
+}
+
+size_t unspent_outputs::hits(size_t shard) const
+{
+    return shards_[shard]->hits;
+}
+
+size_t unspent_outputs::queries(size_t shard) const
+{
+    return shards_[shard]->queries;
+}
+
+// Tx hashes are uniformly distributed, so their leading bytes select a shard.
+unspent_outputs::shard& unspent_outputs::select(
+    const hash_digest& tx_hash) const
+{
+    const auto value = from_little_endian_unsafe<uint64_t>(tx_hash.begin());
+    return *shards_[value % shards_.size()];
+}
+
+// The young coins policy orders by height, with unconfirmed transactions
+// above all confirmed heights, and then by sequence within a height.
+uint64_t unspent_outputs::order(shard& shard,
+    const unspent_transaction& unspent) const
+{
+    const uint64_t sequence = ++shard.sequence;
+
+    if (policy_ != eviction_policy::young)
+        return sequence;
+
+    const uint64_t height = unspent.is_confirmed() ?
+        std::min(unspent.height(), size_t(max_uint32 - 1)) : max_uint32;
+
+    return (height << 32) | sequence;
+}
+
+// Evict until there is room for an entry of the given size, the shard's mutex
+// must be exclusively held.
+void unspent_outputs::evict(shard& shard, size_t bytes)
+{
+    const auto full = [&shard, bytes]()
+    {
+        return shard.unspent.size() >= shard.capacity ||
+            (shard.budget != 0 && shard.bytes + bytes > shard.budget);
+    };
+
+    while (!shard.unspent.empty() && full())
+    {
+        const auto oldest = shard.unspent.right.begin();
+        const auto& unspent = oldest->second;
+
+        // The clock policy passes over (requeues) an entry read since it was
+        // last passed over. This terminates as each pass clears the flag.
+        if (policy_ == eviction_policy::clock && unspent.referenced())
+        {
+            unspent.set_referenced(false);
+            shard.unspent.right.modify_key(oldest,
+                boost::bimaps::_key = ++shard.sequence);
+            continue;
+        }
+
+        shard.bytes -= entry_bytes(unspent);
+        shard.unspent.right.erase(oldest);
+        ++shard.evictions;
+    }
 }
 
 void unspent_outputs::add(const transaction& transaction, size_t height,
@@ -69,23 +228,35 @@ void unspent_outputs::add(const transaction& transaction, size_t height,
     if (disabled() || transaction.outputs().empty())
         return;
 
+    insert(unspent_transaction{ transaction, height, confirmed });
+}
+
+void unspent_outputs::insert(unspent_transaction&& unspent)
+{
+    auto& shard = select(unspent.hash());
+    const auto bytes = entry_bytes(unspent);
+
+    if (shard.budget != 0 && bytes > shard.budget / admission_divisor)
+        return;
+
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
-    unique_lock lock(mutex_);
+    unique_lock lock(shard.mutex);
 
     // It's been a long time since the last restart (~16 years).
-    if (sequence_ == max_uint32)
-        unspent_.clear();
+    // The young coins policy orders by a 32 bit sequence.
+    if (shard.sequence >= max_uint32)
+    {
+        shard.unspent.clear();
+        shard.sequence = 0;
+        shard.bytes = 0;
+    }
 
-    // Remove the oldest entry if the buffer is at capacity.
-    if (unspent_.size() >= capacity_)
-        unspent_.right.erase(unspent_.right.begin());
+    evict(shard, bytes);
+    const auto key = order(shard, unspent);
 
-    unspent_.insert(
-    {
-        unspent_transaction{ transaction, height, confirmed },
-        ++sequence_
-    });
+    if (shard.unspent.insert({ std::move(unspent), key }).second)
+        shard.bytes += bytes;
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -97,26 +268,28 @@ void unspent_outputs::remove(const hash_digest& tx_hash)
         return;
 
     const unspent_transaction key{ tx_hash };
+    auto& shard = select(tx_hash);
 
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
-    mutex_.lock_upgrade();
+    shard.mutex.lock_upgrade();
 
     // Find the unspent tx entry.
-    const auto tx = unspent_.left.find(key);
+    const auto tx = shard.unspent.left.find(key);
 
-    if (tx == unspent_.left.end())
+    if (tx == shard.unspent.left.end())
     {
-        mutex_.unlock_upgrade();
+        shard.mutex.unlock_upgrade();
         //---------------------------------------------------------------------
         return;
     }
 
-    mutex_.unlock_upgrade_and_lock();
+    shard.mutex.unlock_upgrade_and_lock();
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    unspent_.left.erase(tx);
+    shard.bytes -= entry_bytes(tx->first);
+    shard.unspent.left.erase(tx);
 
-    mutex_.unlock();
+    shard.mutex.unlock();
     ///////////////////////////////////////////////////////////////////////////
 }
 
@@ -126,78 +299,168 @@ void unspent_outputs::remove(const output_point& point)
         return;
 
     const unspent_transaction key{ point };
+    auto& shard = select(point.hash());
 
     // Critical Section
     ///////////////////////////////////////////////////////////////////////////
-    mutex_.lock_upgrade();
+    shard.mutex.lock_upgrade();
 
     // Find the unspent tx entry that may contain the output.
-    auto tx = unspent_.left.find(key);
+    auto tx = shard.unspent.left.find(key);
 
-    if (tx == unspent_.left.end())
+    if (tx == shard.unspent.left.end())
     {
-        mutex_.unlock_upgrade();
+        shard.mutex.unlock_upgrade();
         //---------------------------------------------------------------------
         return;
     }
 
-    const auto outputs = tx->first.outputs();
-    mutex_.unlock_upgrade_and_lock();
+    const auto& unspent = tx->first;
+    shard.mutex.unlock_upgrade_and_lock();
     //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    // Erase the output if found at the specified index for the found tx.
-    outputs->erase(point.index());
+    // Remove the output if found at the specified index for the found tx.
+    const auto output = unspent.find(point.index());
+
+    if (output != nullptr)
+    {
+        shard.bytes -= output_bytes(*output);
+        unspent.remove(point.index());
+    }
 
     // Erase the unspent transaction if it is now fully spent.
-    if (outputs->empty())
-        unspent_.left.erase(tx);
+    if (unspent.size() == 0)
+    {
+        shard.bytes -= entry_bytes(tx->first);
+        shard.unspent.left.erase(tx);
+    }
 
-    mutex_.unlock();
+    shard.mutex.unlock();
     ///////////////////////////////////////////////////////////////////////////
 }
 
-bool unspent_outputs::get(output& out_output, size_t& out_height,
-    bool& out_coinbase, const output_point& point, size_t fork_height,
-    bool require_confirmed) const
+// Snapshot.
+// ----------------------------------------------------------------------------
+// [version:4][top height:4][top hash:32] followed by entries until the end:
+// [hash:32][height:4][flags:1][outputs:varint]([index:4][output])...
+
+static constexpr uint32_t snapshot_version = 1;
+static constexpr uint8_t coinbase_flag = 1 << 0;
+static constexpr uint8_t confirmed_flag = 1 << 1;
+
+bool unspent_outputs::save(const boost::filesystem::path& file,
+    const config::checkpoint& top) const
 {
     if (disabled())
-        return false;
+        return true;
 
-    ++queries_;
-    const unspent_transaction key{ point };
+    bc::ofstream stream(file.string(), std::ios::binary);
 
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    shared_lock lock(mutex_);
+    if (stream.bad())
+        return false;
 
-    // Find the unspent tx entry.
-    const auto tx = unspent_.left.find(key);
+    ostream_writer sink(stream);
+    sink.write_4_bytes_little_endian(snapshot_version);
+    sink.write_4_bytes_little_endian(safe_unsigned<uint32_t>(top.height()));
+    sink.write_hash(top.hash());
 
-    if (tx == unspent_.left.end() ||
-        (require_confirmed && !tx->first.is_confirmed()))
-        return false;
+    for (const auto& shard: shards_)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        shared_lock lock(shard->mutex);
+
+        for (const auto& entry: shard->unspent.right)
+        {
+            const auto& unspent = entry.second;
+            const auto outputs = unspent.outputs();
+            sink.write_hash(unspent.hash());
+            sink.write_4_bytes_little_endian(
+                static_cast<uint32_t>(unspent.height()));
+            sink.write_byte(
+                (unspent.is_coinbase() ? coinbase_flag : 0) |
+                (unspent.is_confirmed() ? confirmed_flag : 0));
+            sink.write_variable_little_endian(unspent.size());
+            size_t position = 0;
+
+            for (const auto& output: *outputs)
+            {
+                if (unspent.removed(position++))
+                    continue;
+
+                sink.write_4_bytes_little_endian(output.first);
+                output.second.to_data(sink);
+            }
+        }
+        ///////////////////////////////////////////////////////////////////////
+    }
 
-    // Find the output at the specified index for the found unspent tx.
-    const auto outputs = tx->first.outputs();
-    const auto output = outputs->find(point.index());
+    stream.flush();
+    return static_cast<bool>(sink);
+}
+
+bool unspent_outputs::load(const boost::filesystem::path& file,
+    const config::checkpoint& top)
+{
+    boost::system::error_code ec;
 
-    if (output == outputs->end())
+    if (disabled() || !boost::filesystem::exists(file, ec))
         return false;
 
-    // Determine if the cached unspent tx is above specified fork_height.
-    // Since the hash table does not allow duplicates there are no others.
-    const auto& unspent = tx->first;
-    const auto height = unspent.height();
+    bc::ifstream stream(file.string(), std::ios::binary);
+    istream_reader source(stream);
 
-    if (height > fork_height)
-        return false;
+    const auto loaded = [&]()
+    {
+        if (source.read_4_bytes_little_endian() != snapshot_version ||
+            source.read_4_bytes_little_endian() != top.height() ||
+            source.read_hash() != top.hash() || !source)
+            return false;
+
+        // Entries are added oldest first, which restores the age order.
+        while (!source.is_exhausted())
+        {
+            const auto hash = source.read_hash();
+            const size_t height = source.read_4_bytes_little_endian();
+            const auto flags = source.read_byte();
+            const auto count = source.read_variable_little_endian();
+            unspent_transaction::output_map outputs;
+
+            for (uint64_t output = 0; output < count && source; ++output)
+            {
+                const auto index = source.read_4_bytes_little_endian();
+                chain::output value;
+
+                if (!value.from_data(source))
+                    return false;
+
+                outputs.emplace_hint(outputs.end(), index, std::move(value));
+            }
+
+            // A truncated entry is dropped, those before it are consistent.
+            if (!source)
+                return false;
+
+            insert(unspent_transaction{ hash, height,
+                (flags & coinbase_flag) != 0, (flags & confirmed_flag) != 0,
+                std::move(outputs) });
+        }
+
+        return true;
+    }();
+
+    stream.close();
+    boost::filesystem::remove(file, ec);
+    return loaded;
+}
 
-    ++hits_;
-    out_height = height;
-    out_coinbase = unspent.is_coinbase();
-    out_output = output->second;
-    return true;
-    ///////////////////////////////////////////////////////////////////////////
+bool unspent_outputs::get(output& out_output, size_t& out_height,
+    bool& out_coinbase, const output_point& point, size_t fork_height,
+    bool require_confirmed) const
+{
+    bool confirmed;
+    return get_is_confirmed(out_output, out_height, out_coinbase, confirmed,
+        point, fork_height, require_confirmed);
 }
 
 bool unspent_outputs::get_is_confirmed(output& out_output, size_t& out_height, 
@@ -207,40 +470,69 @@ bool unspent_outputs::get_is_confirmed(output& out_output, size_t& out_height,
     if (disabled())
         return false;
 
-    ++queries_;
+    auto& shard = select(point.hash());
+    ++shard.queries;
     const unspent_transaction key{ point };
 
-    // Critical Section
-    ///////////////////////////////////////////////////////////////////////////
-    shared_lock lock(mutex_);
+    const auto read = [&](const unspent_transaction& unspent)
+    {
+        if (require_confirmed && !unspent.is_confirmed())
+            return false;
 
-    // Find the unspent tx entry.
-    const auto tx = unspent_.left.find(key);
+        // Find the output at the specified index for the found unspent tx.
+        const auto output = unspent.find(point.index());
 
-    if (tx == unspent_.left.end() ||
-        (require_confirmed && !tx->first.is_confirmed()))
-        return false;
+        if (output == nullptr)
+            return false;
 
-    // Find the output at the specified index for the found unspent tx.
-    const auto outputs = tx->first.outputs();
-    const auto output = outputs->find(point.index());
+        // Determine if the cached unspent tx is above specified fork_height.
+        // Since the hash table does not allow duplicates there are no others.
+        const auto height = unspent.height();
 
-    if (output == outputs->end())
-        return false;
+        if (height > fork_height)
+            return false;
 
-    // Determine if the cached unspent tx is above specified fork_height.
-    // Since the hash table does not allow duplicates there are no others.
-    const auto& unspent = tx->first;
-    const auto height = unspent.height();
+        ++shard.hits;
+        out_height = height;
+        out_coinbase = unspent.is_coinbase();
+        out_output = *output;
+        out_is_confirmed = unspent.is_confirmed();
+        return true;
+    };
+
+    if (policy_ == eviction_policy::lru)
+    {
+        // Critical Section
+        ///////////////////////////////////////////////////////////////////////
+        unique_lock lock(shard.mutex);
+
+        // Find the unspent tx entry.
+        const auto tx = shard.unspent.left.find(key);
+
+        if (tx == shard.unspent.left.end() || !read(tx->first))
+            return false;
 
-    if (height > fork_height)
+        // The read entry becomes the most recently used.
+        shard.unspent.left.modify_data(tx,
+            boost::bimaps::_data = ++shard.sequence);
+        return true;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    // Critical Section
+    ///////////////////////////////////////////////////////////////////////////
+    shared_lock lock(shard.mutex);
+
+    // Find the unspent tx entry.
+    const auto tx = shard.unspent.left.find(key);
+
+    if (tx == shard.unspent.left.end() || !read(tx->first))
         return false;
 
-    ++hits_;
-    out_height = height;
-    out_coinbase = unspent.is_coinbase();
-    out_output = output->second;
-    out_is_confirmed = tx->first.is_confirmed();
+    // The clock policy passes over this entry once before evicting it.
+    if (policy_ == eviction_policy::clock)
+        tx->first.set_referenced(true);
+
     return true;
     ///////////////////////////////////////////////////////////////////////////
 }
@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <utility>
 #include <bitcoin/bitcoin.hpp>
 
@@ -33,7 +34,10 @@ unspent_transaction::unspent_transaction(unspent_transaction&& other)
     is_coinbase_(other.is_coinbase_),
     is_confirmed_(other.is_confirmed_),
     hash_(std::move(other.hash_)),
-    outputs_(other.outputs_)
+    outputs_(std::move(other.outputs_)),
+    removed_(std::move(other.removed_)),
+    removed_count_(other.removed_count_),
+    referenced_(other.referenced_.load())
 {
 }
 
@@ -42,7 +46,10 @@ unspent_transaction::unspent_transaction(const unspent_transaction& other)
     is_coinbase_(other.is_coinbase_),
     is_confirmed_(other.is_confirmed_),
     hash_(other.hash_),
-    outputs_(other.outputs_)
+    outputs_(other.outputs_),
+    removed_(other.removed_),
+    removed_count_(other.removed_count_),
+    referenced_(other.referenced_.load())
 {
 }
 
@@ -51,7 +58,8 @@ unspent_transaction::unspent_transaction(const hash_digest& hash)
     is_coinbase_(false),
     is_confirmed_(false),
     hash_(hash),
-    outputs_(std::make_shared<output_map>())
+    removed_count_(0),
+    referenced_(false)
 {
 }
 
@@ -66,15 +74,29 @@ unspent_transaction::unspent_transaction(const chain::transaction& tx,
     is_coinbase_(tx.is_coinbase()),
     is_confirmed_(confirmed),
     hash_(tx.hash()),
-    outputs_(std::make_shared<output_map>())
+    removed_count_(0),
+    referenced_(false)
 {
     const auto& outputs = tx.outputs();
     const auto size = safe_unsigned<uint32_t>(outputs.size());
-    outputs_->reserve(size);
+    outputs_.reserve(size);
 
     // TODO: consider eliminating the byte buffer in favor of ops::list only.
+    // Indexes ascend, so each output is appended to the flat map.
     for (uint32_t index = 0; index < size; ++index)
-        (*outputs_)[index] = outputs[index];
+        outputs_.emplace_hint(outputs_.end(), index, outputs[index]);
+}
+
+unspent_transaction::unspent_transaction(const hash_digest& hash,
+    size_t height, bool coinbase, bool confirmed, output_map&& outputs)
+  : height_(height),
+    is_coinbase_(coinbase),
+    is_confirmed_(confirmed),
+    hash_(hash),
+    outputs_(std::move(outputs)),
+    removed_count_(0),
+    referenced_(false)
+{
 }
 
 const hash_digest& unspent_transaction::hash() const
@@ -99,7 +121,77 @@ bool unspent_transaction::is_confirmed() const
 
 unspent_transaction::output_map_ptr unspent_transaction::outputs() const
 {
-    return outputs_;
+    return &outputs_;
+}
+
+const output* unspent_transaction::find(uint32_t index) const
+{
+    const auto output = outputs_.find(index);
+
+    if (output == outputs_.end() ||
+        removed(std::distance(outputs_.begin(), output)))
+        return nullptr;
+
+    return &output->second;
+}
+
+bool unspent_transaction::removed(size_t position) const
+{
+    return !removed_.empty() && removed_[position];
+}
+
+// The output is marked (and its script released) in place, as an erase would
+// move each following output. Compaction moves each remaining output once,
+// after at least as many removals.
+bool unspent_transaction::remove(uint32_t index) const
+{
+    const auto output = outputs_.find(index);
+
+    if (output == outputs_.end())
+        return false;
+
+    const auto position = std::distance(outputs_.begin(), output);
+
+    if (removed(position))
+        return false;
+
+    if (removed_.empty())
+        removed_.resize(outputs_.size(), false);
+
+    removed_[position] = true;
+    output->second = chain::output{};
+
+    if (2 * ++removed_count_ < outputs_.size())
+        return true;
+
+    output_map remaining;
+    remaining.reserve(outputs_.size() - removed_count_);
+    size_t next = 0;
+
+    for (auto& entry: outputs_)
+        if (!removed_[next++])
+            remaining.emplace_hint(remaining.end(), entry.first,
+                std::move(entry.second));
+
+    outputs_.swap(remaining);
+    removed_.clear();
+    removed_count_ = 0;
+    return true;
+}
+
+size_t unspent_transaction::size() const
+{
+    return outputs_.size() - removed_count_;
+}
+
+bool unspent_transaction::referenced() const
+{
+    return referenced_.load(std::memory_order_relaxed);
+}
+
+void unspent_transaction::set_referenced(bool value) const
+{
+    referenced_.store(value, std::memory_order_relaxed);
 }
 
 // For the purpose of bimap identity only the tx hash matters.
@@ -114,7 +206,10 @@ unspent_transaction& unspent_transaction::operator=(
     height_ = other.height_;
     is_coinbase_ = other.is_coinbase_;
     hash_ = std::move(other.hash_);
-    outputs_ = other.outputs_;
+    outputs_ = std::move(other.outputs_);
+    removed_ = std::move(other.removed_);
+    removed_count_ = other.removed_count_;
+    referenced_ = other.referenced_.load();
     return *this;
 }
 
@@ -125,6 +220,9 @@ unspent_transaction& unspent_transaction::operator=(
     is_coinbase_ = other.is_coinbase_;
     hash_ = other.hash_;
     outputs_ = other.outputs_;
+    removed_ = other.removed_;
+    removed_count_ = other.removed_count_;
+    referenced_ = other.referenced_.load();
     return *this;
 }
 
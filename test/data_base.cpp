@@ -396,6 +396,16 @@ BOOST_AUTO_TEST_CASE(data_base__pushpop__test)
     test_block_not_exists(instance, *block2_ptr, indexed);
     test_block_exists(instance, 0, block0, indexed);
 
+    // The second block is linked to the first, which is not yet stored.
+    std::cout << "push_all blocks #1 & #3 (store_block_missing_parent)" << std::endl;
+    const auto block1_ptr = std::make_shared<const message::block>(block1);
+    const auto unlinked_push_ptr = std::make_shared<const block_const_ptr_list>(block_const_ptr_list{ block1_ptr, block3_ptr });
+    BOOST_REQUIRE_EQUAL(push_all_result(instance, unlinked_push_ptr, 1, dispatch), error::store_block_missing_parent);
+    BOOST_REQUIRE(instance.blocks().top(height));
+    BOOST_REQUIRE_EQUAL(height, 1u);
+    test_block_exists(instance, 1, block1, indexed);
+    test_block_not_exists(instance, *block3_ptr, indexed);
+
     std::cout << "end push/pop test" << std::endl;
 }
 
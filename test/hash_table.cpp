@@ -16,7 +16,10 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <atomic>
 #include <random>
+#include <thread>
+#include <vector>
 #include <boost/functional/hash_fwd.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/filesystem.hpp>
@@ -164,13 +167,13 @@ BOOST_AUTO_TEST_CASE(slab_hash_table__test)
     memory_map file(DIRECTORY "/slab_hash_table");
     BOOST_REQUIRE(file.open());
     BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
-    file.resize(4 + 8 * 100 + 8);
+    file.resize(slab_hash_table_header_size(100) + minimum_slabs_size);
 
     slab_hash_table_header header(file, 100);
     BOOST_REQUIRE(header.create());
     BOOST_REQUIRE(header.start());
 
-    slab_manager alloc(file, 4 + 8 * 100);
+    slab_manager alloc(file, slab_hash_table_header_size(100));
     BOOST_REQUIRE(alloc.create());
     BOOST_REQUIRE(alloc.start());
 
@@ -196,6 +199,547 @@ BOOST_AUTO_TEST_CASE(slab_hash_table__test)
     BOOST_REQUIRE(slab2);
 }
 
+BOOST_AUTO_TEST_CASE(slab_hash_table__concurrent_store__all_found)
+{
+    BC_CONSTEXPR size_t threads = 4;
+    BC_CONSTEXPR size_t per_thread = 500;
+    BC_CONSTEXPR size_t header_size = slab_hash_table_header_size(buckets);
+
+    store::create(DIRECTORY "/slab_hash_table__concurrent_store");
+    memory_map file(DIRECTORY "/slab_hash_table__concurrent_store");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_hash_table<little_hash> ht(header, alloc);
+
+    const auto make_key = [](size_t thread, size_t index)
+    {
+        const auto value = static_cast<uint32_t>(thread * per_thread + index);
+        const auto bytes = to_little_endian(value);
+        return little_hash{ { bytes[0], bytes[1], bytes[2], bytes[3],
+            0x00, 0x00, 0x00, 0x00 } };
+    };
+
+    const auto writer = [&](size_t thread)
+    {
+        for (size_t index = 0; index < per_thread; ++index)
+        {
+            const auto write = [&](serializer<uint8_t*>& serial)
+            {
+                serial.write_4_bytes_little_endian(
+                    static_cast<uint32_t>(thread * per_thread + index));
+            };
+
+            ht.store(make_key(thread, index), write, sizeof(uint32_t));
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t thread = 0; thread < threads; ++thread)
+        pool.emplace_back(writer, thread);
+
+    for (auto& thread: pool)
+        thread.join();
+
+    alloc.sync();
+
+    // Every key is linked exactly once despite concurrent bucket writes.
+    for (size_t thread = 0; thread < threads; ++thread)
+    {
+        for (size_t index = 0; index < per_thread; ++index)
+        {
+            const auto memory = ht.find(make_key(thread, index));
+            BOOST_REQUIRE(memory);
+            const auto slab = REMAP_ADDRESS(memory);
+            BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint32_t>(slab),
+                thread * per_thread + index);
+        }
+    }
+
+    BOOST_REQUIRE(ht.contention() <= threads * per_thread);
+}
+
+BOOST_AUTO_TEST_CASE(slab_hash_table__resize__all_found)
+{
+    BC_CONSTEXPR size_t initial_buckets = 8;
+    BC_CONSTEXPR size_t max_load = 100;
+    BC_CONSTEXPR size_t count = 1000;
+    BC_CONSTEXPR size_t header_size =
+        slab_hash_table_header_size(initial_buckets);
+
+    store::create(DIRECTORY "/slab_hash_table__resize");
+    memory_map file(DIRECTORY "/slab_hash_table__resize");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, initial_buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_hash_table<little_hash> ht(header, alloc, max_load);
+    BOOST_REQUIRE(ht.start());
+
+    const auto make_key = [](size_t index)
+    {
+        const auto bytes = to_little_endian(static_cast<uint32_t>(index));
+        return little_hash{ { bytes[0], bytes[1], bytes[2], bytes[3],
+            0x00, 0x00, 0x00, 0x00 } };
+    };
+
+    const auto found = [&](slab_hash_table<little_hash>& table, size_t index)
+    {
+        const auto memory = table.find(make_key(index));
+        return memory && from_little_endian_unsafe<uint32_t>(
+            REMAP_ADDRESS(memory)) == index;
+    };
+
+    // A concurrent reader never misses a stored key during migration.
+    std::atomic<size_t> stored(0);
+    std::atomic<size_t> misses(0);
+    std::thread reader([&]()
+    {
+        while (stored.load() < count)
+            for (size_t index = 0; index < stored.load(); ++index)
+                if (!found(ht, index))
+                    ++misses;
+    });
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto write = [index](serializer<uint8_t*>& serial)
+        {
+            serial.write_4_bytes_little_endian(static_cast<uint32_t>(index));
+        };
+
+        ht.store(make_key(index), write, sizeof(uint32_t));
+        stored.store(index + 1);
+    }
+
+    reader.join();
+    BOOST_REQUIRE_EQUAL(misses.load(), 0u);
+
+    // Complete a resize in progress.
+    ht.migrate(ht.buckets());
+    alloc.sync();
+
+    BOOST_REQUIRE(!ht.resizing());
+    BOOST_REQUIRE_GT(ht.buckets(), initial_buckets);
+    BOOST_REQUIRE_EQUAL(ht.keys(), count);
+    BOOST_REQUIRE_LE(ht.load(), max_load);
+
+    for (size_t index = 0; index < count; ++index)
+        BOOST_REQUIRE(found(ht, index));
+
+    // The relocated bucket array is loaded by start, all keys are sampled.
+    slab_hash_table_header header2(file, initial_buckets);
+    BOOST_REQUIRE(header2.start());
+    BOOST_REQUIRE(header2.relocated());
+
+    slab_manager alloc2(file, header_size);
+    BOOST_REQUIRE(alloc2.start());
+
+    slab_hash_table<little_hash> ht2(header2, alloc2, max_load);
+    BOOST_REQUIRE(ht2.start());
+    BOOST_REQUIRE_EQUAL(ht2.buckets(), ht.buckets());
+    BOOST_REQUIRE_EQUAL(ht2.keys(), count);
+
+    for (size_t index = 0; index < count; ++index)
+        BOOST_REQUIRE(found(ht2, index));
+}
+
+BOOST_AUTO_TEST_CASE(slab_hash_table__resize__resumed_by_start)
+{
+    BC_CONSTEXPR size_t initial_buckets = 64;
+    BC_CONSTEXPR size_t max_load = 100;
+    BC_CONSTEXPR size_t header_size =
+        slab_hash_table_header_size(initial_buckets);
+
+    store::create(DIRECTORY "/slab_hash_table__resume");
+    memory_map file(DIRECTORY "/slab_hash_table__resume");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, initial_buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_hash_table<little_hash> ht(header, alloc, max_load);
+    BOOST_REQUIRE(ht.start());
+
+    const auto write = [](serializer<uint8_t*>& serial)
+    {
+        serial.write_byte(42);
+    };
+
+    // Store until the first resize has started but not completed.
+    size_t count = 0;
+    while (!ht.resizing())
+    {
+        const auto bytes = to_little_endian(static_cast<uint32_t>(count++));
+        ht.store(little_hash{ { bytes[0], bytes[1], bytes[2], bytes[3],
+            0x01, 0x00, 0x00, 0x00 } }, write, 1);
+    }
+
+    alloc.sync();
+    BOOST_REQUIRE_EQUAL(ht.migrated(), ht.migration_step);
+
+    slab_hash_table_header header2(file, initial_buckets);
+    BOOST_REQUIRE(header2.start());
+    slab_manager alloc2(file, header_size);
+    BOOST_REQUIRE(alloc2.start());
+    slab_hash_table<little_hash> ht2(header2, alloc2, max_load);
+    BOOST_REQUIRE(ht2.start());
+
+    BOOST_REQUIRE(ht2.resizing());
+    BOOST_REQUIRE_EQUAL(ht2.migrated(), ht.migrated());
+    BOOST_REQUIRE_EQUAL(ht2.migrate(initial_buckets),
+        initial_buckets - ht.migration_step);
+    BOOST_REQUIRE(!ht2.resizing());
+    BOOST_REQUIRE_EQUAL(ht2.buckets(), 2 * initial_buckets);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto bytes = to_little_endian(static_cast<uint32_t>(index));
+        BOOST_REQUIRE(ht2.find(little_hash{ { bytes[0], bytes[1], bytes[2],
+            bytes[3], 0x01, 0x00, 0x00, 0x00 } }));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bucket_policy__multiply_shift__splits_to_adjacent)
+{
+    typedef bucket_policy<hash_digest>::reduction reduction;
+    std::mt19937_64 random(42);
+
+    for (size_t test = 0; test < 1000; ++test)
+    {
+        const auto hash = random();
+        const auto buckets = static_cast<array_index>(1 + random() % 100000);
+        const auto bucket = reduction::reduce(hash, buckets);
+        const auto doubled = reduction::reduce(hash, 2 * buckets);
+        const auto quadrupled = reduction::reduce(hash, 4 * buckets);
+        BOOST_REQUIRE_LT(bucket, buckets);
+        BOOST_REQUIRE(doubled == reduction::lower(bucket, buckets) ||
+            doubled == reduction::upper(bucket, buckets));
+        BOOST_REQUIRE_EQUAL(
+            reduction::origin(quadrupled, 4 * buckets, buckets), bucket);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(slab_hash_table__digest_resize__all_found)
+{
+    BC_CONSTEXPR size_t initial_buckets = 100;
+    BC_CONSTEXPR size_t max_load = 100;
+    BC_CONSTEXPR size_t count = 2000;
+    BC_CONSTEXPR size_t header_size =
+        slab_hash_table_header_size(initial_buckets);
+
+    store::create(DIRECTORY "/slab_hash_table__digest_resize");
+    memory_map file(DIRECTORY "/slab_hash_table__digest_resize");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, initial_buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_hash_table<hash_digest> ht(header, alloc, max_load);
+    BOOST_REQUIRE(ht.start());
+
+    std::mt19937_64 random(42);
+    std::vector<hash_digest> keys(count);
+
+    for (auto& key: keys)
+    {
+        auto serial = make_unsafe_serializer(key.begin());
+        for (size_t word = 0; word < hash_size / sizeof(uint64_t); ++word)
+            serial.write_8_bytes_little_endian(random());
+    }
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto write = [index](serializer<uint8_t*>& serial)
+        {
+            serial.write_4_bytes_little_endian(index);
+        };
+
+        ht.store(keys[index], write, 4);
+    }
+
+    ht.migrate(ht.buckets());
+    BOOST_REQUIRE(!ht.resizing());
+    BOOST_REQUIRE_GT(ht.buckets(), initial_buckets);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto memory = ht.find(keys[index]);
+        BOOST_REQUIRE(memory);
+        auto deserial = make_unsafe_deserializer(REMAP_ADDRESS(memory));
+        BOOST_REQUIRE_EQUAL(deserial.read_4_bytes_little_endian(), index);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(slab_hash_table__digest_resize_in_progress__for_each_and_start)
+{
+    BC_CONSTEXPR size_t initial_buckets = 64;
+    BC_CONSTEXPR size_t max_load = 100;
+    BC_CONSTEXPR size_t header_size =
+        slab_hash_table_header_size(initial_buckets);
+
+    store::create(DIRECTORY "/slab_hash_table__digest_in_progress");
+    memory_map file(DIRECTORY "/slab_hash_table__digest_in_progress");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, initial_buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_hash_table<hash_digest> ht(header, alloc, max_load);
+    BOOST_REQUIRE(ht.start());
+
+    std::mt19937_64 random(42);
+    std::vector<hash_digest> keys;
+
+    // Store until the first resize has started but not completed, so that
+    // the split buckets are in the target and the others in the current.
+    while (!ht.resizing())
+    {
+        hash_digest key;
+        auto serial = make_unsafe_serializer(key.begin());
+        for (size_t word = 0; word < hash_size / sizeof(uint64_t); ++word)
+            serial.write_8_bytes_little_endian(random());
+
+        const auto index = static_cast<uint32_t>(keys.size());
+        const auto write = [index](serializer<uint8_t*>& serial)
+        {
+            serial.write_4_bytes_little_endian(index);
+        };
+
+        keys.push_back(key);
+        ht.store(key, write, 4);
+    }
+
+    alloc.sync();
+    BOOST_REQUIRE_LT(ht.migrated(), initial_buckets);
+
+    // Each stored item is visited exactly once.
+    const auto visit_all = [&keys](const slab_hash_table<hash_digest>& table)
+    {
+        std::vector<size_t> visits(keys.size(), 0);
+        table.for_each([&visits](memory_ptr memory)
+        {
+            auto deserial = make_unsafe_deserializer(REMAP_ADDRESS(memory));
+            ++visits[deserial.read_4_bytes_little_endian()];
+            return true;
+        });
+
+        for (const auto visit: visits)
+            BOOST_REQUIRE_EQUAL(visit, 1u);
+    };
+
+    visit_all(ht);
+
+    slab_hash_table_header header2(file, initial_buckets);
+    BOOST_REQUIRE(header2.start());
+    slab_manager alloc2(file, header_size);
+    BOOST_REQUIRE(alloc2.start());
+    slab_hash_table<hash_digest> ht2(header2, alloc2, max_load);
+    BOOST_REQUIRE(ht2.start());
+
+    // Every bucket is sampled at this size, so the estimate is exact.
+    BOOST_REQUIRE(ht2.resizing());
+    BOOST_REQUIRE_EQUAL(ht2.migrated(), ht.migrated());
+    BOOST_REQUIRE_EQUAL(ht2.keys(), keys.size());
+    visit_all(ht2);
+}
+
+BOOST_AUTO_TEST_CASE(slab_open_hash_table__store_find_unlink__test)
+{
+    BC_CONSTEXPR size_t open_buckets = 4;
+    BC_CONSTEXPR size_t header_size = slab_hash_table_header_size(open_buckets);
+
+    store::create(DIRECTORY "/slab_open_hash_table");
+    memory_map file(DIRECTORY "/slab_open_hash_table");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, open_buckets, table_kind::open);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_open_hash_table<tiny_hash> ht(header, alloc);
+    BOOST_REQUIRE(ht.start());
+
+    const auto writer = [](uint8_t value)
+    {
+        return [value](serializer<uint8_t*>& serial)
+        {
+            serial.write_byte(value);
+        };
+    };
+
+    const tiny_hash key1{ { 0xde, 0xad, 0xbe, 0xef } };
+    const tiny_hash key2{ { 0xba, 0xad, 0xf0, 0x0d } };
+    const tiny_hash missing{ { 0x00, 0x01, 0x02, 0x03 } };
+
+    // Cannot hold an address reference because of following store operations.
+    const auto value = [&ht](const tiny_hash& key)
+    {
+        const auto memory = ht.find(key);
+        return memory ? static_cast<int>(REMAP_ADDRESS(memory)[0]) : -1;
+    };
+
+    BOOST_REQUIRE(ht.reserve(2));
+    ht.store(key1, writer(42), 1);
+    ht.store(key2, writer(7), 1);
+    alloc.sync();
+
+    BOOST_REQUIRE_EQUAL(value(key1), 42);
+    BOOST_REQUIRE_EQUAL(value(key2), 7);
+    BOOST_REQUIRE_EQUAL(value(missing), -1);
+
+    // A duplicate key resolves to the most recently stored value.
+    BOOST_REQUIRE(ht.reserve(1));
+    ht.store(key1, writer(43), 1);
+    alloc.sync();
+    BOOST_REQUIRE_EQUAL(value(key1), 43);
+
+    // Update writes the value of the most recent duplicate.
+    BOOST_REQUIRE(ht.update(key1, writer(44)) != 0);
+    BOOST_REQUIRE_EQUAL(value(key1), 44);
+
+    // Unlink removes the most recent duplicate, exposing the previous.
+    BOOST_REQUIRE(ht.unlink(key1));
+    BOOST_REQUIRE_EQUAL(value(key1), 42);
+
+    BOOST_REQUIRE(ht.unlink(key1));
+    BOOST_REQUIRE_EQUAL(value(key1), -1);
+    BOOST_REQUIRE(!ht.unlink(key1));
+    BOOST_REQUIRE(!ht.unlink(missing));
+
+    // Tombstones do not terminate a probe and are reused by store.
+    BOOST_REQUIRE_EQUAL(value(key2), 7);
+
+    size_t count = 0;
+    ht.for_each([&count](memory_ptr)
+    {
+        ++count;
+        return true;
+    });
+
+    BOOST_REQUIRE_EQUAL(count, 1u);
+
+    // One bucket is claimed, so three remain to be reserved.
+    BOOST_REQUIRE(!ht.reserve(4));
+    BOOST_REQUIRE(ht.reserve(3));
+    ht.store(missing, writer(1), 1);
+    ht.store(key1, writer(2), 1);
+    ht.store(tiny_hash{ { 0x01, 0x01, 0x01, 0x01 } }, writer(3), 1);
+    alloc.sync();
+
+    // All buckets are now used, so the table cannot accept another key.
+    BOOST_REQUIRE(!ht.reserve(1));
+
+    // An unlink frees a bucket for a store.
+    BOOST_REQUIRE(ht.unlink(missing));
+    BOOST_REQUIRE(ht.reserve(1));
+    ht.release(1);
+
+    // The claimed buckets are counted from the file.
+    slab_open_hash_table<tiny_hash> reopened(header, alloc);
+    BOOST_REQUIRE(reopened.start());
+    BOOST_REQUIRE(!reopened.reserve(2));
+    BOOST_REQUIRE(reopened.reserve(1));
+}
+
+BOOST_AUTO_TEST_CASE(slab_open_hash_table__unlink_all__buckets_empty)
+{
+    BC_CONSTEXPR size_t open_buckets = 8;
+    BC_CONSTEXPR size_t header_size = slab_hash_table_header_size(open_buckets);
+
+    store::create(DIRECTORY "/slab_open_hash_table_unlink");
+    memory_map file(DIRECTORY "/slab_open_hash_table_unlink");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_slabs_size);
+
+    slab_hash_table_header header(file, open_buckets, table_kind::open);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    slab_manager alloc(file, header_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    slab_open_hash_table<tiny_hash> ht(header, alloc);
+    BOOST_REQUIRE(ht.start());
+
+    const auto write = [](serializer<uint8_t*>& serial)
+    {
+        serial.write_byte(42);
+    };
+
+    // Many more stores and unlinks than buckets.
+    for (uint8_t round = 0; round < 16; ++round)
+    {
+        std::vector<tiny_hash> keys;
+
+        for (uint8_t key = 0; key < open_buckets / 2; ++key)
+            keys.push_back(tiny_hash{ { round, key, 0x00, 0x00 } });
+
+        BOOST_REQUIRE(ht.reserve(keys.size()));
+
+        for (const auto& key: keys)
+            ht.store(key, write, 1);
+
+        alloc.sync();
+
+        for (const auto& key: keys)
+            BOOST_REQUIRE(ht.find(key));
+
+        for (const auto& key: keys)
+            BOOST_REQUIRE(ht.unlink(key));
+
+        // Tombstones are emptied, so no probe outlives its keys.
+        for (array_index index = 0; index < open_buckets; ++index)
+            BOOST_REQUIRE_EQUAL(header.read(index), header.empty);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(record_hash_table__32bit__test)
 {
     BC_CONSTEXPR size_t record_buckets = 2;
@@ -326,6 +870,77 @@ BOOST_AUTO_TEST_CASE(record_hash_table__32bit__test)
     BOOST_REQUIRE(!ht.unlink(invalid));
 }
 
+BOOST_AUTO_TEST_CASE(record_hash_table__resize__all_found)
+{
+    BC_CONSTEXPR size_t initial_buckets = 8;
+    BC_CONSTEXPR size_t max_load = 150;
+    BC_CONSTEXPR size_t count = 1000;
+    BC_CONSTEXPR size_t header_size =
+        record_hash_table_header_size(initial_buckets);
+    BC_CONSTEXPR size_t record_size = hash_table_record_size<tiny_hash>(4);
+
+    store::create(DIRECTORY "/record_hash_table__resize");
+    memory_map file(DIRECTORY "/record_hash_table__resize");
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE(REMAP_ADDRESS(file.access()) != nullptr);
+    file.resize(header_size + minimum_records_size);
+
+    record_hash_table_header header(file, initial_buckets);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    record_manager alloc(file, header_size, record_size);
+    BOOST_REQUIRE(alloc.create());
+    BOOST_REQUIRE(alloc.start());
+
+    record_hash_table<tiny_hash> ht(header, alloc, max_load);
+    BOOST_REQUIRE(ht.start());
+
+    const auto make_key = [](size_t index)
+    {
+        const auto bytes = to_little_endian(static_cast<uint32_t>(index));
+        return tiny_hash{ { bytes[0], bytes[1], bytes[2], bytes[3] } };
+    };
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto write = [index](serializer<uint8_t*>& serial)
+        {
+            serial.write_4_bytes_little_endian(static_cast<uint32_t>(index));
+        };
+
+        ht.store(make_key(index), write);
+    }
+
+    ht.migrate(ht.buckets());
+    alloc.sync();
+
+    BOOST_REQUIRE(!ht.resizing());
+    BOOST_REQUIRE_GT(ht.buckets(), initial_buckets);
+    BOOST_REQUIRE_EQUAL(ht.keys(), count);
+
+    // Unlinking from the resized table is counted.
+    BOOST_REQUIRE(ht.unlink(make_key(0)));
+    BOOST_REQUIRE(!ht.find(make_key(0)));
+    BOOST_REQUIRE_EQUAL(ht.keys(), count - 1);
+
+    record_hash_table_header header2(file, initial_buckets);
+    BOOST_REQUIRE(header2.start());
+    record_manager alloc2(file, header_size, record_size);
+    BOOST_REQUIRE(alloc2.start());
+    record_hash_table<tiny_hash> ht2(header2, alloc2, max_load);
+    BOOST_REQUIRE(ht2.start());
+    BOOST_REQUIRE_EQUAL(ht2.buckets(), ht.buckets());
+
+    for (size_t index = 1; index < count; ++index)
+    {
+        const auto memory = ht2.find(make_key(index));
+        BOOST_REQUIRE(memory);
+        BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint32_t>(
+            REMAP_ADDRESS(memory)), index);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(record_hash_table_header__64bit__test)
 {
     BC_CONSTEXPR size_t record_buckets = 2;
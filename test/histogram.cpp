@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+
+#include <bitcoin/database.hpp>
+
+using namespace bc;
+using namespace bc::database;
+
+BOOST_AUTO_TEST_SUITE(histogram_tests)
+
+BOOST_AUTO_TEST_CASE(histogram__bucket__below_sub_buckets__value)
+{
+    BOOST_REQUIRE_EQUAL(histogram::bucket(0), 0u);
+    BOOST_REQUIRE_EQUAL(histogram::bucket(31), 31u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__bucket__maximum__last_bucket)
+{
+    BOOST_REQUIRE_EQUAL(histogram::bucket(max_uint64), histogram::buckets - 1);
+    BOOST_REQUIRE_EQUAL(histogram::upper(histogram::buckets - 1), max_uint64);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__upper__each_bucket__contains_upper)
+{
+    for (size_t bucket = 0; bucket < histogram::buckets; ++bucket)
+    {
+        const auto upper = histogram::upper(bucket);
+        BOOST_REQUIRE_EQUAL(histogram::bucket(upper), bucket);
+
+        if (upper != max_uint64)
+            BOOST_REQUIRE_EQUAL(histogram::bucket(upper + 1), bucket + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(histogram__capture__empty__zeros)
+{
+    const histogram instance;
+    const auto snapshot = instance.capture();
+    BOOST_REQUIRE_EQUAL(snapshot.count, 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.minimum, 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.maximum, 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.mean(), 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.percentile(99), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__record__values__expected_statistics)
+{
+    histogram instance;
+
+    for (uint64_t value = 1; value <= 100; ++value)
+        instance.record(value);
+
+    const auto snapshot = instance.capture();
+    BOOST_REQUIRE_EQUAL(snapshot.count, 100u);
+    BOOST_REQUIRE_EQUAL(snapshot.total, 5050u);
+    BOOST_REQUIRE_EQUAL(snapshot.minimum, 1u);
+    BOOST_REQUIRE_EQUAL(snapshot.maximum, 100u);
+    BOOST_REQUIRE_EQUAL(snapshot.mean(), 50u);
+    BOOST_REQUIRE_EQUAL(snapshot.percentile(0), 1u);
+    BOOST_REQUIRE_EQUAL(snapshot.percentile(100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__percentile__large_value__within_resolution)
+{
+    histogram instance;
+    instance.record(1000000);
+    instance.record(1);
+
+    const auto snapshot = instance.capture();
+    const auto p99 = snapshot.percentile(99);
+    BOOST_REQUIRE_GE(p99, 1000000u);
+    BOOST_REQUIRE_LE(p99, 1000000u + 1000000u / histogram::sub_buckets);
+    BOOST_REQUIRE_EQUAL(snapshot.percentile(50), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__reset__recorded__empty)
+{
+    histogram instance;
+    instance.record(42);
+    instance.reset();
+
+    const auto snapshot = instance.capture();
+    BOOST_REQUIRE_EQUAL(snapshot.count, 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.maximum, 0u);
+    BOOST_REQUIRE_EQUAL(snapshot.percentile(50), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__timer__sampled__fraction_recorded)
+{
+    histogram instance(4);
+
+    for (size_t operation = 0; operation < 4096; ++operation)
+        const histogram::timer timer(instance);
+
+    // About one in four timers records.
+    const auto count = instance.capture().count;
+    BOOST_REQUIRE_GT(count, 512u);
+    BOOST_REQUIRE_LT(count, 2048u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__capture__sampled__operations_scaled)
+{
+    histogram instance(64);
+    instance.record(10);
+    instance.record(20);
+
+    const auto snapshot = instance.capture();
+    BOOST_REQUIRE_EQUAL(snapshot.count, 2u);
+    BOOST_REQUIRE_EQUAL(snapshot.sample_rate, 64u);
+    BOOST_REQUIRE_EQUAL(snapshot.operations(), 128u);
+    BOOST_REQUIRE_EQUAL(snapshot.mean(), 15u);
+
+    std::ostringstream text;
+    text << latency{ "sampled", snapshot };
+    BOOST_REQUIRE(text.str().find("count [2] sampled [1/64] operations [~128]")
+        != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(histogram__timer__unsampled__all_recorded)
+{
+    histogram instance;
+
+    for (size_t operation = 0; operation < 100; ++operation)
+        const histogram::timer timer(instance);
+
+    BOOST_REQUIRE_EQUAL(instance.capture().count, 100u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -196,5 +196,165 @@ BOOST_AUTO_TEST_CASE(history_database__test)
     db.synchronize();
 }
 
+BOOST_AUTO_TEST_CASE(history_database__get__cursor__pages_in_height_bounds)
+{
+    const short_hash key = base16_literal("a006500b7ddfd568e2b036c65a4f4d6aaa0cbd9b");
+    const output_point point{ hash_literal("4129e76f363f9742bc98dd3d40c99c9066e4d53b8e10e5097bd6f7b5059d7c53"), 0 };
+
+    store::create(DIRECTORY "/lookup_cursor");
+    store::create(DIRECTORY "/rows_cursor");
+    history_database db(DIRECTORY "/lookup_cursor", DIRECTORY "/rows_cursor", 1000, 50);
+    BOOST_REQUIRE(db.create());
+
+    // Heights 10 through 19, the value identifies the row.
+    for (size_t height = 10; height < 20; ++height)
+        db.add_output(key, point, height, height);
+
+    db.synchronize();
+
+    // Rows above 17 are skipped and the read ends below 12.
+    history_cursor cursor;
+    const auto page1 = db.get(key, 4, 12, 17, cursor);
+    BOOST_REQUIRE_EQUAL(page1.size(), 4u);
+    BOOST_REQUIRE_EQUAL(page1[0].height, 17u);
+    BOOST_REQUIRE_EQUAL(page1[3].height, 14u);
+    BOOST_REQUIRE(!cursor.exhausted());
+
+    const auto page2 = db.get(key, 4, 12, 17, cursor);
+    BOOST_REQUIRE_EQUAL(page2.size(), 2u);
+    BOOST_REQUIRE_EQUAL(page2[0].height, 13u);
+    BOOST_REQUIRE_EQUAL(page2[1].height, 12u);
+    BOOST_REQUIRE(cursor.exhausted());
+
+    const auto page3 = db.get(key, 4, 12, 17, cursor);
+    BOOST_REQUIRE(page3.empty());
+
+    // An unbounded read returns every row and exhausts the cursor.
+    history_cursor unlimited;
+    const auto all = db.get(key, 0, 0, max_size_t, unlimited);
+    BOOST_REQUIRE_EQUAL(all.size(), 10u);
+    BOOST_REQUIRE(unlimited.exhausted());
+}
+
+BOOST_AUTO_TEST_CASE(history_database__get__cursor_out_of_height_order__all_in_bounds)
+{
+    const short_hash key = base16_literal("5b1e7d2c3e84b0a6f4d5e8a1c2b3d4e5f6a7b8c9");
+    const output_point point{ hash_literal("6d0f4c6e2b9a8d7c6b5a4f3e2d1c0b9a8f7e6d5c4b3a29180706050403020100"), 0 };
+
+    store::create(DIRECTORY "/lookup_unordered");
+    store::create(DIRECTORY "/rows_unordered");
+    history_database db(DIRECTORY "/lookup_unordered", DIRECTORY "/rows_unordered", 1000, 50);
+    BOOST_REQUIRE(db.create());
+
+    // Heights 20 through 29, then 5 and 15 as if inserted into gaps.
+    for (size_t height = 20; height < 30; ++height)
+        db.add_output(key, point, height, height);
+
+    db.add_output(key, point, 5, 5);
+    db.add_output(key, point, 15, 15);
+    db.synchronize();
+
+    // The read does not end at the row below 12 that precedes the others.
+    const auto above = db.get(key, 0, 12);
+    BOOST_REQUIRE_EQUAL(above.size(), 11u);
+    BOOST_REQUIRE_EQUAL(above.front().height, 15u);
+    BOOST_REQUIRE_EQUAL(above.back().height, 20u);
+
+    history_cursor cursor;
+    const auto page1 = db.get(key, 6, 12, max_size_t, cursor);
+    BOOST_REQUIRE_EQUAL(page1.size(), 6u);
+    const auto page2 = db.get(key, 6, 12, max_size_t, cursor);
+    BOOST_REQUIRE_EQUAL(page2.size(), 5u);
+    BOOST_REQUIRE(cursor.exhausted());
+
+    // Once the gap rows are deleted the read ends at the first row below.
+    BOOST_REQUIRE(db.delete_last_row(key));
+    BOOST_REQUIRE(db.delete_last_row(key));
+    history_cursor ordered;
+    BOOST_REQUIRE_EQUAL(db.get(key, 0, 25, max_size_t, ordered).size(), 5u);
+    BOOST_REQUIRE(ordered.ordered);
+}
+
+BOOST_AUTO_TEST_CASE(history_database__delete_last_row__across_chunks__expected_rows)
+{
+    const short_hash key = base16_literal("9c6b3bdaa612ceab88d49d4431ed58f26e69b90d");
+    const output_point point{ hash_literal("80d9e7012b5b171bf78e75b52d2d149580d9e7012b5b171bf78e75b52d2d1495"), 0 };
+    const auto rows = 2 * history_database::chunk_rows + 3;
+
+    store::create(DIRECTORY "/lookup_chunks");
+    store::create(DIRECTORY "/rows_chunks");
+    history_database db(DIRECTORY "/lookup_chunks", DIRECTORY "/rows_chunks", 1000, 50);
+    BOOST_REQUIRE(db.create());
+
+    for (size_t height = 0; height < rows; ++height)
+        db.add_output(key, point, height, height);
+
+    db.synchronize();
+    BOOST_REQUIRE_EQUAL(db.statinfo().chunks, 3u);
+
+    const auto all = db.get(key, 0, 0);
+    BOOST_REQUIRE_EQUAL(all.size(), rows);
+
+    for (size_t index = 0; index < rows; ++index)
+        BOOST_REQUIRE_EQUAL(all[index].height, rows - index - 1);
+
+    const auto summary = db.summary(key);
+    BOOST_REQUIRE_EQUAL(summary.received, rows * (rows - 1) / 2);
+    BOOST_REQUIRE_EQUAL(summary.rows, rows);
+    BOOST_REQUIRE_EQUAL(summary.height, rows - 1);
+
+    // Empty the newest chunk and part of the next.
+    for (size_t count = 0; count < 5; ++count)
+        BOOST_REQUIRE(db.delete_last_row(key));
+
+    const auto popped = db.get(key, 0, 0);
+    BOOST_REQUIRE_EQUAL(popped.size(), rows - 5);
+    BOOST_REQUIRE_EQUAL(popped.front().height, rows - 6);
+    BOOST_REQUIRE_EQUAL(popped.back().height, 0u);
+
+    const auto popped_summary = db.summary(key);
+    BOOST_REQUIRE_EQUAL(popped_summary.received, (rows - 5) * (rows - 6) / 2);
+    BOOST_REQUIRE_EQUAL(popped_summary.rows, rows - 5);
+    BOOST_REQUIRE_EQUAL(popped_summary.height, rows - 6);
+
+    // A row added after the pops is the newest.
+    db.add_output(key, point, rows, rows);
+    const auto pushed = db.get(key, 1, 0);
+    BOOST_REQUIRE_EQUAL(pushed.size(), 1u);
+    BOOST_REQUIRE_EQUAL(pushed.front().height, rows);
+    BOOST_REQUIRE_EQUAL(db.summary(key).rows, rows - 4);
+}
+
+BOOST_AUTO_TEST_CASE(history_database__summary__outputs_and_spends__expected)
+{
+    const short_hash key = base16_literal("3eb84f6a98478e516325b70fecf9903e1ce7528b");
+    const short_hash missing = base16_literal("d60db39ca8ce4caf0f7d2b7d3111535d9543473f");
+    const output_point out{ hash_literal("d90aba96944cac3e715047256f7016d1d90aba96944cac3e715047256f7016d1"), 0 };
+    const input_point spend{ hash_literal("3cc768bbaef30587c72c6eba8dbf6aeec4ef24172ae6fe357f2e24c2b0fa44d5"), 0 };
+
+    store::create(DIRECTORY "/lookup_summary");
+    store::create(DIRECTORY "/rows_summary");
+    history_database db(DIRECTORY "/lookup_summary", DIRECTORY "/rows_summary", 1000, 50);
+    BOOST_REQUIRE(db.create());
+
+    db.add_output(key, out, 100, 5000);
+    db.add_input(key, spend, 120, out);
+
+    const auto summary = db.summary(key);
+    BOOST_REQUIRE_EQUAL(summary.received, 5000u);
+    BOOST_REQUIRE_EQUAL(summary.rows, 2u);
+    BOOST_REQUIRE_EQUAL(summary.height, 120u);
+
+    BOOST_REQUIRE(db.delete_last_row(key));
+    const auto unspent = db.summary(key);
+    BOOST_REQUIRE_EQUAL(unspent.received, 5000u);
+    BOOST_REQUIRE_EQUAL(unspent.rows, 1u);
+    BOOST_REQUIRE_EQUAL(unspent.height, 100u);
+
+    BOOST_REQUIRE(db.delete_last_row(key));
+    BOOST_REQUIRE_EQUAL(db.summary(key).rows, 0u);
+    BOOST_REQUIRE_EQUAL(db.summary(missing).received, 0u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <bitcoin/database.hpp>
+
+using namespace boost::system;
+using namespace boost::filesystem;
+using namespace bc;
+using namespace bc::chain;
+using namespace bc::database;
+
+#define DIRECTORY "stealth_database"
+
+class stealth_database_directory_setup_fixture
+{
+public:
+    stealth_database_directory_setup_fixture()
+    {
+        error_code ec;
+        remove_all(DIRECTORY, ec);
+        BOOST_REQUIRE(create_directories(DIRECTORY, ec));
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(database_tests, stealth_database_directory_setup_fixture)
+
+static stealth_compact make_row(uint8_t tag)
+{
+    stealth_compact row;
+    row.ephemeral_public_key_hash.fill(tag);
+    row.public_key_hash.fill(tag);
+    row.transaction_hash.fill(tag);
+    return row;
+}
+
+BOOST_AUTO_TEST_CASE(stealth_database__scan__buckets__expected)
+{
+    store::create(DIRECTORY "/rows");
+    stealth_database db(DIRECTORY "/rows", 50);
+    BOOST_REQUIRE(db.create());
+
+    // The first byte of the serialized prefix selects the bucket.
+    db.store(0x000000ab, 10, make_row(1));
+    db.store(0x000000a1, 11, make_row(2));
+    db.store(0x0000ffab, 12, make_row(3));
+    db.store(0x000000cd, 13, make_row(4));
+    db.synchronize();
+
+    const auto bucket = db.scan(binary(8, data_chunk{ 0xab }), 0);
+    BOOST_REQUIRE_EQUAL(bucket.size(), 2u);
+    BOOST_REQUIRE(bucket[0].transaction_hash == make_row(3).transaction_hash);
+    BOOST_REQUIRE(bucket[1].transaction_hash == make_row(1).transaction_hash);
+
+    const auto range = db.scan(binary(4, data_chunk{ 0xa0 }), 0);
+    BOOST_REQUIRE_EQUAL(range.size(), 3u);
+
+    const auto longer = db.scan(binary(16, data_chunk{ 0xab, 0xff }), 0);
+    BOOST_REQUIRE_EQUAL(longer.size(), 1u);
+    BOOST_REQUIRE(longer[0].transaction_hash == make_row(3).transaction_hash);
+
+    const auto partial = db.scan(binary(12, data_chunk{ 0xab, 0xf0 }), 0);
+    BOOST_REQUIRE_EQUAL(partial.size(), 1u);
+
+    // Filter bits beyond the 32 bit prefix match only zero bits.
+    const data_chunk padded{ 0xab, 0xff, 0x00, 0x00, 0x80 };
+    BOOST_REQUIRE_EQUAL(db.scan(binary(33, padded), 0).size(), 0u);
+    BOOST_REQUIRE_EQUAL(db.scan(binary(40, data_chunk{ 0xab, 0xff, 0x00, 0x00, 0x00 }), 0).size(), 1u);
+
+    const auto all = db.scan(binary(), 0);
+    BOOST_REQUIRE_EQUAL(all.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(stealth_database__scan__from_height_across_chunks__expected)
+{
+    store::create(DIRECTORY "/rows_chunks");
+    stealth_database db(DIRECTORY "/rows_chunks", 50);
+    BOOST_REQUIRE(db.create());
+
+    const auto rows = 3 * stealth_database::chunk_rows;
+
+    for (size_t height = 0; height < rows; ++height)
+        db.store(0x00000042, static_cast<uint32_t>(height),
+            make_row(static_cast<uint8_t>(height)));
+
+    db.synchronize();
+
+    const binary filter(8, data_chunk{ 0x42 });
+    BOOST_REQUIRE_EQUAL(db.scan(filter, 0).size(), rows);
+
+    const auto from_height = stealth_database::chunk_rows + 1;
+    const auto result = db.scan(filter, from_height);
+    BOOST_REQUIRE_EQUAL(result.size(), rows - from_height);
+    BOOST_REQUIRE(result.back().transaction_hash ==
+        make_row(static_cast<uint8_t>(from_height)).transaction_hash);
+}
+
+BOOST_AUTO_TEST_CASE(stealth_database__scan__mixed_prefixes_and_heights__matches_reference)
+{
+    store::create(DIRECTORY "/rows_mixed");
+    stealth_database db(DIRECTORY "/rows_mixed", 50);
+    BOOST_REQUIRE(db.create());
+
+    // One bucket, a full chunk and a partial chunk, so that every vector
+    // width and the scalar remainder see both matches and mismatches.
+    const auto rows = stealth_database::chunk_rows + 13;
+    std::vector<uint32_t> prefixes;
+    std::vector<uint32_t> heights;
+
+    for (size_t row = 0; row < rows; ++row)
+    {
+        const auto prefix = 0x00000042 | uint32_t((row * 37) & 0xff) << 8 |
+            uint32_t(row % 5) << 16 | uint32_t(row % 3) << 28;
+        const auto height = static_cast<uint32_t>(row / 2);
+        prefixes.push_back(prefix);
+        heights.push_back(height);
+        db.store(prefix, height, make_row(static_cast<uint8_t>(row)));
+    }
+
+    db.synchronize();
+
+    const std::vector<binary> filters
+    {
+        binary(8, data_chunk{ 0x42 }),
+        binary(12, data_chunk{ 0x42, 0x50 }),
+        binary(16, data_chunk{ 0x42, 0x25 }),
+        binary(20, data_chunk{ 0x42, 0x4a, 0x00 }),
+        binary(32, data_chunk{ 0x42, 0x4a, 0x02, 0x20 })
+    };
+
+    const std::vector<size_t> from_heights{ 0, 7, 21, rows / 2 - 1, rows };
+
+    for (const auto& filter: filters)
+    {
+        for (const auto from_height: from_heights)
+        {
+            // Newest first, as the scan returns them.
+            std::vector<uint8_t> expected;
+
+            for (auto row = rows; row > 0; --row)
+            {
+                const auto little = to_little_endian(prefixes[row - 1]);
+                const binary prefix(32, data_chunk(little.begin(),
+                    little.end()));
+
+                if (heights[row - 1] >= from_height &&
+                    filter.is_prefix_of(prefix))
+                    expected.push_back(static_cast<uint8_t>(row - 1));
+            }
+
+            const auto result = db.scan(filter, from_height);
+            BOOST_REQUIRE_EQUAL(result.size(), expected.size());
+
+            for (size_t index = 0; index < expected.size(); ++index)
+                BOOST_REQUIRE(result[index].transaction_hash ==
+                    make_row(expected[index]).transaction_hash);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stealth_database__unlink__push_pop_push__expected)
+{
+    store::create(DIRECTORY "/rows_unlink");
+    stealth_database db(DIRECTORY "/rows_unlink", 50);
+    BOOST_REQUIRE(db.create());
+
+    // Rows at heights 0 through 69 in one bucket span two chunks, and one row
+    // at height 65 is in another bucket.
+    const auto rows = stealth_database::chunk_rows + 6;
+
+    for (size_t height = 0; height < rows; ++height)
+        db.store(0x00000042, static_cast<uint32_t>(height),
+            make_row(static_cast<uint8_t>(height)));
+
+    db.store(0x000000ab, 65, make_row(0xab));
+    db.synchronize();
+
+    const binary filter(8, data_chunk{ 0x42 });
+    const binary other(8, data_chunk{ 0xab });
+
+    // Pop the blocks above 60, emptying the newest chunk of the bucket.
+    for (auto height = rows; height-- > 61;)
+        db.unlink(0x00000042, height);
+
+    BOOST_REQUIRE(db.unlink(0x000000ab, 61));
+    BOOST_REQUIRE(!db.unlink(0x000000ab, 61));
+    BOOST_REQUIRE(!db.unlink(0x00000042, 61));
+    db.synchronize();
+
+    BOOST_REQUIRE_EQUAL(db.scan(filter, 0).size(), 61u);
+    BOOST_REQUIRE_EQUAL(db.scan(other, 0).size(), 0u);
+
+    // Push the fork above 60, the scan sees only the new rows above it.
+    for (uint32_t height = 61; height < 64; ++height)
+        db.store(0x00000042, height, make_row(static_cast<uint8_t>(
+            0x80 + height)));
+
+    db.synchronize();
+
+    const auto result = db.scan(filter, 55);
+    BOOST_REQUIRE_EQUAL(result.size(), 64u - 55u);
+    BOOST_REQUIRE(result.front().transaction_hash ==
+        make_row(0x80 + 63).transaction_hash);
+    BOOST_REQUIRE(result[2].transaction_hash ==
+        make_row(0x80 + 61).transaction_hash);
+    BOOST_REQUIRE(result[3].transaction_hash ==
+        make_row(60).transaction_hash);
+    BOOST_REQUIRE(result.back().transaction_hash ==
+        make_row(55).transaction_hash);
+}
+
+BOOST_AUTO_TEST_CASE(stealth_database__scan__out_of_height_order__expected)
+{
+    store::create(DIRECTORY "/rows_unordered");
+    stealth_database db(DIRECTORY "/rows_unordered", 50);
+    BOOST_REQUIRE(db.create());
+
+    // A full chunk above height 100, then rows inserted into lower gaps.
+    for (size_t row = 0; row < stealth_database::chunk_rows; ++row)
+        db.store(0x00000042, static_cast<uint32_t>(100 + row),
+            make_row(static_cast<uint8_t>(row)));
+
+    db.store(0x00000042, 50, make_row(0xf0));
+    db.store(0x00000042, 150, make_row(0xf1));
+    db.store(0x00000042, 20, make_row(0xf2));
+    db.synchronize();
+
+    const binary filter(8, data_chunk{ 0x42 });
+    const auto above = db.scan(filter, 60);
+    BOOST_REQUIRE_EQUAL(above.size(), stealth_database::chunk_rows + 1);
+    BOOST_REQUIRE(above.front().transaction_hash ==
+        make_row(0xf1).transaction_hash);
+
+    const auto gaps = db.scan(filter, 30);
+    BOOST_REQUIRE_EQUAL(gaps.size(), stealth_database::chunk_rows + 2);
+    BOOST_REQUIRE(gaps[0].transaction_hash == make_row(0xf1).transaction_hash);
+    BOOST_REQUIRE(gaps[1].transaction_hash == make_row(0xf0).transaction_hash);
+
+    // Popping the blocks from 50 leaves only the row below it, in the newest
+    // chunk, ahead of the emptied full chunk.
+    BOOST_REQUIRE(db.unlink(0x00000042, 50));
+    db.synchronize();
+    BOOST_REQUIRE_EQUAL(db.scan(filter, 0).size(), 1u);
+    BOOST_REQUIRE(db.scan(filter, 0).front().transaction_hash ==
+        make_row(0xf2).transaction_hash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -62,6 +62,29 @@ BOOST_AUTO_TEST_CASE(hash_table_header__test)
     BOOST_REQUIRE(header.read(9) == 110);
 }
 
+BOOST_AUTO_TEST_CASE(hash_table_header__start__other_version__false)
+{
+    typedef hash_table_header<uint32_t, uint32_t> header_type;
+    store::create(DIRECTORY "/hash_table_header_version");
+    memory_map file(DIRECTORY "/hash_table_header_version");
+    BOOST_REQUIRE(file.open());
+
+    header_type header(file, 10);
+    BOOST_REQUIRE(header.create());
+    BOOST_REQUIRE(header.start());
+
+    // Overwrite the version that follows the size.
+    {
+        const auto memory = file.access();
+        auto serial = make_unsafe_serializer(REMAP_ADDRESS(memory) +
+            sizeof(uint32_t));
+        serial.write_4_bytes_little_endian(header_type::version + 1);
+    }
+
+    header_type reopened(file, 10);
+    BOOST_REQUIRE(!reopened.start());
+}
+
 BOOST_AUTO_TEST_CASE(slab_manager__test)
 {
     store::create(DIRECTORY "/slab_manager");
@@ -148,5 +171,212 @@ BOOST_AUTO_TEST_CASE(record_list__test)
     recs.sync();
 }
 
+BOOST_AUTO_TEST_CASE(memory_map__take_dirty__ordered_and_coalesced)
+{
+    store::create(DIRECTORY "/memory_map_dirty");
+    memory_map file(DIRECTORY "/memory_map_dirty");
+    BOOST_REQUIRE(file.open());
+
+    // Not recorded unless tracking.
+    file.dirty(16, 8);
+    BOOST_REQUIRE(file.take_dirty().empty());
+
+    file.track(true);
+    file.dirty(32, 8);
+    file.dirty(16, 8);
+    file.dirty(24, 4);
+    file.dirty(36, 8);
+    file.dirty(64, 1);
+
+    const auto ranges = file.take_dirty();
+    BOOST_REQUIRE_EQUAL(ranges.size(), 3u);
+    BOOST_REQUIRE(ranges[0] == memory_map::range(16, 12));
+    BOOST_REQUIRE(ranges[1] == memory_map::range(32, 12));
+    BOOST_REQUIRE(ranges[2] == memory_map::range(64, 1));
+    BOOST_REQUIRE(file.take_dirty().empty());
+}
+
+BOOST_AUTO_TEST_CASE(memory_map__flush__written_pages_persist)
+{
+    const path data_path = DIRECTORY "/memory_map_flush";
+    store::create(data_path);
+
+    {
+        memory_map file(data_path);
+        BOOST_REQUIRE(file.open());
+        file.resize(3 * 4096 + 8);
+
+        // The written range spans a page boundary at the end of the file.
+        const size_t offset = 3 * 4096 - 4;
+        auto serial = make_unsafe_serializer(REMAP_ADDRESS(file.access()) +
+            offset);
+        serial.write_8_bytes_little_endian(42);
+        file.dirty(offset, sizeof(uint64_t));
+
+        BOOST_REQUIRE(file.flush());
+
+        // Nothing remains to be written.
+        BOOST_REQUIRE(file.flush());
+        BOOST_REQUIRE(file.close());
+    }
+
+    memory_map file(data_path);
+    BOOST_REQUIRE(file.open());
+    BOOST_REQUIRE_EQUAL(file.size(), 3u * 4096 + 8);
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+        REMAP_ADDRESS(file.access()) + 3 * 4096 - 4), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(memory_map__advise_header__resize_preserves_data)
+{
+    const path data_path = DIRECTORY "/memory_map_policy";
+    store::create(data_path);
+
+    mapping_policy policy;
+    policy.advice = mapping_policy::access::sequential;
+    policy.huge_pages = true;
+    policy.populate_header = true;
+    policy.lock_header = true;
+
+    memory_map file(data_path, nullptr, memory_map::default_expansion,
+        policy);
+    BOOST_REQUIRE(file.open());
+    file.resize(2 * 4096);
+    file.advise_header(4096);
+
+    {
+        auto serial = make_unsafe_serializer(REMAP_ADDRESS(file.access()) +
+            16);
+        serial.write_8_bytes_little_endian(42);
+    }
+
+    // The header hints are reapplied after the mapping grows.
+    file.resize(64 * 4096);
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+        REMAP_ADDRESS(file.access()) + 16), 42u);
+
+#ifdef __linux__
+    BOOST_REQUIRE_GT(file.resident(), 0u);
+#endif
+
+    BOOST_REQUIRE(file.close());
+}
+
+BOOST_AUTO_TEST_CASE(memory_map__reserve__grows_in_place_with_reader)
+{
+    const path data_path = DIRECTORY "/memory_map_reservation";
+    store::create(data_path);
+
+    mapping_policy policy;
+    policy.reservation = 64 * 4096;
+
+    memory_map file(data_path, nullptr, 0, policy);
+    BOOST_REQUIRE(file.open());
+    file.resize(4096 + 16);
+
+    uint8_t* base;
+
+    {
+        // The held reader would deadlock a growth that excludes readers.
+        const auto reader = file.access();
+        base = REMAP_ADDRESS(reader);
+        auto serial = make_unsafe_serializer(base + 4096);
+        serial.write_8_bytes_little_endian(42);
+
+        const auto memory = file.reserve(16 * 4096);
+        BOOST_REQUIRE(REMAP_ADDRESS(memory) == base);
+        BOOST_REQUIRE_EQUAL(file.size(), 16u * 4096);
+        BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+            REMAP_ADDRESS(memory) + 4096), 42u);
+
+        // The extension is writable.
+        auto extension = make_unsafe_serializer(REMAP_ADDRESS(memory) +
+            16 * 4096 - 8);
+        extension.write_8_bytes_little_endian(24);
+    }
+
+    // Growth beyond the reservation remaps.
+    file.resize(256 * 4096);
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+        REMAP_ADDRESS(file.access()) + 4096), 42u);
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+        REMAP_ADDRESS(file.access()) + 16 * 4096 - 8), 24u);
+    BOOST_REQUIRE(file.close());
+}
+
+BOOST_AUTO_TEST_CASE(memory_map__reserve__grows_in_whole_chunks)
+{
+    const path data_path = DIRECTORY "/memory_map_chunk";
+    store::create(data_path);
+
+    mapping_policy policy;
+    policy.allocation_chunk = 16 * 4096;
+
+    {
+        memory_map file(data_path, nullptr, memory_map::default_expansion,
+            policy);
+        BOOST_REQUIRE(file.open());
+
+        file.reserve(100);
+        BOOST_REQUIRE_EQUAL(file.size(), 16u * 4096);
+        BOOST_REQUIRE_EQUAL(file_size(data_path), 16u * 4096);
+
+        file.reserve(16 * 4096 + 1);
+        BOOST_REQUIRE_EQUAL(file.size(), 32u * 4096);
+        BOOST_REQUIRE_EQUAL(file_size(data_path), 32u * 4096);
+        BOOST_REQUIRE(file.close());
+    }
+
+    // The file is truncated to the logical size on close.
+    BOOST_REQUIRE_EQUAL(file_size(data_path), 16u * 4096 + 1);
+}
+
+BOOST_AUTO_TEST_CASE(journal__replay__restores_committed_writes)
+{
+    const path data_path = DIRECTORY "/journal_data";
+    const path journal_path = DIRECTORY "/journal";
+    store::create(data_path);
+
+    {
+        memory_map file(data_path);
+        BOOST_REQUIRE(file.open());
+
+        journal log(journal_path, 10);
+        log.attach(file);
+        BOOST_REQUIRE(log.open());
+
+        slab_manager manager(file, 0);
+        BOOST_REQUIRE(manager.create());
+        BOOST_REQUIRE(manager.start());
+
+        const auto position = manager.new_slab(sizeof(uint64_t));
+        BOOST_REQUIRE_EQUAL(position, 8u);
+        auto serial = make_unsafe_serializer(REMAP_ADDRESS(
+            manager.get(position)));
+        serial.write_8_bytes_little_endian(42);
+        manager.sync();
+        BOOST_REQUIRE(log.commit());
+
+        // Discard the writes from the file, as if they were never flushed.
+        memset(REMAP_ADDRESS(file.access()), 0, 2 * sizeof(uint64_t));
+        BOOST_REQUIRE(file.close());
+
+        // The journal is retained unless closed.
+    }
+
+    BOOST_REQUIRE(exists(journal_path));
+    BOOST_REQUIRE(journal::replay(journal_path));
+    BOOST_REQUIRE(!exists(journal_path));
+
+    memory_map file(data_path);
+    BOOST_REQUIRE(file.open());
+    slab_manager manager(file, 0);
+    BOOST_REQUIRE(manager.start());
+
+    const auto memory = manager.get(8);
+    BOOST_REQUIRE_EQUAL(from_little_endian_unsafe<uint64_t>(
+        REMAP_ADDRESS(memory)), 42u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -81,4 +81,227 @@ BOOST_AUTO_TEST_CASE(transaction_database__test)
     db.synchronize();
 }
 
+BOOST_AUTO_TEST_CASE(transaction_database__open_addressing__test)
+{
+    data_chunk raw_tx1;
+    BOOST_REQUIRE(decode_base16(raw_tx1, "0100000001537c9d05b5f7d67b09e5108e3bd5e466909cc9403ddd98bc42973f366fe729410600000000ffffffff0163000000000000001976a914fe06e7b4c88a719e92373de489c08244aee4520b88ac00000000"));
+
+    transaction tx1;
+    BOOST_REQUIRE(tx1.from_data(raw_tx1));
+
+    const auto h1 = tx1.hash();
+
+    data_chunk raw_tx2;
+    BOOST_REQUIRE(decode_base16(raw_tx2, "010000000147811c3fc0c0e750af5d0ea7343b16ea2d0c291c002e3db778669216eb689de80000000000ffffffff0118ddf505000000001976a914575c2f0ea88fcbad2389a372d942dea95addc25b88ac00000000"));
+
+    transaction tx2;
+    BOOST_REQUIRE(tx2.from_data(raw_tx2));
+
+    const auto h2 = tx2.hash();
+
+    store::create(DIRECTORY "/transaction_open");
+    transaction_database db(DIRECTORY "/transaction_open", 1000, 50, 0,
+        nullptr, true);
+    BOOST_REQUIRE(db.create());
+
+    BOOST_REQUIRE(db.reserve(2));
+    db.store(tx1, 110, 88);
+    db.store(tx2, 4, 6);
+
+    const auto result1 = db.get(h1, max_size_t, false);
+    BOOST_REQUIRE(result1.transaction().hash() == h1);
+    BOOST_REQUIRE_EQUAL(result1.height(), 110u);
+
+    const auto result2 = db.get(h2, max_size_t, false);
+    BOOST_REQUIRE(result2.transaction().hash() == h2);
+    BOOST_REQUIRE_EQUAL(result2.position(), 6u);
+
+    // Confirmed lookups are limited by the fork height.
+    BOOST_REQUIRE(!db.get(h1, 100, true));
+
+    db.synchronize();
+    BOOST_REQUIRE(db.close());
+
+    // The store is of the open kind, so it does not open as chained.
+    transaction_database chained(DIRECTORY "/transaction_open", 1000, 50, 0);
+    BOOST_REQUIRE(!chained.open());
+    BOOST_REQUIRE(chained.close());
+
+    // The stored txs are counted on open, and bound the reservation.
+    transaction_database reopened(DIRECTORY "/transaction_open", 1000, 50, 0,
+        nullptr, true);
+    BOOST_REQUIRE(reopened.open());
+    BOOST_REQUIRE(!reopened.reserve(999));
+    BOOST_REQUIRE(reopened.reserve(998));
+    BOOST_REQUIRE(!reopened.reserve(1));
+    reopened.release(998);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_database__get_outputs__test)
+{
+    data_chunk raw_tx1;
+    BOOST_REQUIRE(decode_base16(raw_tx1, "0100000001537c9d05b5f7d67b09e5108e3bd5e466909cc9403ddd98bc42973f366fe729410600000000ffffffff0163000000000000001976a914fe06e7b4c88a719e92373de489c08244aee4520b88ac00000000"));
+
+    transaction tx1;
+    BOOST_REQUIRE(tx1.from_data(raw_tx1));
+
+    data_chunk raw_tx2;
+    BOOST_REQUIRE(decode_base16(raw_tx2, "010000000147811c3fc0c0e750af5d0ea7343b16ea2d0c291c002e3db778669216eb689de80000000000ffffffff0118ddf505000000001976a914575c2f0ea88fcbad2389a372d942dea95addc25b88ac00000000"));
+
+    transaction tx2;
+    BOOST_REQUIRE(tx2.from_data(raw_tx2));
+
+    store::create(DIRECTORY "/transaction_outputs");
+    transaction_database db(DIRECTORY "/transaction_outputs", 1000, 50, 0);
+    BOOST_REQUIRE(db.create());
+
+    db.store(tx1, 110, 88);
+    db.store(tx2, 4, 0);
+
+    const output_point::list points
+    {
+        { tx1.hash(), 0 },
+        { null_hash, 0 },
+        { tx2.hash(), 0 }
+    };
+
+    transaction_database::output_results results;
+    db.get_outputs(results, points, max_size_t, false);
+    BOOST_REQUIRE_EQUAL(results.size(), 3u);
+
+    BOOST_REQUIRE(results[0].found);
+    BOOST_REQUIRE_EQUAL(results[0].output.value(), tx1.outputs()[0].value());
+    BOOST_REQUIRE_EQUAL(results[0].height, 110u);
+    BOOST_REQUIRE(!results[0].coinbase);
+
+    BOOST_REQUIRE(!results[1].found);
+
+    BOOST_REQUIRE(results[2].found);
+    BOOST_REQUIRE_EQUAL(results[2].output.value(), tx2.outputs()[0].value());
+    BOOST_REQUIRE_EQUAL(results[2].height, 4u);
+    BOOST_REQUIRE(results[2].coinbase);
+    BOOST_REQUIRE(results[2].confirmed);
+
+    // Confirmed lookups are limited by the fork height.
+    db.get_outputs(results, points, 100, true);
+    BOOST_REQUIRE(!results[0].found);
+    BOOST_REQUIRE(results[2].found);
+
+    db.synchronize();
+}
+
+BOOST_AUTO_TEST_CASE(transaction_database__spend__test)
+{
+    data_chunk raw_tx1;
+    BOOST_REQUIRE(decode_base16(raw_tx1, "0100000001537c9d05b5f7d67b09e5108e3bd5e466909cc9403ddd98bc42973f366fe729410600000000ffffffff0163000000000000001976a914fe06e7b4c88a719e92373de489c08244aee4520b88ac00000000"));
+
+    transaction tx1;
+    BOOST_REQUIRE(tx1.from_data(raw_tx1));
+
+    const auto h1 = tx1.hash();
+
+    store::create(DIRECTORY "/transaction_spend");
+    transaction_database db(DIRECTORY "/transaction_spend", 1000, 50, 0);
+    BOOST_REQUIRE(db.create());
+
+    db.store(tx1, 110, 88);
+    BOOST_REQUIRE(!db.get(h1, max_size_t, false).is_spent(max_size_t));
+
+    // The index is not in the transaction.
+    BOOST_REQUIRE(!db.spend({ h1, 1 }, 120));
+
+    BOOST_REQUIRE(db.spend({ h1, 0 }, 120));
+    const auto spent = db.get(h1, max_size_t, false);
+    BOOST_REQUIRE_EQUAL(spent.output(0).validation.spender_height, 120u);
+    BOOST_REQUIRE_EQUAL(spent.output(0).value(), tx1.outputs()[0].value());
+    BOOST_REQUIRE(spent.is_spent(max_size_t));
+    BOOST_REQUIRE(!spent.is_spent(119));
+    BOOST_REQUIRE(spent.transaction().hash() == h1);
+
+    BOOST_REQUIRE(db.unspend({ h1, 0 }));
+    BOOST_REQUIRE(!db.get(h1, max_size_t, false).is_spent(max_size_t));
+
+    db.synchronize();
+}
+
+static transaction make_multiple_transaction()
+{
+    const auto previous1 = hash_literal("4129e76f363f9742bc98dd3d40c99c9066e4d53b8e10e5097bd6f7b5059d7c53");
+    const auto previous2 = hash_literal("eefa5d23968584be9d8d064bcf99c24666e4d53b8e10e5097bd6f7b5059d7c53");
+    const short_hash address = base16_literal("a006500b7ddfd568e2b036c65a4f4d6aaa0cbd9b");
+
+    const input::list inputs
+    {
+        { { previous1, 0 }, script::to_null_data_pattern(data_chunk{ 1 }), 0xffffffff },
+        { { previous2, 7 }, script::to_null_data_pattern(data_chunk(100, 2)), 42 },
+        { { previous1, 3 }, script{}, 0 }
+    };
+
+    const output::list outputs
+    {
+        { 1000, script::to_pay_key_hash_pattern(address) },
+        { 2000, script::to_null_data_pattern(data_chunk{ 3 }) },
+        { 3000, script::to_pay_key_hash_pattern(address) }
+    };
+
+    return { 1, 0, inputs, outputs };
+}
+
+BOOST_AUTO_TEST_CASE(transaction_database__result__multiple_inputs_outputs__round_trip)
+{
+    const auto tx = make_multiple_transaction();
+    const auto hash = tx.hash();
+
+    store::create(DIRECTORY "/transaction_result");
+    transaction_database db(DIRECTORY "/transaction_result", 1000, 50, 0);
+    BOOST_REQUIRE(db.create());
+
+    db.store(tx, 110, 88);
+    BOOST_REQUIRE(db.spend({ hash, 1 }, 120));
+
+    const auto result = db.get(hash, max_size_t, false);
+    BOOST_REQUIRE(result);
+    BOOST_REQUIRE(result.previous_outputs() == tx.previous_outputs());
+    BOOST_REQUIRE(result.inputs() == tx.inputs());
+
+    const auto outputs = result.outputs();
+    BOOST_REQUIRE(outputs == tx.outputs());
+    BOOST_REQUIRE_EQUAL(outputs[0].validation.spender_height, output::validation::not_spent);
+    BOOST_REQUIRE_EQUAL(outputs[1].validation.spender_height, 120u);
+    BOOST_REQUIRE_EQUAL(outputs[2].validation.spender_height, output::validation::not_spent);
+
+    db.synchronize();
+}
+
+BOOST_AUTO_TEST_CASE(transaction_unconfirmed_database__store_result__multiple_inputs_outputs__round_trip)
+{
+    const auto tx = make_multiple_transaction();
+    const auto hash = tx.hash();
+
+    store::create(DIRECTORY "/transaction_result_confirmed");
+    transaction_database db(DIRECTORY "/transaction_result_confirmed", 1000, 50, 0);
+    BOOST_REQUIRE(db.create());
+
+    store::create(DIRECTORY "/transaction_result_unconfirmed");
+    transaction_unconfirmed_database pool(DIRECTORY "/transaction_result_unconfirmed", 1000, 50);
+    BOOST_REQUIRE(pool.create());
+
+    db.store(tx, 110, 88);
+    BOOST_REQUIRE(db.spend({ hash, 2 }, 130));
+    db.synchronize();
+
+    // The stored transaction is copied without deserialization.
+    const auto result = db.get(hash, max_size_t, false);
+    BOOST_REQUIRE(result);
+    pool.store(result);
+    pool.synchronize();
+
+    const auto stored = pool.get(hash);
+    BOOST_REQUIRE(stored);
+    BOOST_REQUIRE(stored.transaction() == tx);
+    BOOST_REQUIRE(stored.previous_outputs() == tx.previous_outputs());
+    BOOST_REQUIRE_EQUAL(stored.output(0).validation.spender_height, output::validation::not_spent);
+    BOOST_REQUIRE_EQUAL(stored.output(2).validation.spender_height, 130u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
  */
 #include <boost/test/unit_test.hpp>
 
+#include <boost/filesystem.hpp>
 #include <bitcoin/database.hpp>
 
 using namespace bc;
@@ -176,4 +177,169 @@ BOOST_AUTO_TEST_CASE(unspent_outputs__get__two_capacity_1__size_1_expected)
     BOOST_REQUIRE_EQUAL(out_value2b.value(), expected2b);
 }
 
+BOOST_AUTO_TEST_CASE(unspent_outputs__shards__capacity_1__1)
+{
+    const unspent_outputs cache(1);
+    BOOST_REQUIRE_EQUAL(cache.shards(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__shards__capacity_42__max_shards)
+{
+    const unspent_outputs cache(42);
+    BOOST_REQUIRE_EQUAL(cache.shards(), unspent_outputs::max_shards);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__add__over_capacity_42__size_not_above_42)
+{
+    unspent_outputs cache(42);
+
+    for (uint32_t locktime = 0; locktime < 100; ++locktime)
+        cache.add({ 0, locktime, {}, { {} } }, 0, false);
+
+    BOOST_REQUIRE_LE(cache.size(), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__hits__get__counted_in_one_shard)
+{
+    static const transaction tx{ 0, 0, {}, { {} } };
+    unspent_outputs cache(42);
+    cache.add(tx, 0, false);
+
+    bool out_coinbase;
+    size_t out_height;
+    chain::output out_value;
+    BOOST_REQUIRE(cache.get(out_value, out_height, out_coinbase, { tx.hash(), 0 }, max_size_t, false));
+    BOOST_REQUIRE(!cache.get(out_value, out_height, out_coinbase, { tx.hash(), 1 }, max_size_t, false));
+
+    size_t hits = 0;
+    size_t queries = 0;
+
+    for (size_t shard = 0; shard < cache.shards(); ++shard)
+    {
+        hits += cache.hits(shard);
+        queries += cache.queries(shard);
+        BOOST_REQUIRE(cache.queries(shard) == 0 || cache.queries(shard) == 2);
+    }
+
+    BOOST_REQUIRE_EQUAL(hits, 1u);
+    BOOST_REQUIRE_EQUAL(queries, 2u);
+    BOOST_REQUIRE_EQUAL(cache.hit_rate(), 2.0f / 3.0f);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__evictions__two_capacity_1__1)
+{
+    static const transaction tx1{ 0, 0, {}, { {} } };
+    static const transaction tx2{ 0, 1, {}, { {} } };
+    unspent_outputs cache(1);
+    cache.add(tx1, 0, false);
+    cache.add(tx2, 0, false);
+    BOOST_REQUIRE_EQUAL(cache.size(), 1u);
+    BOOST_REQUIRE_EQUAL(cache.evictions(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__bytes__add_remove__zero)
+{
+    static const transaction tx{ 0, 0, {}, { {}, {} } };
+    unspent_outputs cache(42, 1000000);
+    BOOST_REQUIRE_EQUAL(cache.bytes(), 0u);
+
+    cache.add(tx, 0, false);
+    BOOST_REQUIRE_GT(cache.bytes(), 0u);
+
+    cache.remove({ tx.hash(), 0 });
+    BOOST_REQUIRE_GT(cache.bytes(), 0u);
+
+    cache.remove({ tx.hash(), 1 });
+    BOOST_REQUIRE(cache.empty());
+    BOOST_REQUIRE_EQUAL(cache.bytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__add__over_budget__not_admitted)
+{
+    static const transaction tx{ 0, 0, {}, { {} } };
+    unspent_outputs cache(1, 1);
+    cache.add(tx, 0, false);
+    BOOST_REQUIRE(cache.empty());
+    BOOST_REQUIRE_EQUAL(cache.evictions(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__add__budget__bytes_within_budget)
+{
+    static const size_t budget = 64 * 1024;
+    unspent_outputs cache(1000, budget, eviction_policy::clock);
+
+    for (uint32_t locktime = 0; locktime < 1000; ++locktime)
+        cache.add({ 0, locktime, {}, { {} } }, 0, false);
+
+    BOOST_REQUIRE_GT(cache.evictions(), 0u);
+    BOOST_REQUIRE_LE(cache.bytes(), budget);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__get__policies__found)
+{
+    static const transaction tx{ 0, 0, {}, { { 42, {} } } };
+
+    for (const auto policy: { eviction_policy::fifo, eviction_policy::lru,
+        eviction_policy::clock, eviction_policy::young })
+    {
+        unspent_outputs cache(42, 0, policy);
+        cache.add(tx, 7, true);
+
+        bool out_coinbase;
+        size_t out_height;
+        chain::output out_value;
+        BOOST_REQUIRE(cache.get(out_value, out_height, out_coinbase, { tx.hash(), 0 }, max_size_t, true));
+        BOOST_REQUIRE_EQUAL(out_value.value(), 42u);
+        BOOST_REQUIRE_EQUAL(out_height, 7u);
+        BOOST_REQUIRE(cache.get(out_value, out_height, out_coinbase, { tx.hash(), 0 }, max_size_t, true));
+        BOOST_REQUIRE(!cache.get(out_value, out_height, out_coinbase, { tx.hash(), 0 }, 6, true));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__load__saved__expected_outputs)
+{
+    static const transaction tx1{ 0, 0, {}, { { 41, {} }, { 42, {} } } };
+    static const transaction tx2{ 0, 1, {}, { { 43, {} } } };
+    static const config::checkpoint top{ null_hash, 7 };
+    static const auto file = "unspent_outputs__snapshot";
+    unspent_outputs saved(42);
+    saved.add(tx1, 5, true);
+    saved.add(tx2, 6, false);
+    saved.remove({ tx1.hash(), 0 });
+    BOOST_REQUIRE(saved.save(file, top));
+
+    unspent_outputs cache(42);
+    BOOST_REQUIRE(cache.load(file, top));
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+    BOOST_REQUIRE_EQUAL(cache.size(), 2u);
+    BOOST_REQUIRE_EQUAL(cache.bytes(), saved.bytes());
+
+    bool out_coinbase;
+    bool out_confirmed;
+    size_t out_height;
+    chain::output out_value;
+    BOOST_REQUIRE(!cache.get(out_value, out_height, out_coinbase, { tx1.hash(), 0 }, max_size_t, false));
+    BOOST_REQUIRE(cache.get_is_confirmed(out_value, out_height, out_coinbase, out_confirmed, { tx1.hash(), 1 }, max_size_t, false));
+    BOOST_REQUIRE_EQUAL(out_value.value(), 42u);
+    BOOST_REQUIRE_EQUAL(out_height, 5u);
+    BOOST_REQUIRE(out_confirmed);
+    BOOST_REQUIRE(cache.get_is_confirmed(out_value, out_height, out_coinbase, out_confirmed, { tx2.hash(), 0 }, max_size_t, false));
+    BOOST_REQUIRE_EQUAL(out_value.value(), 43u);
+    BOOST_REQUIRE(!out_confirmed);
+}
+
+BOOST_AUTO_TEST_CASE(unspent_outputs__load__other_top__empty)
+{
+    static const transaction tx{ 0, 0, {}, { {} } };
+    static const auto file = "unspent_outputs__stale_snapshot";
+    unspent_outputs saved(42);
+    saved.add(tx, 0, true);
+    BOOST_REQUIRE(saved.save(file, { null_hash, 7 }));
+
+    unspent_outputs cache(42);
+    BOOST_REQUIRE(!cache.load(file, { null_hash, 8 }));
+    BOOST_REQUIRE(!boost::filesystem::exists(file));
+    BOOST_REQUIRE(cache.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
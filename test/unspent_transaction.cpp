@@ -103,6 +103,33 @@ BOOST_AUTO_TEST_CASE(unspent_transaction__outputs__construct3_single_output_tx__
     BOOST_REQUIRE_EQUAL(unspent_transaction(tx, 0, false).outputs()->size(), 1u);
 }
 
+BOOST_AUTO_TEST_CASE(unspent_transaction__remove__outputs__others_found)
+{
+    static const transaction tx{ 0, 0, {}, { { 0, {} }, { 1, {} }, { 2, {} }, { 3, {} }, { 4, {} } } };
+    const unspent_transaction instance(tx, 0, false);
+    BOOST_REQUIRE_EQUAL(instance.size(), 5u);
+
+    // Below half removed the outputs are marked in place.
+    BOOST_REQUIRE(instance.remove(1));
+    BOOST_REQUIRE(!instance.remove(1));
+    BOOST_REQUIRE(!instance.remove(5));
+    BOOST_REQUIRE(instance.find(1) == nullptr);
+    BOOST_REQUIRE(instance.removed(1));
+    BOOST_REQUIRE_EQUAL(instance.outputs()->size(), 5u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 4u);
+
+    // At half removed the outputs are compacted.
+    BOOST_REQUIRE(instance.remove(3));
+    BOOST_REQUIRE(instance.remove(0));
+    BOOST_REQUIRE_EQUAL(instance.outputs()->size(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+    BOOST_REQUIRE(!instance.removed(0));
+    BOOST_REQUIRE(instance.find(0) == nullptr);
+    BOOST_REQUIRE(instance.find(3) == nullptr);
+    BOOST_REQUIRE_EQUAL(instance.find(2)->value(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.find(4)->value(), 4u);
+}
+
 BOOST_AUTO_TEST_CASE(unspent_transaction__equal__tx_hash_only__true)
 {
     static const transaction tx;
@@ -0,0 +1,758 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <bitcoin/database.hpp>
+
+using namespace boost;
+using namespace bc;
+using namespace bc::database;
+
+typedef std::chrono::steady_clock clock_type;
+typedef boost::filesystem::path path;
+typedef std::vector<hash_digest> keys;
+
+void show_help()
+{
+    std::cout << "Usage: benchmark COMMAND DIRECTORY [ARGS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "The most commonly used benchmark commands are:" << std::endl;
+    std::cout << "  lookup          " << "Hash table lookup throughput by thread count" << std::endl;
+    std::cout << "  bucket          " << "Bucket index and lookup cost by database" << std::endl;
+    std::cout << "  index           " << "History and stealth indexing throughput by block" << std::endl;
+    std::cout << "  latency         " << "Read latency percentiles of the top blocks of a store" << std::endl;
+    std::cout << "  stealth         " << "Stealth scan throughput by filter length" << std::endl;
+    std::cout << "  help            " << "Show help for commands" << std::endl;
+}
+
+void show_command_help(const std::string& command)
+{
+    if (command == "lookup")
+    {
+        std::cout << "Usage: benchmark " << command << " DIRECTORY "
+            << "MAX_THREADS KEYS BUCKETS" << std::endl;
+    }
+    else if (command == "bucket")
+    {
+        std::cout << "Usage: benchmark " << command << " DIRECTORY "
+            << "KEYS BUCKETS" << std::endl;
+    }
+    else if (command == "index")
+    {
+        std::cout << "Usage: benchmark " << command << " DIRECTORY "
+            << "BLOCKS TRANSACTIONS" << std::endl;
+    }
+    else if (command == "latency")
+    {
+        std::cout << "Usage: benchmark " << command << " DIRECTORY "
+            << "BLOCKS" << std::endl;
+    }
+    else if (command == "stealth")
+    {
+        std::cout << "Usage: benchmark " << command << " DIRECTORY "
+            << "ROWS" << std::endl;
+    }
+    else
+    {
+        std::cout << "No help available for " << command << std::endl;
+    }
+}
+
+template <typename Uint>
+bool parse_uint(Uint& value, const std::string& arg)
+{
+    try
+    {
+        value = lexical_cast<Uint>(arg);
+    }
+    catch (const bad_lexical_cast&)
+    {
+        std::cerr << "benchmark: bad value provided." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Deterministic keys, spread uniformly over the buckets.
+hash_digest make_key(size_t index)
+{
+    hash_digest key = null_hash;
+    auto serial = make_unsafe_serializer(key.begin());
+    serial.write_8_bytes_little_endian(index * 0x9e3779b97f4a7c15);
+    serial.write_8_bytes_little_endian(index);
+    return key;
+}
+
+keys make_keys(size_t count)
+{
+    keys result;
+    result.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+        result.push_back(make_key(index));
+
+    return result;
+}
+
+// Run the reader on each of the thread count and return lookups per second.
+template <typename Keys, typename Reader>
+double measure(size_t threads, const Keys& keys, Reader reader)
+{
+    std::vector<std::thread> pool;
+    const auto start = clock_type::now();
+
+    for (size_t thread = 0; thread < threads; ++thread)
+        pool.emplace_back([&keys, &reader, thread, threads]()
+        {
+            // Each thread walks all keys from a different starting point.
+            const auto offset = thread * (keys.size() / threads);
+            for (size_t index = 0; index < keys.size(); ++index)
+                reader(keys[(offset + index) % keys.size()]);
+        });
+
+    for (auto& thread: pool)
+        thread.join();
+
+    const auto elapsed = std::chrono::duration<double>(
+        clock_type::now() - start).count();
+
+    return (threads * keys.size()) / elapsed;
+}
+
+int lookup(const std::string& directory, size_t max_threads, size_t count,
+    array_index buckets)
+{
+    const auto filename = directory + "/benchmark_lookup";
+    const auto header_size = slab_hash_table_header_size(buckets);
+    static const size_t value_size = sizeof(uint64_t);
+
+    store::create(filename);
+    memory_map file(filename);
+
+    if (!file.open())
+    {
+        std::cerr << "benchmark: unable to open " << filename << std::endl;
+        return -1;
+    }
+
+    file.resize(header_size + minimum_slabs_size);
+    slab_hash_table_header header(file, buckets);
+    slab_manager manager(file, header_size);
+
+    if (!header.create() || !header.start() || !manager.create() ||
+        !manager.start())
+    {
+        std::cerr << "benchmark: unable to create table." << std::endl;
+        return -1;
+    }
+
+    slab_hash_table<hash_digest> table(header, manager);
+    const auto all_keys = make_keys(count);
+
+    for (size_t index = 0; index < all_keys.size(); ++index)
+    {
+        const auto write = [index](serializer<uint8_t*>& serial)
+        {
+            serial.write_8_bytes_little_endian(index);
+        };
+
+        table.store(all_keys[index], write, value_size);
+    }
+
+    manager.sync();
+
+    // The previous header implementation took a table-wide shared lock for
+    // each bucket read, which is emulated here as the baseline.
+    shared_mutex header_mutex;
+    const auto locked = [&](const hash_digest& key)
+    {
+        bc::shared_lock lock(header_mutex);
+        return table.find(key) != nullptr;
+    };
+
+    const auto atomic = [&](const hash_digest& key)
+    {
+        return table.find(key) != nullptr;
+    };
+
+    std::cout << "threads, locked (lookups/s), atomic (lookups/s)"
+        << std::endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        const auto before = measure(threads, all_keys, locked);
+        const auto after = measure(threads, all_keys, atomic);
+        std::cout << threads << ", " << std::fixed << std::setprecision(0)
+            << before << ", " << after << std::endl;
+    }
+
+    file.close();
+    boost::filesystem::remove(filename);
+    return 0;
+}
+
+// Bucket indexes per second by std::hash modulo and by the key's policy.
+template <typename KeyType>
+void show_bucket(const std::string& name, const std::vector<KeyType>& keys,
+    array_index buckets, double lookups)
+{
+    typedef bucket_policy<KeyType> policy;
+    volatile size_t sink = 0;
+
+    const auto modulo = measure(1, keys, [&](const KeyType& key)
+    {
+        sink = sink + std::hash<KeyType>()(key) % buckets;
+    });
+
+    const auto reduced = measure(1, keys, [&](const KeyType& key)
+    {
+        sink = sink + policy::reduction::reduce(policy::hash(key), buckets);
+    });
+
+    std::cout << name << ", " << std::fixed << std::setprecision(0)
+        << modulo << ", " << reduced << ", " << lookups << std::endl;
+}
+
+int bucket(const std::string& directory, size_t count, array_index buckets)
+{
+    static BC_CONSTEXPR size_t expansion = 50;
+    static BC_CONSTEXPR size_t outputs = 4;
+    const path transactions_file = directory + "/benchmark_transaction_table";
+    const path spends_file = directory + "/benchmark_spend_table";
+    const path history_file = directory + "/benchmark_history_table";
+    const path rows_file = directory + "/benchmark_history_rows";
+
+    for (const auto& file: { transactions_file, spends_file, history_file,
+        rows_file })
+        store::create(file);
+
+    transaction_database transactions(transactions_file, buckets, expansion,
+        0);
+    spend_database spends(spends_file, buckets, expansion);
+    history_database history(history_file, rows_file, buckets, expansion);
+
+    if (!transactions.create() || !spends.create() || !history.create())
+    {
+        std::cerr << "benchmark: unable to create databases." << std::endl;
+        return -1;
+    }
+
+    const auto hashes = make_keys(count);
+    std::vector<hash_digest> tx_hashes;
+    std::vector<chain::output_point> points;
+    std::vector<short_hash> addresses;
+    tx_hashes.reserve(count);
+    points.reserve(count);
+    addresses.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        // Distinct lock times produce distinct transaction hashes.
+        const chain::transaction tx(1, static_cast<uint32_t>(index),
+            chain::input::list{}, chain::output::list{});
+        transactions.store(tx, index, 0);
+        tx_hashes.push_back(tx.hash());
+
+        // Outputs of a transaction share its hash.
+        const chain::output_point point(hashes[index / outputs],
+            index % outputs);
+        spends.store(point, { hashes[index], 0 });
+        points.push_back(point);
+
+        short_hash address;
+        std::copy_n(hashes[index].begin(), address.size(), address.begin());
+        history.add_output(address, point, index, index);
+        addresses.push_back(address);
+    }
+
+    transactions.synchronize();
+    spends.synchronize();
+    history.synchronize();
+
+    const auto transaction_lookups = measure(1, tx_hashes,
+        [&](const hash_digest& key)
+        {
+            return static_cast<bool>(transactions.get(key, max_size_t, false));
+        });
+
+    const auto spend_lookups = measure(1, points,
+        [&](const chain::output_point& key)
+        {
+            return spends.get(key).is_valid();
+        });
+
+    const auto history_lookups = measure(1, addresses,
+        [&](const short_hash& key)
+        {
+            return !history.get(key, 1, 0).empty();
+        });
+
+    std::cout << "database, std::hash modulo (indexes/s), "
+        << "policy (indexes/s), database (lookups/s)" << std::endl;
+
+    show_bucket("transaction", tx_hashes, buckets, transaction_lookups);
+    show_bucket("spend", points, buckets, spend_lookups);
+    show_bucket("history", addresses, buckets, history_lookups);
+
+    transactions.close();
+    spends.close();
+    history.close();
+
+    for (const auto& file: { transactions_file, spends_file, history_file,
+        rows_file })
+        boost::filesystem::remove(file);
+
+    return 0;
+}
+
+// Each transaction pays three addresses, the first of which is also a stealth
+// payment (the ephemeral key is carried by a preceding null data output).
+chain::block make_block(size_t height, size_t transactions)
+{
+    chain::transaction::list txs;
+    txs.reserve(transactions);
+
+    for (size_t index = 0; index < transactions; ++index)
+    {
+        const auto key = make_key(height * transactions + index);
+        short_hash address;
+        std::copy_n(key.begin(), address.size(), address.begin());
+
+        const data_chunk ephemeral(key.begin(), key.end());
+        const chain::script stealth(
+            chain::script::to_null_data_pattern(ephemeral));
+        const chain::script payment(
+            chain::script::to_pay_key_hash_pattern(address));
+
+        chain::output::list outputs
+        {
+            { 0, stealth },
+            { 1, payment },
+            { 2, payment },
+            { 3, payment }
+        };
+
+        txs.emplace_back(1, static_cast<uint32_t>(index),
+            chain::input::list{}, std::move(outputs));
+    }
+
+    return { chain::header{}, std::move(txs) };
+}
+
+// The indexing of a transaction before the addresses were decoded once.
+void index_outputs(history_database& history, stealth_database& stealth,
+    const chain::transaction& tx, size_t height)
+{
+    const auto tx_hash = tx.hash();
+    const auto& outputs = tx.outputs();
+
+    for (uint32_t index = 0; index < outputs.size(); ++index)
+    {
+        const auto address = outputs[index].address();
+        if (address)
+            history.add_output(address.hash(), { tx_hash, index }, height,
+                outputs[index].value());
+    }
+
+    for (size_t index = 0; index < (outputs.size() - 1); ++index)
+    {
+        const auto& ephemeral_script = outputs[index].script();
+        const auto address = outputs[index + 1].address();
+        if (!address)
+            continue;
+
+        hash_digest unsigned_ephemeral_key;
+        if (!wallet::extract_ephemeral_key(unsigned_ephemeral_key,
+            ephemeral_script))
+            continue;
+
+        uint32_t prefix;
+        if (!wallet::to_stealth_prefix(prefix, ephemeral_script))
+            continue;
+
+        stealth.store(prefix, height,
+            { unsigned_ephemeral_key, address.hash(), tx_hash });
+    }
+}
+
+// The indexing of a transaction from its decoded addresses.
+void index_decoded(history_database& history, stealth_database& stealth,
+    const chain::transaction& tx, size_t height)
+{
+    const decoded_transaction decoded(tx);
+    const auto& outputs = tx.outputs();
+
+    for (const auto& address: decoded.outputs())
+        history.add_output(address.second, { decoded.hash(), address.first },
+            height, outputs[address.first].value());
+
+    for (const auto& row: decoded.stealth_rows())
+        stealth.store(row.prefix, height, row.row);
+}
+
+template <typename Indexer>
+double index_blocks(const std::string& directory, const std::string& name,
+    const std::vector<chain::block>& blocks, Indexer indexer)
+{
+    static BC_CONSTEXPR size_t expansion = 50;
+    static BC_CONSTEXPR array_index buckets = 1000;
+    const path history_file = directory + "/benchmark_" + name + "_table";
+    const path rows_file = directory + "/benchmark_" + name + "_rows";
+    const path stealth_file = directory + "/benchmark_" + name + "_stealth";
+
+    for (const auto& file: { history_file, rows_file, stealth_file })
+        store::create(file);
+
+    history_database history(history_file, rows_file, buckets, expansion);
+    stealth_database stealth(stealth_file, expansion);
+
+    if (!history.create() || !stealth.create())
+    {
+        std::cerr << "benchmark: unable to create databases." << std::endl;
+        return 0;
+    }
+
+    const auto start = clock_type::now();
+
+    for (size_t height = 0; height < blocks.size(); ++height)
+    {
+        for (const auto& tx: blocks[height].transactions())
+            indexer(history, stealth, tx, height);
+
+        history.synchronize();
+        stealth.synchronize();
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+        clock_type::now() - start).count();
+
+    history.close();
+    stealth.close();
+
+    for (const auto& file: { history_file, rows_file, stealth_file })
+        boost::filesystem::remove(file);
+
+    return blocks.size() / elapsed;
+}
+
+int indexing(const std::string& directory, size_t count,
+    size_t transactions)
+{
+    std::vector<chain::block> blocks;
+    blocks.reserve(count);
+
+    for (size_t height = 0; height < count; ++height)
+        blocks.push_back(make_block(height, transactions));
+
+    const auto before = index_blocks(directory, "outputs", blocks,
+        index_outputs);
+    const auto after = index_blocks(directory, "decoded", blocks,
+        index_decoded);
+
+    if (before == 0 || after == 0)
+        return -1;
+
+    std::cout << "transactions, per output (blocks/s), decoded (blocks/s)"
+        << std::endl;
+    std::cout << transactions << ", " << std::fixed << std::setprecision(0)
+        << before << ", " << after << std::endl;
+    return 0;
+}
+
+// Read the transactions of the top blocks and their previous outputs, as in
+// validation, from a store that is not otherwise in use.
+int read_latency(const std::string& directory, size_t count)
+{
+    database::settings settings;
+    settings.directory = directory;
+    data_base store(settings);
+
+    if (!store.open())
+    {
+        std::cerr << "benchmark: unable to open " << directory << std::endl;
+        return -1;
+    }
+
+    size_t top;
+    if (!store.blocks().top(top))
+    {
+        std::cerr << "benchmark: the store is empty." << std::endl;
+        return -1;
+    }
+
+    // Opening the store may have grown its files.
+    store.reset_latencies();
+    const auto& transactions = store.transactions();
+    const auto first = top >= count ? top - count + 1 : 0;
+
+    for (auto height = first; height <= top; ++height)
+    {
+        const auto block = store.blocks().get(height);
+
+        for (size_t position = 0; position < block.transaction_count();
+            ++position)
+        {
+            const auto tx = transactions.get(block.transaction_hash(position),
+                max_size_t, true);
+
+            if (!tx || position == 0)
+                continue;
+
+            chain::output output;
+            size_t output_height;
+            bool coinbase;
+
+            for (const auto& point: tx.previous_outputs())
+                transactions.get_output(output, output_height, coinbase,
+                    point, height, true);
+        }
+    }
+
+    for (const auto& latency: store.latencies())
+        std::cout << latency << std::endl;
+
+    return store.close() ? 0 : -1;
+}
+
+// Scan a synthetic stealth table over its full height range and over its top
+// heights. The linear scan of the prefix and height words of all rows (as in
+// the unindexed table) is emulated in memory as the baseline.
+int stealth(const std::string& directory, size_t count)
+{
+    static BC_CONSTEXPR size_t expansion = 50;
+    static BC_CONSTEXPR size_t rows_per_height = 100;
+    static BC_CONSTEXPR size_t top_heights = 1000;
+    static BC_CONSTEXPR size_t scans = 10;
+    const path filename = directory + "/benchmark_stealth_rows";
+
+    store::create(filename);
+    stealth_database table(filename, expansion);
+
+    if (!table.create())
+    {
+        std::cerr << "benchmark: unable to create table." << std::endl;
+        return -1;
+    }
+
+    std::vector<uint32_t> prefixes;
+    prefixes.reserve(count);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto key = make_key(index);
+        const auto prefix = from_little_endian_unsafe<uint32_t>(key.begin());
+        const auto height = static_cast<uint32_t>(index / rows_per_height);
+        table.store(prefix, height, { key, short_hash{}, key });
+        prefixes.push_back(prefix);
+    }
+
+    table.synchronize();
+
+    const auto top = (count - 1) / rows_per_height;
+    const auto recent = top >= top_heights ? top - top_heights + 1 : 0;
+    const auto leading = to_little_endian(prefixes.front());
+
+    std::cout << "filter bits, from height, matches, linear (scans/s), "
+        << "indexed (scans/s)" << std::endl;
+
+    for (const auto bits: { 4u, 8u, 16u, 32u })
+    {
+        const binary filter(bits, leading);
+
+        for (const auto from_height: { size_t(0), recent })
+        {
+            volatile size_t sink = 0;
+            auto start = clock_type::now();
+
+            for (size_t scan = 0; scan < scans; ++scan)
+                for (size_t row = 0; row < count; ++row)
+                    if (row / rows_per_height >= from_height &&
+                        filter.is_prefix_of(prefixes[row]))
+                        sink = sink + 1;
+
+            const auto linear = scans / std::chrono::duration<double>(
+                clock_type::now() - start).count();
+
+            size_t matches = 0;
+            start = clock_type::now();
+
+            for (size_t scan = 0; scan < scans; ++scan)
+                matches = table.scan(filter, from_height).size();
+
+            const auto indexed = scans / std::chrono::duration<double>(
+                clock_type::now() - start).count();
+
+            std::cout << bits << ", " << from_height << ", " << matches
+                << ", " << std::fixed << std::setprecision(1) << linear
+                << ", " << indexed << std::endl;
+        }
+    }
+
+    table.close();
+    boost::filesystem::remove(filename);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    typedef std::vector<std::string> string_list;
+
+    if (argc < 2)
+    {
+        show_help();
+        return -1;
+    }
+
+    const std::string command = argv[1];
+
+    if (command == "help" || command == "-h" || command == "--help")
+    {
+        if (argc == 3)
+        {
+            show_command_help(argv[2]);
+            return 0;
+        }
+
+        show_help();
+        return 0;
+    }
+
+    if (argc < 3)
+    {
+        show_command_help(command);
+        return -1;
+    }
+
+    string_list args;
+    const std::string directory = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+        args.push_back(argv[i]);
+
+    if (command == "lookup")
+    {
+        if (args.size() != 3)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        size_t max_threads;
+        size_t count;
+        array_index buckets;
+
+        if (!parse_uint(max_threads, args[0]) || !parse_uint(count, args[1]) ||
+            !parse_uint(buckets, args[2]))
+            return -1;
+
+        if (max_threads == 0 || count == 0 || buckets == 0)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        return lookup(directory, max_threads, count, buckets);
+    }
+
+    if (command == "bucket")
+    {
+        if (args.size() != 2)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        size_t count;
+        array_index buckets;
+
+        if (!parse_uint(count, args[0]) || !parse_uint(buckets, args[1]))
+            return -1;
+
+        if (count == 0 || buckets == 0)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        return bucket(directory, count, buckets);
+    }
+
+    if (command == "index")
+    {
+        if (args.size() != 2)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        size_t count;
+        size_t transactions;
+
+        if (!parse_uint(count, args[0]) || !parse_uint(transactions, args[1]))
+            return -1;
+
+        if (count == 0 || transactions == 0)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        return indexing(directory, count, transactions);
+    }
+
+    if (command == "latency")
+    {
+        if (args.size() != 1)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        size_t count;
+
+        if (!parse_uint(count, args[0]))
+            return -1;
+
+        if (count == 0)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        return read_latency(directory, count);
+    }
+
+    if (command == "stealth")
+    {
+        if (args.size() != 1)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        size_t count;
+
+        if (!parse_uint(count, args[0]))
+            return -1;
+
+        if (count == 0)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        return stealth(directory, count);
+    }
+
+    std::cout << "benchmark: unrecognized command " << command << std::endl;
+    return -1;
+}
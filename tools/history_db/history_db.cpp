@@ -18,6 +18,7 @@ void show_help()
     std::cout << "  add_spend       " << "Add a spend to a row" << std::endl;
     std::cout << "  delete_last_row " << "Delete last row that was added for a key" << std::endl;
     std::cout << "  fetch           " << "Fetch rows for a key" << std::endl;
+    std::cout << "  summary         " << "Show received value, rows and last height for a key" << std::endl;
     std::cout << "  statinfo        " << "Show statistical info for the database" << std::endl;
     std::cout << "  help            " << "Show help for commands" << std::endl;
 }
@@ -47,7 +48,12 @@ void show_command_help(const std::string& command)
     else if (command == "fetch")
     {
         std::cout << "Usage: history_db " << command << " LOOKUP ROWS "
-            << "KEY [LIMIT] [FROM_HEIGHT]" << std::endl;
+            << "KEY [LIMIT] [FROM_HEIGHT] [TO_HEIGHT]" << std::endl;
+    }
+    else if (command == "summary")
+    {
+        std::cout << "Usage: history_db " << command << " LOOKUP ROWS "
+            << "KEY" << std::endl;
     }
     else if (command == "statinfo")
     {
@@ -255,7 +261,7 @@ int main(int argc, char** argv)
     }
     else if (command == "fetch")
     {
-        if (args.size() < 1 || args.size() > 3)
+        if (args.size() < 1 || args.size() > 4)
         {
             show_command_help(command);
             return -1;
@@ -275,10 +281,16 @@ int main(int argc, char** argv)
             if (!parse_uint(from_height, args[2]))
                 return -1;
 
+        size_t to_height = max_size_t;
+        if (args.size() >= 4)
+            if (!parse_uint(to_height, args[3]))
+                return -1;
+
         const auto result = db.open();
         BITCOIN_ASSERT(result);
 
-        auto history = db.get(key, limit, from_height);
+        history_cursor cursor;
+        auto history = db.get(key, limit, from_height, to_height, cursor);
 
         for (const auto& row: history)
         {
@@ -291,6 +303,26 @@ int main(int argc, char** argv)
                 << std::endl;
         }
     }
+    else if (command == "summary")
+    {
+        if (args.size() != 1)
+        {
+            show_command_help(command);
+            return -1;
+        }
+
+        short_hash key;
+        if (!parse_key(key, args[0]))
+            return -1;
+
+        const auto result = db.open();
+        BITCOIN_ASSERT(result);
+
+        const auto summary = db.summary(key);
+        std::cout << "Received: " << summary.received << std::endl;
+        std::cout << "Rows: " << summary.rows << std::endl;
+        std::cout << "Last height: " << summary.height << std::endl;
+    }
     else if (command == "statinfo")
     {
         if (!args.empty())
@@ -305,7 +337,7 @@ int main(int argc, char** argv)
         auto info = db.statinfo();
         std::cout << "Buckets: " << info.buckets << std::endl;
         std::cout << "Unique addresses: " << info.addrs << std::endl;
-        std::cout << "Total rows: " << info.rows << std::endl;
+        std::cout << "Total chunks: " << info.chunks << std::endl;
     }
     else
     {
@@ -52,7 +52,8 @@ int main(int argc, char** argv)
     result = header.start();
     BITCOIN_ASSERT(result);
 
-    slab_manager manager(file, offset + 4 + 8 * header.size());
+    slab_manager manager(file, offset +
+        slab_hash_table_header_size(header.size()));
     result = manager.start();
     BITCOIN_ASSERT(result);
 